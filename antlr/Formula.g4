@@ -6,9 +6,12 @@ main
 
 expr
     : '(' expr ')'  # Parens
+    | NAME '(' (expr (',' expr)*)? ')'  # Function
     | (ADD | SUB) expr  # UnaryOp
     | expr (MUL | DIV) expr  # BinaryOp
     | expr (ADD | SUB) expr  # BinaryOp
+    | expr (EQ | NE | LT | LE | GT | GE) expr  # Comparison
+    | CELL ':' CELL  # Range
     | CELL  # Cell
     | NUMBER  # Literal
     ;
@@ -26,5 +29,13 @@ ADD: '+' ;
 SUB: '-' ;
 MUL: '*' ;
 DIV: '/' ;
+EQ: '=' ;
+NE: '<>' ;
+LT: '<' ;
+LE: '<=' ;
+GT: '>' ;
+GE: '>=' ;
 CELL: [A-Z]+[0-9]+ ;
+// function names; a name followed by digits is a CELL
+NAME: [A-Z]+ ;
 WS: [ \t\n\r]+ -> skip ;
\ No newline at end of file
@@ -3,17 +3,23 @@
 #include "FormulaBaseListener.h"
 #include "FormulaLexer.h"
 #include "FormulaParser.h"
+#include "aggregate_kernels.h"
 
+#include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <climits>
 #include <cmath>
+#include <cstring>
 #include <memory>
 #include <optional>
 #include <sstream>
-#include <regex>
+#include <stdexcept>
 
 namespace ASTImpl {
 
     enum ExprPrecedence {
+        EP_CMP,
         EP_ADD,
         EP_SUB,
         EP_MUL,
@@ -59,27 +65,77 @@ namespace ASTImpl {
     //     (currently in the table we're always putting in the parentheses)
     // +(A * B) - always okay (the resulting binary op has the highest grammatic precedence)
     // +(A / B) - always okay (the resulting binary op has the highest grammatic precedence)
+    // Comparisons have the lowest grammatic precedence and are left-associative:
+    // A < (B < C) - never okay
+    // A + (B < C), -(A < B) - never okay
+    // (A < B) < C, A < (B + C) - always okay
+    // Function arguments are printed as top-level expressions.
     constexpr PrecedenceRule PRECEDENCE_RULES[EP_END][EP_END] = {
-        /* EP_ADD */ {PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
-        /* EP_SUB */ {PR_RIGHT, PR_RIGHT, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
-        /* EP_MUL */ {PR_BOTH, PR_BOTH, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
-        /* EP_DIV */ {PR_BOTH, PR_BOTH, PR_RIGHT, PR_RIGHT, PR_NONE, PR_NONE},
-        /* EP_UNARY */ {PR_BOTH, PR_BOTH, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
-        /* EP_ATOM */ {PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
+        /* EP_CMP */ {PR_RIGHT, PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
+        /* EP_ADD */ {PR_BOTH, PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
+        /* EP_SUB */ {PR_BOTH, PR_RIGHT, PR_RIGHT, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
+        /* EP_MUL */ {PR_BOTH, PR_BOTH, PR_BOTH, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
+        /* EP_DIV */ {PR_BOTH, PR_BOTH, PR_BOTH, PR_RIGHT, PR_RIGHT, PR_NONE, PR_NONE},
+        /* EP_UNARY */ {PR_BOTH, PR_BOTH, PR_BOTH, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
+        /* EP_ATOM */ {PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE, PR_NONE},
     };
 
+    namespace {
+        // Errors travel through evaluation as quiet NaNs that carry the error
+        // category in the payload. Every value a formula can produce is finite,
+        // so a NaN on the evaluation path is always such an error, and the
+        // happy path pays nothing for error handling.
+        constexpr std::uint64_t ERROR_TAG = 0x7FF8'0000'0000'E000;
+        constexpr std::uint64_t ERROR_TAG_MASK = 0x7FFF'FFFF'FFFF'FF00;
+        constexpr std::uint64_t ERROR_CATEGORY_MASK = 0xFF;
+
+        double MakeError(FormulaError::Category category) {
+            const std::uint64_t bits = ERROR_TAG | static_cast<std::uint64_t>(category);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        FormulaError ToError(double value) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            if ((bits & ERROR_TAG_MASK) != ERROR_TAG) {
+                return FormulaError::Category::Div0;
+            }
+            return static_cast<FormulaError::Category>(bits & ERROR_CATEGORY_MASK);
+        }
+
+        FormulaAST::Value ToValue(double value) {
+            if (std::isnan(value)) {
+                return ToError(value);
+            }
+            return value;
+        }
+    }  // namespace
+
     class Expr {
     public:
         virtual ~Expr() = default;
-        virtual void Print(std::ostream& out) const = 0;
-        virtual void DoPrintFormula(std::ostream& out, ExprPrecedence precedence) const = 0;
-        virtual double Evaluate(const SheetInterface& args) const = 0;
+        // cell positions are stored relative to the anchor, see
+        // FormulaAST::MakeRelativeTo()
+        virtual void Print(std::ostream& out, Position anchor) const = 0;
+        virtual void DoPrintFormula(std::ostream& out, ExprPrecedence precedence,
+            Position anchor) const = 0;
+        virtual double Evaluate(const SheetInterface& args, Position anchor) const = 0;
+        // appends the postfix code of the subtree to the program
+        virtual void Compile(Program& program) const = 0;
 
         // higher is tighter
         virtual ExprPrecedence GetPrecedence() const = 0;
 
+        // A range is passed to aggregate functions whole, without being
+        // reduced to a single value.
+        virtual const Range* GetRange() const {
+            return nullptr;
+        }
+
         void PrintFormula(std::ostream& out, ExprPrecedence parent_precedence,
-            bool right_child = false) const {
+            Position anchor, bool right_child = false) const {
             auto precedence = GetPrecedence();
             auto mask = right_child ? PR_RIGHT : PR_LEFT;
             bool parens_needed = PRECEDENCE_RULES[parent_precedence][precedence] & mask;
@@ -87,7 +143,7 @@ namespace ASTImpl {
                 out << '(';
             }
 
-            DoPrintFormula(out, precedence);
+            DoPrintFormula(out, precedence, anchor);
 
             if (parens_needed) {
                 out << ')';
@@ -96,6 +152,451 @@ namespace ASTImpl {
     };
 
     namespace {
+        // an operand's error wins over the overflow it has caused
+        double CheckFinite(double result, double lhs, double rhs) {
+            if (std::isfinite(result)) {
+                return result;
+            }
+            if (std::isnan(lhs)) {
+                return lhs;
+            }
+            if (std::isnan(rhs)) {
+                return rhs;
+            }
+            return MakeError(FormulaError::Category::Div0);
+        }
+
+        // the absolute position of a cell stored as an offset from the anchor
+        Position Shift(Position offset, Position anchor) {
+            return { offset.row + anchor.row, offset.col + anchor.col };
+        }
+
+        double ToDouble(const CellInterface::NumericValue& value) {
+            if (const double* number = std::get_if<double>(&value)) {
+                return *number;
+            }
+            return MakeError(std::get<FormulaError>(value).GetCategory());
+        }
+
+        double GetCellValue(const SheetInterface& args, Position pos) {
+            if (!pos.IsValid()) {
+                return MakeError(FormulaError::Category::Ref);
+            }
+
+            const CellInterface* cell = args.GetCell(pos);
+            if (cell == nullptr) {
+                return 0.0;
+            }
+
+            return ToDouble(cell->GetNumericValue());
+        }
+
+        Range Shift(Range offset, Position anchor) {
+            return { Shift(offset.from, anchor), Shift(offset.to, anchor) };
+        }
+
+        // Outside of a function a range stands for a single value: a 1x1
+        // range is its cell, a larger one can't be used as a number.
+        double GetRangeValue(const SheetInterface& args, Range range) {
+            if (!range.IsValid()) {
+                return MakeError(FormulaError::Category::Ref);
+            }
+            if (!(range.from == range.to)) {
+                return MakeError(FormulaError::Category::Value);
+            }
+            return GetCellValue(args, range.from);
+        }
+
+        // C3:A1 is the same range as A1:C3
+        Range MakeRange(Position first, Position last) {
+            return { { std::min(first.row, last.row), std::min(first.col, last.col) },
+                { std::max(first.row, last.row), std::max(first.col, last.col) } };
+        }
+
+        constexpr size_t ANY_NUMBER_OF_ARGS = SIZE_MAX;
+
+        struct FunctionInfo {
+            std::string_view name;
+            Function function;
+            size_t min_args;
+            size_t max_args;
+        };
+
+        // The built-in functions, in the order of the Function enum.
+        constexpr FunctionInfo FUNCTIONS[] = {
+            { "SUM", Function::Sum, 1, ANY_NUMBER_OF_ARGS },
+            { "MIN", Function::Min, 1, ANY_NUMBER_OF_ARGS },
+            { "MAX", Function::Max, 1, ANY_NUMBER_OF_ARGS },
+            { "AVERAGE", Function::Average, 1, ANY_NUMBER_OF_ARGS },
+            { "AND", Function::And, 1, ANY_NUMBER_OF_ARGS },
+            { "OR", Function::Or, 1, ANY_NUMBER_OF_ARGS },
+            { "COUNT", Function::Count, 1, ANY_NUMBER_OF_ARGS },
+            { "IF", Function::If, 2, 3 },
+        };
+
+        const FunctionInfo& GetFunctionInfo(Function function) {
+            return FUNCTIONS[static_cast<size_t>(function)];
+        }
+
+        Function ResolveFunction(std::string_view name, size_t args) {
+            for (const FunctionInfo& info : FUNCTIONS) {
+                if (info.name != name) {
+                    continue;
+                }
+                if (args < info.min_args || args > info.max_args) {
+                    throw FormulaException("Wrong number of arguments: " + std::string(name));
+                }
+                return info.function;
+            }
+            throw FormulaException("Unknown function: " + std::string(name));
+        }
+
+        // The partial result of a single value. COUNT counts the values
+        // that are numbers, so its errors are not propagated.
+        double ToPartial(Function function, double value) {
+            if (function == Function::Count) {
+                return std::isnan(value) ? 0.0 : 1.0;
+            }
+            return value;
+        }
+
+        // Folds the arguments of an aggregate function. An argument is a
+        // pair of a partial result and the number of values behind it: one
+        // value for a scalar, every non-empty cell for a range. The first
+        // error met becomes the result.
+        class Aggregator {
+        public:
+            explicit Aggregator(Function function)
+                : function_(function) {
+            }
+
+            void Add(double value) {
+                Merge(ToPartial(function_, value), 1.0);
+            }
+
+            // Folds a run of values at once with the vectorized kernels. An
+            // error in the run is any NaN, error_at(i) gives the evaluation
+            // error of values[i].
+            template <typename ErrorAt>
+            void AddRun(const double* values, size_t count, ErrorAt error_at) {
+                if (count == 0 || std::isnan(partial_)) {
+                    return;
+                }
+                if (function_ == Function::And || function_ == Function::Or) {
+                    for (size_t i = 0; i < count && !std::isnan(partial_); ++i) {
+                        Add(std::isnan(values[i]) ? error_at(i) : values[i]);
+                    }
+                    return;
+                }
+
+                const kernels::Reduction reduction = kernels::Reduce(values, count);
+                if (function_ == Function::Count) {
+                    Merge(static_cast<double>(reduction.numbers), static_cast<double>(count));
+                }
+                else if (reduction.first_error != kernels::Reduction::NPOS) {
+                    Merge(error_at(reduction.first_error), 1.0);
+                }
+                else if (function_ == Function::Min) {
+                    Merge(reduction.min, static_cast<double>(count));
+                }
+                else if (function_ == Function::Max) {
+                    Merge(reduction.max, static_cast<double>(count));
+                }
+                else {
+                    Merge(reduction.sum, static_cast<double>(count));
+                }
+            }
+
+            void Merge(double partial, double count) {
+                if (std::isnan(partial_)) {
+                    return;
+                }
+                if (std::isnan(partial)) {
+                    partial_ = partial;
+                    return;
+                }
+                if (count == 0) {
+                    return;
+                }
+
+                if (count_ == 0) {
+                    partial_ = partial;
+                }
+                else {
+                    switch (function_) {
+                    case Function::Sum:
+                    case Function::Average:
+                    case Function::Count:
+                        partial_ += partial;
+                        break;
+                    case Function::Min:
+                        partial_ = std::min(partial_, partial);
+                        break;
+                    case Function::Max:
+                        partial_ = std::max(partial_, partial);
+                        break;
+                    case Function::And:
+                        partial_ = partial_ != 0 && partial != 0;
+                        break;
+                    case Function::Or:
+                        partial_ = partial_ != 0 || partial != 0;
+                        break;
+                    case Function::If:
+                        assert(false);
+                        break;
+                    }
+                }
+                count_ += count;
+            }
+
+            double Partial() const {
+                return partial_;
+            }
+
+            double Count() const {
+                return count_;
+            }
+
+            double Result() const {
+                if (std::isnan(partial_)) {
+                    return partial_;
+                }
+
+                double result = partial_;
+                switch (function_) {
+                case Function::Average:
+                    if (count_ == 0) {
+                        return MakeError(FormulaError::Category::Div0);
+                    }
+                    result = partial_ / count_;
+                    break;
+                case Function::And:
+                case Function::Or:
+                    if (count_ == 0) {
+                        return MakeError(FormulaError::Category::Value);
+                    }
+                    result = partial_ != 0;
+                    break;
+                default:
+                    // MIN and MAX of no values are 0, like SUM
+                    break;
+                }
+                return std::isfinite(result) ? result : MakeError(FormulaError::Category::Div0);
+            }
+
+        private:
+            Function function_;
+            double partial_ = 0.0;
+            double count_ = 0.0;
+        };
+
+        // The pair of a range argument. Empty cells are skipped, the others
+        // are read like a single reference and folded in runs: straight from
+        // the sheet's column values when it keeps them, otherwise gathered
+        // cell by cell.
+        std::pair<double, double> GetRangePair(const SheetInterface& args, Range range, Function function) {
+            if (!range.IsValid()) {
+                return { MakeError(FormulaError::Category::Ref), 1.0 };
+            }
+
+            Aggregator aggregator(function);
+            // The runs come column by column, but the error of a range is its
+            // first one in row order, as ForEachCellInRange() meets them. Once
+            // the result is an error, the later columns are only searched
+            // above it.
+            Position error_pos;
+            const bool columnar = args.ForEachValueRun(range, [&](Position first, const double* values, size_t count) {
+                if (!std::isnan(aggregator.Partial())) {
+                    aggregator.AddRun(values, count, [&args, &error_pos, first](size_t i) {
+                        error_pos = { first.row + static_cast<int>(i), first.col };
+                        return GetCellValue(args, error_pos);
+                    });
+                    return;
+                }
+                const size_t above = std::min<size_t>(count, std::max(error_pos.row - first.row, 0));
+                const double* error = std::find_if(values, values + above, [](double value) {
+                    return std::isnan(value);
+                });
+                if (error != values + above) {
+                    error_pos = { first.row + static_cast<int>(error - values), first.col };
+                    aggregator = Aggregator(function);
+                    aggregator.Add(GetCellValue(args, error_pos));
+                }
+            });
+            if (columnar) {
+                return { aggregator.Partial(), aggregator.Count() };
+            }
+
+            constexpr size_t RUN_SIZE = 256;
+            double run[RUN_SIZE];
+            size_t size = 0;
+            auto error_at = [&run](size_t i) {
+                return run[i];
+            };
+            args.ForEachCellInRange(range, [&](Position /* pos */, const CellInterface& cell) {
+                run[size++] = ToDouble(cell.GetNumericValue());
+                if (size == RUN_SIZE) {
+                    aggregator.AddRun(run, size, error_at);
+                    size = 0;
+                }
+            });
+            aggregator.AddRun(run, size, error_at);
+            return { aggregator.Partial(), aggregator.Count() };
+        }
+
+        // 1 if the comparison holds, 0 if not; an operand's error is the result
+        double Compare(OpCode op, double lhs, double rhs) {
+            if (std::isnan(lhs)) {
+                return lhs;
+            }
+            if (std::isnan(rhs)) {
+                return rhs;
+            }
+
+            switch (op) {
+            case OpCode::Equal:
+                return lhs == rhs;
+            case OpCode::NotEqual:
+                return lhs != rhs;
+            case OpCode::Less:
+                return lhs < rhs;
+            case OpCode::LessEqual:
+                return lhs <= rhs;
+            case OpCode::Greater:
+                return lhs > rhs;
+            case OpCode::GreaterEqual:
+                return lhs >= rhs;
+            default:
+                assert(false);
+                return 0.0;
+            }
+        }
+
+        void Emit(Program& program, OpCode op, size_t arg = 0, Function function = Function::Sum) {
+            program.code.push_back({ op, function, static_cast<std::uint32_t>(arg) });
+        }
+
+        // The deepest the stack gets while the program runs, or nullopt if the
+        // program is malformed: an operand is missing, an index or a jump is
+        // out of range, the paths meeting at an instruction disagree on the
+        // stack depth or the program doesn't leave one value. Jumps only go
+        // forward, so one pass in code order sees every stack state.
+        std::optional<size_t> GetMaxDepth(const Program& program) {
+            const std::vector<Instruction>& code = program.code;
+            // the depth at each instruction that a jump leads to
+            std::vector<std::optional<size_t>> targets(code.size() + 1);
+            auto jump_to = [&targets](size_t target, size_t depth) {
+                if (targets[target] && *targets[target] != depth) {
+                    return false;
+                }
+                targets[target] = depth;
+                return true;
+            };
+
+            size_t depth = 0;
+            // false after a Jump, which doesn't fall through
+            bool reachable = true;
+            size_t max_depth = 0;
+            for (size_t pc = 0; pc <= code.size(); ++pc) {
+                if (targets[pc]) {
+                    if (reachable && depth != *targets[pc]) {
+                        return std::nullopt;
+                    }
+                    depth = *targets[pc];
+                    reachable = true;
+                }
+                if (!reachable) {
+                    return std::nullopt;
+                }
+                if (pc == code.size()) {
+                    break;
+                }
+
+                const Instruction& instruction = code[pc];
+                if (instruction.function > Function::If) {
+                    return std::nullopt;
+                }
+                size_t operands = 0;
+                size_t results = 1;
+                switch (instruction.op) {
+                case OpCode::PushNumber:
+                    if (instruction.arg >= program.numbers.size()) {
+                        return std::nullopt;
+                    }
+                    break;
+                case OpCode::PushCell:
+                    if (instruction.arg >= program.cells.size()) {
+                        return std::nullopt;
+                    }
+                    break;
+                case OpCode::PushRange:
+                    if (instruction.arg >= program.ranges.size()) {
+                        return std::nullopt;
+                    }
+                    break;
+                case OpCode::PairValue:
+                    operands = 1;
+                    results = 2;
+                    break;
+                case OpCode::PushRangePair:
+                    if (instruction.arg >= program.ranges.size()) {
+                        return std::nullopt;
+                    }
+                    results = 2;
+                    break;
+                case OpCode::Aggregate:
+                    operands = 2 * static_cast<size_t>(instruction.arg);
+                    break;
+                case OpCode::Negate:
+                    operands = 1;
+                    break;
+                case OpCode::Add:
+                case OpCode::Subtract:
+                case OpCode::Multiply:
+                case OpCode::Divide:
+                case OpCode::Equal:
+                case OpCode::NotEqual:
+                case OpCode::Less:
+                case OpCode::LessEqual:
+                case OpCode::Greater:
+                case OpCode::GreaterEqual:
+                    operands = 2;
+                    break;
+                case OpCode::JumpUnless:
+                    // an error condition stays on the stack and follows the
+                    // Jump just before the target
+                    if (depth < 1 || instruction.arg <= pc + 1 || instruction.arg > code.size()
+                        || code[instruction.arg - 1].op != OpCode::Jump
+                        || code[instruction.arg - 1].arg > code.size()
+                        || !jump_to(instruction.arg, depth - 1)
+                        || !jump_to(code[instruction.arg - 1].arg, depth)) {
+                        return std::nullopt;
+                    }
+                    operands = 1;
+                    results = 0;
+                    break;
+                case OpCode::Jump:
+                    if (instruction.arg <= pc || instruction.arg > code.size()
+                        || !jump_to(instruction.arg, depth)) {
+                        return std::nullopt;
+                    }
+                    reachable = false;
+                    continue;
+                default:
+                    return std::nullopt;
+                }
+                if (depth < operands) {
+                    return std::nullopt;
+                }
+                depth = depth - operands + results;
+                max_depth = std::max(max_depth, depth);
+            }
+            if (depth != 1) {
+                return std::nullopt;
+            }
+            return max_depth;
+        }
+
         class BinaryOpExpr final : public Expr {
         public:
             enum Type : char {
@@ -112,18 +613,19 @@ namespace ASTImpl {
                 , rhs_(std::move(rhs)) {
             }
 
-            void Print(std::ostream& out) const override {
+            void Print(std::ostream& out, Position anchor) const override {
                 out << '(' << static_cast<char>(type_) << ' ';
-                lhs_->Print(out);
+                lhs_->Print(out, anchor);
                 out << ' ';
-                rhs_->Print(out);
+                rhs_->Print(out, anchor);
                 out << ')';
             }
 
-            void DoPrintFormula(std::ostream& out, ExprPrecedence precedence) const override {
-                lhs_->PrintFormula(out, precedence);
+            void DoPrintFormula(std::ostream& out, ExprPrecedence precedence,
+                Position anchor) const override {
+                lhs_->PrintFormula(out, precedence, anchor);
                 out << static_cast<char>(type_);
-                rhs_->PrintFormula(out, precedence, /* right_child = */ true);
+                rhs_->PrintFormula(out, precedence, anchor, /* right_child = */ true);
             }
 
             ExprPrecedence GetPrecedence() const override {
@@ -143,28 +645,45 @@ namespace ASTImpl {
                 }
             }
 
-            double Evaluate(const SheetInterface& args) const override {
+            double Evaluate(const SheetInterface& args, Position anchor) const override {
+                const double lhs = lhs_->Evaluate(args, anchor);
+                const double rhs = rhs_->Evaluate(args, anchor);
                 double result = 0.0;
                 switch (type_) {
                 case Add:
-                    result = lhs_->Evaluate(args) + rhs_->Evaluate(args);
+                    result = lhs + rhs;
                     break;
                 case Subtract:
-                    result = lhs_->Evaluate(args) - rhs_->Evaluate(args);
+                    result = lhs - rhs;
                     break;
                 case Multiply:
-                    result = lhs_->Evaluate(args) * rhs_->Evaluate(args);
+                    result = lhs * rhs;
                     break;
                 case Divide:
-                    result = lhs_->Evaluate(args) / rhs_->Evaluate(args);
+                    result = lhs / rhs;
                     break;
                 }
 
-                if (!std::isfinite(result)) {
-                    throw FormulaError(FormulaError::Category::Div0);
-                }
+                return CheckFinite(result, lhs, rhs);
+            }
 
-                return result;
+            void Compile(Program& program) const override {
+                lhs_->Compile(program);
+                rhs_->Compile(program);
+                switch (type_) {
+                case Add:
+                    Emit(program, OpCode::Add);
+                    break;
+                case Subtract:
+                    Emit(program, OpCode::Subtract);
+                    break;
+                case Multiply:
+                    Emit(program, OpCode::Multiply);
+                    break;
+                case Divide:
+                    Emit(program, OpCode::Divide);
+                    break;
+                }
             }
 
         private:
@@ -186,32 +705,40 @@ namespace ASTImpl {
                 , operand_(std::move(operand)) {
             }
 
-            void Print(std::ostream& out) const override {
+            void Print(std::ostream& out, Position anchor) const override {
                 out << '(' << static_cast<char>(type_) << ' ';
-                operand_->Print(out);
+                operand_->Print(out, anchor);
                 out << ')';
             }
 
-            void DoPrintFormula(std::ostream& out, ExprPrecedence precedence) const override {
+            void DoPrintFormula(std::ostream& out, ExprPrecedence precedence,
+                Position anchor) const override {
                 out << static_cast<char>(type_);
-                operand_->PrintFormula(out, precedence);
+                operand_->PrintFormula(out, precedence, anchor);
             }
 
             ExprPrecedence GetPrecedence() const override {
                 return EP_UNARY;
             }
 
-            double Evaluate(const SheetInterface& args) const override {
+            double Evaluate(const SheetInterface& args, Position anchor) const override {
                 switch (type_) {
                 case UnaryPlus:
-                    return operand_->Evaluate(args);
+                    return operand_->Evaluate(args, anchor);
                 case UnaryMinus:
-                    return operand_->Evaluate(args) * (-1);
+                    return operand_->Evaluate(args, anchor) * (-1);
                 default:
                     throw FormulaException("incorrect input");
                 }
             }
 
+            void Compile(Program& program) const override {
+                operand_->Compile(program);
+                if (type_ == UnaryMinus) {
+                    Emit(program, OpCode::Negate);
+                }
+            }
+
         private:
             Type type_;
             std::unique_ptr<Expr> operand_;
@@ -223,53 +750,243 @@ namespace ASTImpl {
                 : cell_(cell) {
             }
 
-            void Print(std::ostream& out) const override {
-                if (!cell_->IsValid()) {
+            void Print(std::ostream& out, Position anchor) const override {
+                Position cell = Shift(*cell_, anchor);
+                if (!cell.IsValid()) {
                     out << FormulaError::Category::Ref;
                 }
                 else {
-                    out << cell_->ToString();
+                    out << cell.ToString();
+                }
+            }
+
+            void DoPrintFormula(std::ostream& out, ExprPrecedence /* precedence */,
+                Position anchor) const override {
+                Print(out, anchor);
+            }
+
+            ExprPrecedence GetPrecedence() const override {
+                return EP_ATOM;
+            }
+
+            double Evaluate(const SheetInterface& args, Position anchor) const override {
+                return GetCellValue(args, Shift(*cell_, anchor));
+            }
+
+            void Compile(Program& program) const override {
+                Emit(program, OpCode::PushCell, program.cells.size());
+                program.cells.push_back(*cell_);
+            }
+
+        private:
+            const Position* cell_;
+        };
+
+        class RangeExpr final : public Expr {
+        public:
+            explicit RangeExpr(const Range* range)
+                : range_(range) {
+            }
+
+            void Print(std::ostream& out, Position anchor) const override {
+                Range range = Shift(*range_, anchor);
+                if (!range.IsValid()) {
+                    out << FormulaError::Category::Ref;
+                }
+                else {
+                    out << range.ToString();
+                }
+            }
+
+            void DoPrintFormula(std::ostream& out, ExprPrecedence /* precedence */,
+                Position anchor) const override {
+                Print(out, anchor);
+            }
+
+            ExprPrecedence GetPrecedence() const override {
+                return EP_ATOM;
+            }
+
+            double Evaluate(const SheetInterface& args, Position anchor) const override {
+                return GetRangeValue(args, Shift(*range_, anchor));
+            }
+
+            const Range* GetRange() const override {
+                return range_;
+            }
+
+            void Compile(Program& program) const override {
+                Emit(program, OpCode::PushRange, program.ranges.size());
+                program.ranges.push_back(*range_);
+            }
+
+        private:
+            const Range* range_;
+        };
+
+        class ComparisonExpr final : public Expr {
+        public:
+            // op is one of the comparison opcodes, Equal to GreaterEqual
+            ComparisonExpr(OpCode op, std::unique_ptr<Expr> lhs, std::unique_ptr<Expr> rhs)
+                : op_(op)
+                , lhs_(std::move(lhs))
+                , rhs_(std::move(rhs)) {
+            }
+
+            void Print(std::ostream& out, Position anchor) const override {
+                out << '(' << GetSymbol() << ' ';
+                lhs_->Print(out, anchor);
+                out << ' ';
+                rhs_->Print(out, anchor);
+                out << ')';
+            }
+
+            void DoPrintFormula(std::ostream& out, ExprPrecedence precedence,
+                Position anchor) const override {
+                lhs_->PrintFormula(out, precedence, anchor);
+                out << GetSymbol();
+                rhs_->PrintFormula(out, precedence, anchor, /* right_child = */ true);
+            }
+
+            ExprPrecedence GetPrecedence() const override {
+                return EP_CMP;
+            }
+
+            double Evaluate(const SheetInterface& args, Position anchor) const override {
+                const double lhs = lhs_->Evaluate(args, anchor);
+                return Compare(op_, lhs, rhs_->Evaluate(args, anchor));
+            }
+
+            void Compile(Program& program) const override {
+                lhs_->Compile(program);
+                rhs_->Compile(program);
+                Emit(program, op_);
+            }
+
+        private:
+            std::string_view GetSymbol() const {
+                switch (op_) {
+                case OpCode::Equal:
+                    return "=";
+                case OpCode::NotEqual:
+                    return "<>";
+                case OpCode::Less:
+                    return "<";
+                case OpCode::LessEqual:
+                    return "<=";
+                case OpCode::Greater:
+                    return ">";
+                case OpCode::GreaterEqual:
+                    return ">=";
+                default:
+                    assert(false);
+                    return "";
+                }
+            }
+
+            OpCode op_;
+            std::unique_ptr<Expr> lhs_;
+            std::unique_ptr<Expr> rhs_;
+        };
+
+        class FunctionExpr final : public Expr {
+        public:
+            FunctionExpr(Function function, std::vector<std::unique_ptr<Expr>> args)
+                : function_(function)
+                , args_(std::move(args)) {
+            }
+
+            void Print(std::ostream& out, Position anchor) const override {
+                out << '(' << GetFunctionInfo(function_).name;
+                for (const auto& arg : args_) {
+                    out << ' ';
+                    arg->Print(out, anchor);
                 }
+                out << ')';
             }
 
-            void DoPrintFormula(std::ostream& out, ExprPrecedence /* precedence */) const override {
-                Print(out);
+            void DoPrintFormula(std::ostream& out, ExprPrecedence /* precedence */,
+                Position anchor) const override {
+                out << GetFunctionInfo(function_).name << '(';
+                bool first = true;
+                for (const auto& arg : args_) {
+                    if (!first) {
+                        out << ',';
+                    }
+                    first = false;
+                    arg->PrintFormula(out, EP_ATOM, anchor);
+                }
+                out << ')';
             }
 
             ExprPrecedence GetPrecedence() const override {
                 return EP_ATOM;
             }
 
-            double Evaluate(const SheetInterface& args) const override {
-                if (cell_->IsValid()) {
-                    const CellInterface* cell = args.GetCell(*cell_);
-                    if (cell == nullptr) { return 0.0; }
-                    const CellInterface::Value value = cell->GetValue();
-
-                    if (std::holds_alternative<std::string>(value)) {
-                        std::string str = std::get<std::string>(value);
-                        if (str.empty()) { return 0.0; }
-                        if (std::regex_match(str, std::regex(R"(^([+-]?(?:[[:d:]]+\.?|[[:d:]]*\.[[:d:]]+))(?:[Ee][+-]?[[:d:]]+)?$)"))) {
-                            return std::stod(str);
-                        }
-                        else {
-                            throw FormulaError(FormulaError::Category::Value);
-                        }
-                    }
-                    else if (std::holds_alternative<double>(value)) {
-                        return std::get<double>(value);
-                    } 
+            double Evaluate(const SheetInterface& args, Position anchor) const override {
+                if (function_ == Function::If) {
+                    // only the branch taken is evaluated
+                    const double condition = args_[0]->Evaluate(args, anchor);
+                    if (std::isnan(condition)) {
+                        return condition;
+                    }
+                    if (condition != 0) {
+                        return args_[1]->Evaluate(args, anchor);
+                    }
+                    return args_.size() > 2 ? args_[2]->Evaluate(args, anchor) : 0.0;
+                }
+
+                Aggregator aggregator(function_);
+                for (const auto& arg : args_) {
+                    if (const Range* range = arg->GetRange()) {
+                        auto [partial, count] = GetRangePair(args, Shift(*range, anchor), function_);
+                        aggregator.Merge(partial, count);
+                    }
                     else {
-                        throw FormulaError(FormulaError::Category::Value);
+                        aggregator.Add(arg->Evaluate(args, anchor));
                     }
                 }
-                else {
-                    throw FormulaError(FormulaError::Category::Ref);
+                return aggregator.Result();
+            }
+
+            void Compile(Program& program) const override {
+                if (function_ == Function::If) {
+                    // condition JumpUnless(else) then Jump(end) else end
+                    args_[0]->Compile(program);
+                    const size_t branch = program.code.size();
+                    Emit(program, OpCode::JumpUnless);
+                    args_[1]->Compile(program);
+                    const size_t jump = program.code.size();
+                    Emit(program, OpCode::Jump);
+
+                    program.code[branch].arg = static_cast<std::uint32_t>(program.code.size());
+                    if (args_.size() > 2) {
+                        args_[2]->Compile(program);
+                    }
+                    else {
+                        Emit(program, OpCode::PushNumber, program.numbers.size());
+                        program.numbers.push_back(0.0);
+                    }
+                    program.code[jump].arg = static_cast<std::uint32_t>(program.code.size());
+                    return;
                 }
+
+                for (const auto& arg : args_) {
+                    if (const Range* range = arg->GetRange()) {
+                        Emit(program, OpCode::PushRangePair, program.ranges.size(), function_);
+                        program.ranges.push_back(*range);
+                    }
+                    else {
+                        arg->Compile(program);
+                        Emit(program, OpCode::PairValue, 0, function_);
+                    }
+                }
+                Emit(program, OpCode::Aggregate, args_.size(), function_);
             }
 
         private:
-            const Position* cell_;
+            Function function_;
+            std::vector<std::unique_ptr<Expr>> args_;
         };
 
         class NumberExpr final : public Expr {
@@ -278,11 +995,12 @@ namespace ASTImpl {
                 : value_(value) {
             }
 
-            void Print(std::ostream& out) const override {
+            void Print(std::ostream& out, Position /* anchor */) const override {
                 out << value_;
             }
 
-            void DoPrintFormula(std::ostream& out, ExprPrecedence /* precedence */) const override {
+            void DoPrintFormula(std::ostream& out, ExprPrecedence /* precedence */,
+                Position /* anchor */) const override {
                 out << value_;
             }
 
@@ -290,14 +1008,401 @@ namespace ASTImpl {
                 return EP_ATOM;
             }
 
-            double Evaluate(const SheetInterface& args) const override {
+            double Evaluate(const SheetInterface& /* args */, Position /* anchor */) const override {
                 return value_;
             }
 
+            void Compile(Program& program) const override {
+                Emit(program, OpCode::PushNumber, program.numbers.size());
+                program.numbers.push_back(value_);
+            }
+
         private:
             double value_;
         };
 
+        // Hand-written front end for the Formula.g4 grammar. Tokens are
+        // string_views into the input, so apart from the AST nodes nothing
+        // is allocated while parsing.
+        class Tokenizer {
+        public:
+            enum class TokenType {
+                End,
+                Number,
+                Cell,
+                Add,
+                Sub,
+                Mul,
+                Div,
+                LeftParen,
+                RightParen,
+                Colon,
+                Comma,
+                Name,
+                Equal,
+                NotEqual,
+                Less,
+                LessEqual,
+                Greater,
+                GreaterEqual,
+            };
+
+            struct Token {
+                TokenType type = TokenType::End;
+                std::string_view text;
+            };
+
+        public:
+            explicit Tokenizer(std::string_view input)
+                : input_(input) {
+                Advance();
+            }
+
+            const Token& Peek() const {
+                return current_;
+            }
+
+            Token Next() {
+                Token token = current_;
+                Advance();
+                return token;
+            }
+
+        private:
+            static bool IsDigit(char c) {
+                return c >= '0' && c <= '9';
+            }
+
+            size_t SkipDigits(size_t pos) const {
+                while (pos < input_.size() && IsDigit(input_[pos])) {
+                    ++pos;
+                }
+                return pos;
+            }
+
+            // NUMBER: UINT EXPONENT? | UINT? '.' UINT EXPONENT?
+            // Like the ANTLR lexer, takes the longest prefix that is a number.
+            size_t ScanNumber(size_t start) const {
+                size_t end = SkipDigits(start);
+                if (end < input_.size() && input_[end] == '.') {
+                    size_t fraction_end = SkipDigits(end + 1);
+                    if (fraction_end > end + 1) {
+                        end = fraction_end;
+                    }
+                }
+                if (end == start) {
+                    throw ParsingError("Error when lexing: unexpected '.'");
+                }
+
+                if (end < input_.size() && (input_[end] == 'e' || input_[end] == 'E')) {
+                    size_t exponent = end + 1;
+                    if (exponent < input_.size() && (input_[exponent] == '+' || input_[exponent] == '-')) {
+                        ++exponent;
+                    }
+                    size_t exponent_end = SkipDigits(exponent);
+                    if (exponent_end > exponent) {
+                        end = exponent_end;
+                    }
+                }
+                return end;
+            }
+
+            // CELL: [A-Z]+[0-9]+, NAME: [A-Z]+
+            size_t ScanWord(size_t start, TokenType& type) const {
+                size_t end = start;
+                while (end < input_.size() && input_[end] >= 'A' && input_[end] <= 'Z') {
+                    ++end;
+                }
+                size_t digits_end = SkipDigits(end);
+                type = digits_end == end ? TokenType::Name : TokenType::Cell;
+                return digits_end;
+            }
+
+            void Advance() {
+                while (pos_ < input_.size() && (input_[pos_] == ' ' || input_[pos_] == '\t'
+                    || input_[pos_] == '\n' || input_[pos_] == '\r')) {
+                    ++pos_;
+                }
+                if (pos_ == input_.size()) {
+                    current_ = { TokenType::End, {} };
+                    return;
+                }
+
+                const size_t start = pos_;
+                const char c = input_[pos_];
+                TokenType type;
+                switch (c) {
+                case '+':
+                    type = TokenType::Add;
+                    ++pos_;
+                    break;
+                case '-':
+                    type = TokenType::Sub;
+                    ++pos_;
+                    break;
+                case '*':
+                    type = TokenType::Mul;
+                    ++pos_;
+                    break;
+                case '/':
+                    type = TokenType::Div;
+                    ++pos_;
+                    break;
+                case '(':
+                    type = TokenType::LeftParen;
+                    ++pos_;
+                    break;
+                case ')':
+                    type = TokenType::RightParen;
+                    ++pos_;
+                    break;
+                case ':':
+                    type = TokenType::Colon;
+                    ++pos_;
+                    break;
+                case ',':
+                    type = TokenType::Comma;
+                    ++pos_;
+                    break;
+                case '=':
+                    type = TokenType::Equal;
+                    ++pos_;
+                    break;
+                case '<':
+                    ++pos_;
+                    if (pos_ < input_.size() && input_[pos_] == '=') {
+                        type = TokenType::LessEqual;
+                        ++pos_;
+                    }
+                    else if (pos_ < input_.size() && input_[pos_] == '>') {
+                        type = TokenType::NotEqual;
+                        ++pos_;
+                    }
+                    else {
+                        type = TokenType::Less;
+                    }
+                    break;
+                case '>':
+                    ++pos_;
+                    if (pos_ < input_.size() && input_[pos_] == '=') {
+                        type = TokenType::GreaterEqual;
+                        ++pos_;
+                    }
+                    else {
+                        type = TokenType::Greater;
+                    }
+                    break;
+                default:
+                    if (IsDigit(c) || c == '.') {
+                        type = TokenType::Number;
+                        pos_ = ScanNumber(pos_);
+                    }
+                    else if (c >= 'A' && c <= 'Z') {
+                        pos_ = ScanWord(pos_, type);
+                    }
+                    else {
+                        throw ParsingError("Error when lexing: unexpected '" + std::string(1, c) + "'");
+                    }
+                }
+                current_ = { type, input_.substr(start, pos_ - start) };
+            }
+
+            std::string_view input_;
+            size_t pos_ = 0;
+            Token current_;
+        };
+
+        // main: expr EOF, with the precedence of the ANTLR alternatives:
+        // parentheses and calls, then unary +/-, then * and /, then binary
+        // + and -, then comparisons.
+        class RecursiveDescentParser {
+        public:
+            explicit RecursiveDescentParser(std::string_view input)
+                : tokens_(input) {
+            }
+
+            FormulaAST Parse() {
+                auto root = ParseComparison();
+                if (tokens_.Peek().type != TokenType::End) {
+                    throw ParsingError("Error when parsing: " + std::string(tokens_.Peek().text));
+                }
+                return FormulaAST(std::move(root), std::move(cells_), std::move(ranges_));
+            }
+
+        private:
+            using TokenType = Tokenizer::TokenType;
+
+            std::unique_ptr<Expr> ParseComparison() {
+                auto lhs = ParseAdditive();
+                for (;;) {
+                    OpCode op;
+                    switch (tokens_.Peek().type) {
+                    case TokenType::Equal:
+                        op = OpCode::Equal;
+                        break;
+                    case TokenType::NotEqual:
+                        op = OpCode::NotEqual;
+                        break;
+                    case TokenType::Less:
+                        op = OpCode::Less;
+                        break;
+                    case TokenType::LessEqual:
+                        op = OpCode::LessEqual;
+                        break;
+                    case TokenType::Greater:
+                        op = OpCode::Greater;
+                        break;
+                    case TokenType::GreaterEqual:
+                        op = OpCode::GreaterEqual;
+                        break;
+                    default:
+                        return lhs;
+                    }
+                    tokens_.Next();
+                    auto rhs = ParseAdditive();
+                    lhs = std::make_unique<ComparisonExpr>(op, std::move(lhs), std::move(rhs));
+                }
+            }
+
+            std::unique_ptr<Expr> ParseAdditive() {
+                auto lhs = ParseMultiplicative();
+                for (;;) {
+                    BinaryOpExpr::Type type;
+                    if (tokens_.Peek().type == TokenType::Add) {
+                        type = BinaryOpExpr::Add;
+                    }
+                    else if (tokens_.Peek().type == TokenType::Sub) {
+                        type = BinaryOpExpr::Subtract;
+                    }
+                    else {
+                        return lhs;
+                    }
+                    tokens_.Next();
+                    auto rhs = ParseMultiplicative();
+                    lhs = std::make_unique<BinaryOpExpr>(type, std::move(lhs), std::move(rhs));
+                }
+            }
+
+            std::unique_ptr<Expr> ParseMultiplicative() {
+                auto lhs = ParseUnary();
+                for (;;) {
+                    BinaryOpExpr::Type type;
+                    if (tokens_.Peek().type == TokenType::Mul) {
+                        type = BinaryOpExpr::Multiply;
+                    }
+                    else if (tokens_.Peek().type == TokenType::Div) {
+                        type = BinaryOpExpr::Divide;
+                    }
+                    else {
+                        return lhs;
+                    }
+                    tokens_.Next();
+                    auto rhs = ParseUnary();
+                    lhs = std::make_unique<BinaryOpExpr>(type, std::move(lhs), std::move(rhs));
+                }
+            }
+
+            std::unique_ptr<Expr> ParseUnary() {
+                UnaryOpExpr::Type type;
+                if (tokens_.Peek().type == TokenType::Add) {
+                    type = UnaryOpExpr::UnaryPlus;
+                }
+                else if (tokens_.Peek().type == TokenType::Sub) {
+                    type = UnaryOpExpr::UnaryMinus;
+                }
+                else {
+                    return ParsePrimary();
+                }
+                tokens_.Next();
+                return std::make_unique<UnaryOpExpr>(type, ParseUnary());
+            }
+
+            std::unique_ptr<Expr> ParsePrimary() {
+                const Tokenizer::Token token = tokens_.Next();
+                switch (token.type) {
+                case TokenType::LeftParen: {
+                    auto expr = ParseComparison();
+                    if (tokens_.Next().type != TokenType::RightParen) {
+                        throw ParsingError("Error when parsing: missing ')'");
+                    }
+                    return expr;
+                }
+                case TokenType::Number:
+                    return std::make_unique<NumberExpr>(ParseNumberLiteral(token.text));
+                case TokenType::Name:
+                    return ParseCall(token.text);
+                case TokenType::Cell: {
+                    auto pos = ParsePosition(token.text);
+                    if (tokens_.Peek().type != TokenType::Colon) {
+                        cells_.push_front(pos);
+                        return std::make_unique<CellExpr>(&cells_.front());
+                    }
+
+                    // CELL ':' CELL
+                    tokens_.Next();
+                    const Tokenizer::Token last = tokens_.Next();
+                    if (last.type != TokenType::Cell) {
+                        throw ParsingError("Error when parsing: " + std::string(last.text));
+                    }
+                    ranges_.push_front(MakeRange(pos, ParsePosition(last.text)));
+                    return std::make_unique<RangeExpr>(&ranges_.front());
+                }
+                default:
+                    throw ParsingError("Error when parsing: " + std::string(token.text));
+                }
+            }
+
+            // NAME '(' (expr (',' expr)*)? ')'
+            std::unique_ptr<Expr> ParseCall(std::string_view name) {
+                if (tokens_.Next().type != TokenType::LeftParen) {
+                    throw ParsingError("Error when parsing: " + std::string(name));
+                }
+
+                std::vector<std::unique_ptr<Expr>> args;
+                if (tokens_.Peek().type != TokenType::RightParen) {
+                    args.push_back(ParseComparison());
+                    while (tokens_.Peek().type == TokenType::Comma) {
+                        tokens_.Next();
+                        args.push_back(ParseComparison());
+                    }
+                }
+                if (tokens_.Next().type != TokenType::RightParen) {
+                    throw ParsingError("Error when parsing: missing ')'");
+                }
+                return std::make_unique<FunctionExpr>(ResolveFunction(name, args.size()), std::move(args));
+            }
+
+            static Position ParsePosition(std::string_view text) {
+                auto pos = Position::FromString(text);
+                if (!pos.IsValid()) {
+                    throw FormulaException("Invalid position: " + std::string(text));
+                }
+                return pos;
+            }
+
+            static double ParseNumberLiteral(std::string_view text) {
+                double value = 0;
+                const char* last = text.data() + text.size();
+                auto [end, error] = std::from_chars(text.data(), last, value);
+                if (error == std::errc() && end == last) {
+                    return value;
+                }
+
+                // out-of-range literals are judged the same way as by the
+                // ANTLR listener
+                std::istringstream in{ std::string(text) };
+                in >> value;
+                if (!in) {
+                    throw ParsingError("Invalid number: " + std::string(text));
+                }
+                return value;
+            }
+
+            Tokenizer tokens_;
+            std::forward_list<Position> cells_;
+            std::forward_list<Range> ranges_;
+        };
+
         class ParseASTListener final : public FormulaBaseListener {
         public:
             std::unique_ptr<Expr> MoveRoot() {
@@ -312,6 +1417,10 @@ namespace ASTImpl {
                 return std::move(cells_);
             }
 
+            std::forward_list<Range> MoveRanges() {
+                return std::move(ranges_);
+            }
+
         public:
             void exitUnaryOp(FormulaParser::UnaryOpContext* ctx) override {
                 assert(args_.size() >= 1);
@@ -356,6 +1465,21 @@ namespace ASTImpl {
                 args_.push_back(std::move(node));
             }
 
+            void exitRange(FormulaParser::RangeContext* ctx) override {
+                Position corners[2];
+                for (size_t i = 0; i < 2; ++i) {
+                    auto value_str = ctx->CELL(i)->getSymbol()->getText();
+                    corners[i] = Position::FromString(value_str);
+                    if (!corners[i].IsValid()) {
+                        throw FormulaException("Invalid position: " + value_str);
+                    }
+                }
+
+                ranges_.push_front(MakeRange(corners[0], corners[1]));
+                auto node = std::make_unique<RangeExpr>(&ranges_.front());
+                args_.push_back(std::move(node));
+            }
+
             void exitBinaryOp(FormulaParser::BinaryOpContext* ctx) override {
                 assert(args_.size() >= 2);
 
@@ -383,6 +1507,51 @@ namespace ASTImpl {
                 args_.back() = std::move(node);
             }
 
+            void exitComparison(FormulaParser::ComparisonContext* ctx) override {
+                assert(args_.size() >= 2);
+
+                auto rhs = std::move(args_.back());
+                args_.pop_back();
+
+                auto lhs = std::move(args_.back());
+
+                OpCode op;
+                if (ctx->EQ()) {
+                    op = OpCode::Equal;
+                }
+                else if (ctx->NE()) {
+                    op = OpCode::NotEqual;
+                }
+                else if (ctx->LT()) {
+                    op = OpCode::Less;
+                }
+                else if (ctx->LE()) {
+                    op = OpCode::LessEqual;
+                }
+                else if (ctx->GT()) {
+                    op = OpCode::Greater;
+                }
+                else {
+                    assert(ctx->GE() != nullptr);
+                    op = OpCode::GreaterEqual;
+                }
+
+                auto node = std::make_unique<ComparisonExpr>(op, std::move(lhs), std::move(rhs));
+                args_.back() = std::move(node);
+            }
+
+            void exitFunction(FormulaParser::FunctionContext* ctx) override {
+                const size_t count = ctx->expr().size();
+                assert(args_.size() >= count);
+
+                std::vector<std::unique_ptr<Expr>> args(
+                    std::make_move_iterator(args_.end() - count), std::make_move_iterator(args_.end()));
+                args_.resize(args_.size() - count);
+
+                auto function = ResolveFunction(ctx->NAME()->getSymbol()->getText(), count);
+                args_.push_back(std::make_unique<FunctionExpr>(function, std::move(args)));
+            }
+
             void visitErrorNode(antlr4::tree::ErrorNode* node) override {
                 throw ParsingError("Error when parsing: " + node->getSymbol()->getText());
             }
@@ -390,6 +1559,7 @@ namespace ASTImpl {
         private:
             std::vector<std::unique_ptr<Expr>> args_;
             std::forward_list<Position> cells_;
+            std::forward_list<Range> ranges_;
         };
 
         class BailErrorListener : public antlr4::BaseErrorListener {
@@ -426,41 +1596,230 @@ FormulaAST ParseFormulaAST(std::istream& in) {
     ASTImpl::ParseASTListener listener;
     tree::ParseTreeWalker::DEFAULT.walk(&listener, tree);
 
-    return FormulaAST(listener.MoveRoot(), listener.MoveCells());
+    return FormulaAST(listener.MoveRoot(), listener.MoveCells(), listener.MoveRanges());
 }
 
-FormulaAST ParseFormulaAST(const std::string& in_str) {
-    std::istringstream in(in_str);
+FormulaAST ParseFormulaAST(const std::string& in_str, FormulaParserBackend backend) {
     try {
-        return ParseFormulaAST(in);
+        if (backend == FormulaParserBackend::Antlr) {
+            std::istringstream in(in_str);
+            return ParseFormulaAST(in);
+        }
+        return ASTImpl::RecursiveDescentParser(in_str).Parse();
     } 
     catch (...) {
         throw FormulaException("Syntactically invalid formula");
     }
 }
 
-void FormulaAST::PrintCells(std::ostream& out) const {
+namespace {
+    void AppendOffset(std::string& key, char tag, int offset) {
+        char buffer[16];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), offset);
+        key += tag;
+        key.append(buffer, result.ptr);
+    }
+}  // namespace
+
+std::optional<std::string> MakeRelativeFormulaKey(std::string_view expression, Position anchor) {
+    using ASTImpl::Tokenizer;
+
+    std::string key;
+    key.reserve(expression.size() + 16);
+    try {
+        Tokenizer tokens(expression);
+        while (tokens.Peek().type != Tokenizer::TokenType::End) {
+            const Tokenizer::Token token = tokens.Next();
+            if (token.type != Tokenizer::TokenType::Cell) {
+                key += token.text;
+            }
+            else {
+                Position pos = Position::FromString(token.text);
+                if (!pos.IsValid()) {
+                    return std::nullopt;
+                }
+
+                // R<row offset>C<col offset>, as in the R1C1 notation
+                AppendOffset(key, 'R', pos.row - anchor.row);
+                AppendOffset(key, 'C', pos.col - anchor.col);
+            }
+            key += ' ';
+        }
+    }
+    catch (const ParsingError&) {
+        return std::nullopt;
+    }
+    return key;
+}
+
+void FormulaAST::PrintCells(std::ostream& out, Position anchor) const {
     for (auto cell : cells_) {
-        out << cell.ToString() << ' ';
+        out << ASTImpl::Shift(cell, anchor).ToString() << ' ';
     }
 }
 
-void FormulaAST::Print(std::ostream& out) const {
-    root_expr_->Print(out);
+void FormulaAST::Print(std::ostream& out, Position anchor) const {
+    assert(root_expr_);
+    root_expr_->Print(out, anchor);
+}
+
+void FormulaAST::PrintFormula(std::ostream& out, Position anchor) const {
+    assert(root_expr_);
+    root_expr_->PrintFormula(out, ASTImpl::EP_ATOM, anchor);
+}
+
+void FormulaAST::MakeRelativeTo(Position anchor) {
+    for (Position& cell : cells_) {
+        cell = { cell.row - anchor.row, cell.col - anchor.col };
+    }
+    for (Position& cell : program_.cells) {
+        cell = { cell.row - anchor.row, cell.col - anchor.col };
+    }
+    const Position back{ -anchor.row, -anchor.col };
+    for (Range& range : ranges_) {
+        range = ASTImpl::Shift(range, back);
+    }
+    for (Range& range : program_.ranges) {
+        range = ASTImpl::Shift(range, back);
+    }
 }
 
-void FormulaAST::PrintFormula(std::ostream& out) const {
-    root_expr_->PrintFormula(out, ASTImpl::EP_ATOM);
+FormulaAST::Value FormulaAST::Execute(const SheetInterface& args, Position anchor) const {
+    using ASTImpl::OpCode;
+
+    constexpr size_t INLINE_DEPTH = 32;
+    double inline_stack[INLINE_DEPTH];
+    std::vector<double> heap_stack;
+    double* top = inline_stack;
+    if (program_.max_depth > INLINE_DEPTH) {
+        heap_stack.resize(program_.max_depth);
+        top = heap_stack.data();
+    }
+
+    // top points past the last value on the stack
+    const std::vector<ASTImpl::Instruction>& code = program_.code;
+    for (size_t pc = 0; pc < code.size(); ++pc) {
+        const ASTImpl::Instruction& instruction = code[pc];
+        switch (instruction.op) {
+        case OpCode::PushNumber:
+            *top++ = program_.numbers[instruction.arg];
+            break;
+        case OpCode::PushCell:
+            *top++ = ASTImpl::GetCellValue(args, ASTImpl::Shift(program_.cells[instruction.arg], anchor));
+            break;
+        case OpCode::PushRange:
+            *top++ = ASTImpl::GetRangeValue(args, ASTImpl::Shift(program_.ranges[instruction.arg], anchor));
+            break;
+        case OpCode::PairValue:
+            top[-1] = ASTImpl::ToPartial(instruction.function, top[-1]);
+            *top++ = 1.0;
+            break;
+        case OpCode::PushRangePair: {
+            auto [partial, count] = ASTImpl::GetRangePair(args,
+                ASTImpl::Shift(program_.ranges[instruction.arg], anchor), instruction.function);
+            *top++ = partial;
+            *top++ = count;
+            break;
+        }
+        case OpCode::Aggregate: {
+            top -= 2 * instruction.arg;
+            ASTImpl::Aggregator aggregator(instruction.function);
+            for (size_t i = 0; i < instruction.arg; ++i) {
+                aggregator.Merge(top[2 * i], top[2 * i + 1]);
+            }
+            *top++ = aggregator.Result();
+            break;
+        }
+        case OpCode::Negate:
+            top[-1] = -top[-1];
+            break;
+        case OpCode::Add:
+            --top;
+            top[-1] = ASTImpl::CheckFinite(top[-1] + top[0], top[-1], top[0]);
+            break;
+        case OpCode::Subtract:
+            --top;
+            top[-1] = ASTImpl::CheckFinite(top[-1] - top[0], top[-1], top[0]);
+            break;
+        case OpCode::Multiply:
+            --top;
+            top[-1] = ASTImpl::CheckFinite(top[-1] * top[0], top[-1], top[0]);
+            break;
+        case OpCode::Divide:
+            --top;
+            top[-1] = ASTImpl::CheckFinite(top[-1] / top[0], top[-1], top[0]);
+            break;
+        case OpCode::Equal:
+        case OpCode::NotEqual:
+        case OpCode::Less:
+        case OpCode::LessEqual:
+        case OpCode::Greater:
+        case OpCode::GreaterEqual:
+            --top;
+            top[-1] = ASTImpl::Compare(instruction.op, top[-1], top[0]);
+            break;
+        case OpCode::JumpUnless:
+            if (std::isnan(top[-1])) {
+                // the error is the value of IF: skip the else branch by
+                // following the Jump that ends the then branch
+                pc = code[instruction.arg - 1].arg - 1;
+            }
+            else if (*--top == 0) {
+                pc = instruction.arg - 1;
+            }
+            break;
+        case OpCode::Jump:
+            pc = instruction.arg - 1;
+            break;
+        }
+    }
+
+    return ASTImpl::ToValue(top[-1]);
 }
 
-double FormulaAST::Execute(const SheetInterface& args) const {
-    return root_expr_->Evaluate(args);
+FormulaAST::Value FormulaAST::ExecuteTree(const SheetInterface& args, Position anchor) const {
+    assert(root_expr_);
+    return ASTImpl::ToValue(root_expr_->Evaluate(args, anchor));
 }
 
-FormulaAST::FormulaAST(std::unique_ptr<ASTImpl::Expr> root_expr, std::forward_list<Position> cells)
+FormulaAST::FormulaAST(std::unique_ptr<ASTImpl::Expr> root_expr, std::forward_list<Position> cells,
+    std::forward_list<Range> ranges)
     : root_expr_(std::move(root_expr))
-    , cells_(std::move(cells)) {
+    , cells_(std::move(cells))
+    , ranges_(std::move(ranges)) {
     cells_.sort();  // to avoid sorting in GetReferencedCells
+    ranges_.sort();
+
+    root_expr_->Compile(program_);
+    const std::optional<size_t> max_depth = ASTImpl::GetMaxDepth(program_);
+    assert(max_depth);
+    program_.max_depth = *max_depth;
+}
+
+FormulaAST::FormulaAST(ASTImpl::Program program, std::forward_list<Position> cells,
+    std::forward_list<Range> ranges)
+    : program_(std::move(program))
+    , cells_(std::move(cells))
+    , ranges_(std::move(ranges)) {
+    auto is_offset = [](Position offset) {
+        return std::abs(offset.row) < Position::MAX_ROWS && std::abs(offset.col) < Position::MAX_COLS;
+    };
+    auto is_range_offset = [&is_offset](const Range& range) {
+        return is_offset(range.from) && is_offset(range.to);
+    };
+    const bool valid = std::all_of(cells_.begin(), cells_.end(), is_offset)
+        && std::all_of(ranges_.begin(), ranges_.end(), is_range_offset)
+        && std::all_of(program_.cells.begin(), program_.cells.end(), is_offset)
+        && std::all_of(program_.ranges.begin(), program_.ranges.end(), is_range_offset);
+    std::optional<size_t> max_depth = ASTImpl::GetMaxDepth(program_);
+    if (!valid || !max_depth) {
+        throw std::invalid_argument("Malformed formula program");
+    }
+    program_.max_depth = *max_depth;
+    cells_.sort();
+    ranges_.sort();
 }
 
+FormulaAST::FormulaAST(FormulaAST&&) = default;
+FormulaAST& FormulaAST::operator=(FormulaAST&&) = default;
 FormulaAST::~FormulaAST() = default;
@@ -3,12 +3,73 @@
 #include "FormulaLexer.h"
 #include "common.h"
 
+#include <cstdint>
 #include <forward_list>
 #include <functional>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
 
 namespace ASTImpl {
     class Expr;
+
+    // Built-in functions. Names are resolved to these while parsing, so a
+    // call costs no lookup when the formula is evaluated.
+    enum class Function : std::uint8_t {
+        Sum,
+        Min,
+        Max,
+        Average,
+        And,
+        Or,
+        Count,
+        If,
+    };
+
+    enum class OpCode : std::uint8_t {
+        PushNumber,  // push numbers[arg]
+        PushCell,    // push the value of cells[arg]
+        PushRange,   // push the value of ranges[arg] as a single value
+        // Arguments of an aggregate function are passed as pairs of a
+        // partial result and the number of values it covers.
+        PairValue,      // make the value on top a pair for the function with the count 1
+        PushRangePair,  // push the pair of ranges[arg] for the function
+        Aggregate,      // replace arg pairs with the result of the function
+        Negate,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        // pop the condition and jump to arg if it is false; an error
+        // condition jumps past the else branch and stays as the result
+        JumpUnless,
+        Jump,  // jump to arg
+    };
+
+    struct Instruction {
+        OpCode op;
+        Function function = Function::Sum;  // for the aggregate opcodes
+        std::uint32_t arg = 0;
+    };
+
+    // The expression lowered to a flat postfix program, which is run
+    // by a stack machine instead of walking the tree.
+    struct Program {
+        std::vector<Instruction> code;
+        std::vector<double> numbers;
+        std::vector<Position> cells;
+        std::vector<Range> ranges;
+        size_t max_depth = 0;
+    };
 }
 
 class ParsingError : public std::runtime_error {
@@ -18,16 +79,37 @@ class ParsingError : public std::runtime_error {
 class FormulaAST {
 public:
     explicit FormulaAST(std::unique_ptr<ASTImpl::Expr> root_expr,
-        std::forward_list<Position> cells);
-    FormulaAST(FormulaAST&&) = default;
-    FormulaAST& operator=(FormulaAST&&) = default;
+        std::forward_list<Position> cells, std::forward_list<Range> ranges);
+    // Restores a formula from its compiled program, as saved in a sheet
+    // snapshot, with the cells and ranges of GetCells() and GetRanges().
+    // There is no tree: the formula runs with Execute() but can't be printed
+    // or walked. Throws std::invalid_argument if the program is malformed.
+    FormulaAST(ASTImpl::Program program, std::forward_list<Position> cells, std::forward_list<Range> ranges);
+    FormulaAST(FormulaAST&&);
+    FormulaAST& operator=(FormulaAST&&);
     ~FormulaAST();
 
-    double Execute(const SheetInterface& args) const;
-    void PrintCells(std::ostream& out) const;
-    void Print(std::ostream& out) const;
-    void PrintFormula(std::ostream& out) const;
+    // Either the number or the error the evaluation ran into; errors
+    // are returned, never thrown.
+    using Value = std::variant<double, FormulaError>;
 
+    // The anchor is the cell the formula belongs to. It only matters after
+    // MakeRelativeTo(): before that the positions are absolute and the
+    // default anchor A1 leaves them as they are.
+    Value Execute(const SheetInterface& args, Position anchor = {}) const;
+    // Evaluates the expression by walking the tree; Execute() runs the
+    // compiled program and gives the same result.
+    Value ExecuteTree(const SheetInterface& args, Position anchor = {}) const;
+    void PrintCells(std::ostream& out, Position anchor = {}) const;
+    void Print(std::ostream& out, Position anchor = {}) const;
+    void PrintFormula(std::ostream& out, Position anchor = {}) const;
+
+    // Stores the referenced cells and ranges as offsets from the anchor, so
+    // that one AST serves every cell holding the same formula pattern, like
+    // =A1*B1 in C1 and =A2*B2 in C2.
+    void MakeRelativeTo(Position anchor);
+
+    // The positions are offsets if MakeRelativeTo() has been called.
     std::forward_list<Position>& GetCells() {
         return cells_;
     }
@@ -36,14 +118,42 @@ public:
         return cells_;
     }
 
+    // Ranges are kept whole, their cells are not in GetCells().
+    const std::forward_list<Range>& GetRanges() const {
+        return ranges_;
+    }
+
+    const ASTImpl::Program& GetProgram() const {
+        return program_;
+    }
+
 private:
     std::unique_ptr<ASTImpl::Expr> root_expr_;
+    ASTImpl::Program program_;
 
     // physically stores cells so that they can be
     // efficiently traversed without going through
     // the whole AST
     std::forward_list<Position> cells_;
+    std::forward_list<Range> ranges_;
 };
 
+enum class FormulaParserBackend {
+    // hand-written recursive descent parser, the default
+    Native,
+    // the parser generated by ANTLR from Formula.g4, kept as the reference
+    Antlr,
+};
+
+// Parses with the ANTLR-generated parser.
 FormulaAST ParseFormulaAST(std::istream& in);
-FormulaAST ParseFormulaAST(const std::string& in_str);
+// Throws FormulaException if the formula is syntactically invalid.
+FormulaAST ParseFormulaAST(const std::string& in_str,
+    FormulaParserBackend backend = FormulaParserBackend::Native);
+
+// Builds the key under which a compiled formula is shared: its tokens with
+// the cell references written as offsets from the anchor. Formulas with
+// equal keys parse to the same relative AST. Returns nullopt if the
+// expression can't be tokenized or references an invalid cell; parsing
+// it reports the error.
+std::optional<std::string> MakeRelativeFormulaKey(std::string_view expression, Position anchor);
@@ -1,7 +0,0 @@
-
-// Generated from Formula.g4 by ANTLR 4.13.0
-
-
-#include "FormulaListener.h"
-
-
@@ -0,0 +1,233 @@
+#include "aggregate_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC и Clang генерируют код для расширений только в функциях с атрибутом
+// target, MSVC разрешает intrinsics без него.
+#if defined(__GNUC__) || defined(__clang__)
+#define KERNELS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define KERNELS_TARGET(isa)
+#endif
+
+namespace kernels {
+
+namespace {
+
+constexpr size_t LANES = 8;
+
+// Промежуточное состояние свёртки. Значение с индексом i прибавляется
+// к слагаемому sums[i % LANES].
+struct Accumulator {
+    double sums[LANES] = {};
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    size_t errors = 0;
+    size_t first_error = Reduction::NPOS;
+
+    // mask - ошибки среди LANES значений, начиная с индекса first
+    void AddErrors(unsigned mask, size_t first) {
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            if (mask & (1u << lane)) {
+                ++errors;
+                first_error = std::min(first_error, first + lane);
+            }
+        }
+    }
+};
+
+// Обрабатывает значения с индексами [begin, count), продолжая разбиение
+// по слагаемым.
+void ReduceTail(const double* values, size_t begin, size_t count, Accumulator& acc) {
+    for (size_t i = begin; i < count; ++i) {
+        const double value = values[i];
+        if (std::isnan(value)) {
+            ++acc.errors;
+            acc.first_error = std::min(acc.first_error, i);
+            continue;
+        }
+        acc.sums[i % LANES] += value;
+        acc.min = std::min(acc.min, value);
+        acc.max = std::max(acc.max, value);
+    }
+}
+
+Reduction Finish(const Accumulator& acc, size_t count) {
+    const double* s = acc.sums;
+    Reduction result;
+    // тот же порядок, что у попарного сложения векторов из LANES / 2 слагаемых
+    result.sum = ((s[0] + s[4]) + (s[2] + s[6])) + ((s[1] + s[5]) + (s[3] + s[7]));
+    result.min = acc.min;
+    result.max = acc.max;
+    result.numbers = count - acc.errors;
+    result.first_error = acc.first_error;
+    return result;
+}
+
+Reduction ReduceScalar(const double* values, size_t count) {
+    Accumulator acc;
+    double sums[LANES] = {};
+    double min = acc.min;
+    double max = acc.max;
+
+    const size_t end = count - count % LANES;
+    for (size_t i = 0; i < end; i += LANES) {
+        unsigned mask = 0;
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            const double value = values[i + lane];
+            mask |= static_cast<unsigned>(value != value) << lane;
+            sums[lane] += value;
+            min = min < value ? min : value;
+            max = max > value ? max : value;
+        }
+        if (mask != 0) {
+            acc.AddErrors(mask, i);
+        }
+    }
+
+    std::copy(sums, sums + LANES, acc.sums);
+    acc.min = min;
+    acc.max = max;
+    ReduceTail(values, end, count, acc);
+    return Finish(acc, count);
+}
+
+#if defined(KERNELS_X86)
+
+KERNELS_TARGET("sse2")
+Reduction ReduceSse2(const double* values, size_t count) {
+    Accumulator acc;
+    __m128d sums[4] = { _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd() };
+    __m128d min = _mm_set1_pd(acc.min);
+    __m128d max = _mm_set1_pd(acc.max);
+
+    const size_t end = count - count % LANES;
+    for (size_t i = 0; i < end; i += LANES) {
+        __m128d v[4];
+        unsigned mask = 0;
+        for (int j = 0; j < 4; ++j) {
+            v[j] = _mm_loadu_pd(values + i + 2 * j);
+            mask |= static_cast<unsigned>(_mm_movemask_pd(_mm_cmpunord_pd(v[j], v[j]))) << (2 * j);
+            sums[j] = _mm_add_pd(sums[j], v[j]);
+        }
+        // попарно, чтобы не выстраивать минимум в длинную цепочку зависимостей
+        min = _mm_min_pd(min, _mm_min_pd(_mm_min_pd(v[0], v[1]), _mm_min_pd(v[2], v[3])));
+        max = _mm_max_pd(max, _mm_max_pd(_mm_max_pd(v[0], v[1]), _mm_max_pd(v[2], v[3])));
+        if (mask != 0) {
+            acc.AddErrors(mask, i);
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        _mm_storeu_pd(acc.sums + 2 * j, sums[j]);
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, min);
+    acc.min = std::min(lanes[0], lanes[1]);
+    _mm_storeu_pd(lanes, max);
+    acc.max = std::max(lanes[0], lanes[1]);
+
+    ReduceTail(values, end, count, acc);
+    return Finish(acc, count);
+}
+
+KERNELS_TARGET("avx2")
+Reduction ReduceAvx2(const double* values, size_t count) {
+    Accumulator acc;
+    __m256d sums[2] = { _mm256_setzero_pd(), _mm256_setzero_pd() };
+    __m256d min = _mm256_set1_pd(acc.min);
+    __m256d max = _mm256_set1_pd(acc.max);
+
+    const size_t end = count - count % LANES;
+    for (size_t i = 0; i < end; i += LANES) {
+        const __m256d lo = _mm256_loadu_pd(values + i);
+        const __m256d hi = _mm256_loadu_pd(values + i + 4);
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(lo, lo, _CMP_UNORD_Q)))
+            | static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(hi, hi, _CMP_UNORD_Q))) << 4;
+        sums[0] = _mm256_add_pd(sums[0], lo);
+        sums[1] = _mm256_add_pd(sums[1], hi);
+        min = _mm256_min_pd(min, _mm256_min_pd(lo, hi));
+        max = _mm256_max_pd(max, _mm256_max_pd(lo, hi));
+        if (mask != 0) {
+            acc.AddErrors(mask, i);
+        }
+    }
+
+    _mm256_storeu_pd(acc.sums, sums[0]);
+    _mm256_storeu_pd(acc.sums + 4, sums[1]);
+    double lanes[4];
+    _mm256_storeu_pd(lanes, min);
+    acc.min = std::min({ lanes[0], lanes[1], lanes[2], lanes[3] });
+    _mm256_storeu_pd(lanes, max);
+    acc.max = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+
+    ReduceTail(values, end, count, acc);
+    return Finish(acc, count);
+}
+
+#endif  // KERNELS_X86
+
+SimdLevel DetectSimdLevel() {
+#if defined(KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::Sse2;
+    }
+#elif defined(KERNELS_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] >> 26) & 1;
+    const bool os_saves_ymm = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1)
+        && (_xgetbv(0) & 6) == 6;
+    if (os_saves_ymm && max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        if ((info[1] >> 5) & 1) {
+            return SimdLevel::Avx2;
+        }
+    }
+    if (sse2) {
+        return SimdLevel::Sse2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+}  // namespace
+
+SimdLevel GetSimdLevel() {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+Reduction Reduce(const double* values, size_t count) {
+    return Reduce(GetSimdLevel(), values, count);
+}
+
+Reduction Reduce(SimdLevel level, const double* values, size_t count) {
+    switch (level) {
+#if defined(KERNELS_X86)
+    case SimdLevel::Avx2:
+        return ReduceAvx2(values, count);
+    case SimdLevel::Sse2:
+        return ReduceSse2(values, count);
+#endif
+    default:
+        return ReduceScalar(values, count);
+    }
+}
+
+}  // namespace kernels
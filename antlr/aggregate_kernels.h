@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Векторные свёртки для агрегатных функций формул. На вход подаётся
+// непрерывный массив значений ячеек, в котором ошибки, в том числе текст, не
+// являющийся числом, записаны как NaN - так же, как при вычислении формул.
+// Реализация выбирается по возможностям процессора: AVX2, SSE2 или скалярная.
+// Сумма набирается в восьми независимых слагаемых, которые складываются в
+// одном и том же порядке во всех реализациях, поэтому результат от выбранной
+// реализации не зависит.
+namespace kernels {
+
+enum class SimdLevel {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+struct Reduction {
+    static constexpr size_t NPOS = SIZE_MAX;
+
+    // Если в массиве есть ошибки, sum, min и max не определены.
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    // количество значений, не являющихся ошибками
+    size_t numbers = 0;
+    // индекс первой ошибки либо NPOS
+    size_t first_error = NPOS;
+};
+
+// Лучший уровень, который поддерживает процессор. Определяется один раз.
+SimdLevel GetSimdLevel();
+
+// Свёртка реализацией лучшего уровня.
+Reduction Reduce(const double* values, size_t count);
+
+// Свёртка реализацией заданного уровня, который не выше GetSimdLevel().
+// Нужна для тестов и бенчмарков.
+Reduction Reduce(SimdLevel level, const double* values, size_t count);
+
+}  // namespace kernels
@@ -0,0 +1,113 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "aggregate_kernels.h"
+#include "common.h"
+#include "formula.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int COLUMNS = 64;
+constexpr size_t VALUES = static_cast<size_t>(COLUMNS) * Position::MAX_ROWS;  // 1M
+
+// В листе столбец не длиннее MAX_ROWS строк, поэтому миллион значений - это
+// 64 полных столбца. Чтение по одной ячейке через GetCell сравнивается
+// с формулой SUM над тем же диапазоном без кеша столбцов и с ним.
+void BenchSheet() {
+    auto sheet = CreateSheet();
+    for (int col = 0; col < COLUMNS; ++col) {
+        for (int row = 0; row < Position::MAX_ROWS; ++row) {
+            sheet->SetCell({ row, col }, std::to_string((row + col) % 1000));
+        }
+    }
+    const Range range{ { 0, 0 }, { Position::MAX_ROWS - 1, COLUMNS - 1 } };
+
+    double sum = 0.0;
+    double seconds = bench::MeasureSeconds([&] {
+        for (int col = 0; col < COLUMNS; ++col) {
+            for (int row = 0; row < Position::MAX_ROWS; ++row) {
+                const auto value = sheet->GetCell({ row, col })->GetNumericValue();
+                if (const double* number = std::get_if<double>(&value)) {
+                    sum += *number;
+                }
+            }
+        }
+    });
+    bench::DoNotOptimize(sum);
+    bench::Report("1M cells SUM", "GetCell", seconds);
+
+    // Пока на столбцы не ссылается ни одна формула листа, диапазон читается
+    // по ячейкам. Формула в ячейке заводит для них кеш значений столбцов.
+    auto formula = ParseFormula("SUM(" + range.ToString() + ")");
+    FormulaInterface::Value value;
+    seconds = bench::MeasureSeconds([&] {
+        value = formula->Evaluate(*sheet);
+    });
+    bench::DoNotOptimize(value);
+    bench::Report("1M cells SUM", "SUM(range)", seconds);
+
+    seconds = bench::MeasureSeconds([&] {
+        sheet->SetCell({ 0, COLUMNS }, "=SUM(" + range.ToString() + ")");
+    });
+    bench::Report("1M cells column cache build", "SetCell", seconds);
+
+    seconds = bench::MeasureSeconds([&] {
+        value = formula->Evaluate(*sheet);
+    });
+    bench::DoNotOptimize(value);
+    bench::Report("1M cells SUM", "column cache", seconds);
+}
+
+// Сами свёртки на массиве из миллиона значений в сравнении с поэлементным
+// циклом, который проверяет каждое значение на ошибку.
+void BenchKernels() {
+    std::vector<double> values(VALUES);
+    for (size_t i = 0; i < VALUES; ++i) {
+        values[i] = static_cast<double>(i % 1000) * 0.5;
+    }
+
+    constexpr int REPEATS = 20;
+    double sum = 0.0;
+    double seconds = bench::MeasureSeconds([&] {
+        for (int repeat = 0; repeat < REPEATS; ++repeat) {
+            for (double value : values) {
+                if (std::isnan(value)) {
+                    break;
+                }
+                sum += value;
+            }
+        }
+    });
+    bench::DoNotOptimize(sum);
+    bench::Report("1M values x20 reduce", "per value", seconds);
+
+    const std::pair<kernels::SimdLevel, std::string_view> levels[] = {
+        { kernels::SimdLevel::Scalar, "kernel scalar" },
+        { kernels::SimdLevel::Sse2, "kernel sse2" },
+        { kernels::SimdLevel::Avx2, "kernel avx2" },
+    };
+    for (const auto& [level, name] : levels) {
+        if (level > kernels::GetSimdLevel()) {
+            continue;
+        }
+        kernels::Reduction reduction;
+        seconds = bench::MeasureSeconds([&] {
+            for (int repeat = 0; repeat < REPEATS; ++repeat) {
+                reduction = kernels::Reduce(level, values.data(), values.size());
+            }
+        });
+        bench::DoNotOptimize(reduction.sum);
+        bench::Report("1M values x20 reduce", name, seconds);
+    }
+}
+
+}  // namespace
+
+void BenchAggregates() {
+    BenchSheet();
+    BenchKernels();
+}
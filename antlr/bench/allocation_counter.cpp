@@ -0,0 +1,62 @@
+#include "bench_utils.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Замена глобальных operator new/delete, которая считает занятую в куче
+// память. Перед блоком хранится его размер.
+namespace {
+
+constexpr size_t HEADER = alignof(std::max_align_t);
+
+std::atomic<size_t> allocated_bytes{ 0 };
+
+void* Allocate(size_t size) {
+    void* block = std::malloc(size + HEADER);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    return static_cast<char*>(block) + HEADER;
+}
+
+void Deallocate(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(ptr) - HEADER;
+    allocated_bytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+}  // namespace
+
+size_t bench::AllocatedBytes() {
+    return allocated_bytes.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    Deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    Deallocate(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    Deallocate(ptr);
+}
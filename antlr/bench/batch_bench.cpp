@@ -0,0 +1,88 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int INPUT_COLS = 6;
+using Cells = std::vector<std::pair<Position, std::string>>;
+
+// Шесть столбцов чисел, по строке - формула над ними и сумма всего столбца
+// формул: каждое число входит в два конуса зависимых.
+Cells MakeFormulas() {
+    Cells cells;
+    for (int row = 0; row < Position::MAX_ROWS; ++row) {
+        std::string formula = "=";
+        for (int col = 0; col < INPUT_COLS; ++col) {
+            formula += (col == 0 ? "" : "+") + Position{ row, col }.ToString();
+        }
+        cells.push_back({ { row, INPUT_COLS }, formula });
+    }
+    cells.push_back({ { 0, INPUT_COLS + 1 },
+        "=SUM(" + Range{ { 0, INPUT_COLS }, { Position::MAX_ROWS - 1, INPUT_COLS } }.ToString() + ")" });
+    return cells;
+}
+
+Cells MakeInputs(int seed) {
+    Cells cells;
+    for (int row = 0; row < Position::MAX_ROWS; ++row) {
+        for (int col = 0; col < INPUT_COLS; ++col) {
+            cells.push_back({ { row, col }, std::to_string((row * 7 + col + seed) % 100) });
+        }
+    }
+    return cells;
+}
+
+// Цепочка формул, каждая ссылается на предыдущую. При вставке формулы по
+// одной проверка на циклы обходит всех зависимых от неё - всю оставшуюся
+// цепочку.
+Cells MakeChain(int length, int step) {
+    Cells cells{ { { 0, INPUT_COLS + 2 }, "1" } };
+    for (int row = 1; row < length; ++row) {
+        cells.push_back({ { row, INPUT_COLS + 2 },
+            "=" + Position{ row - 1, INPUT_COLS + 2 }.ToString() + "+" + std::to_string(step) });
+    }
+    return cells;
+}
+
+void Bench(std::string_view variant, void (*apply)(SheetInterface&, const Cells&)) {
+    auto sheet = CreateSheet();
+    const Cells formulas = MakeFormulas();
+    bench::Report("16k formulas load", variant, bench::MeasureSeconds([&] {
+        apply(*sheet, formulas);
+    }));
+
+    sheet->Recalculate();
+    const Cells inputs = MakeInputs(1);
+    bench::Report("98k inputs paste", variant, bench::MeasureSeconds([&] {
+        apply(*sheet, inputs);
+    }));
+    bench::Report("98k inputs paste recalc", variant, bench::MeasureSeconds([&] {
+        sheet->Recalculate();
+    }));
+
+    constexpr int CHAIN = 8192;
+    apply(*sheet, MakeChain(CHAIN, 1));
+    const Cells chain = MakeChain(CHAIN, 2);
+    bench::Report("8k formula chain paste", variant, bench::MeasureSeconds([&] {
+        apply(*sheet, chain);
+    }));
+}
+
+}  // namespace
+
+void BenchBatch() {
+    Bench("SetCell", [](SheetInterface& sheet, const Cells& cells) {
+        for (const auto& [pos, text] : cells) {
+            sheet.SetCell(pos, text);
+        }
+    });
+    Bench("SetCells", [](SheetInterface& sheet, const Cells& cells) {
+        sheet.SetCells(cells);
+    });
+}
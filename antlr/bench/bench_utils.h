@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+
+namespace bench {
+
+// Возвращает время выполнения f в секундах.
+template <typename F>
+double MeasureSeconds(F&& f) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    f();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+inline void Report(std::string_view name, std::string_view variant, double seconds) {
+    std::cout << std::left << std::setw(40) << name << std::setw(16) << variant
+        << std::right << std::fixed << std::setprecision(1) << seconds * 1000 << " ms" << std::endl;
+}
+
+inline void Report(std::string_view name, std::string_view variant, double value, std::string_view unit) {
+    std::cout << std::left << std::setw(40) << name << std::setw(16) << variant
+        << std::right << std::fixed << std::setprecision(1) << value << ' ' << unit << std::endl;
+}
+
+// Объём памяти, занятой в куче через operator new, в байтах.
+size_t AllocatedBytes();
+
+// Не даёт компилятору выбросить вычисление результата.
+template <typename T>
+void DoNotOptimize(const T& value) {
+    static volatile const void* sink;
+    sink = &value;
+    (void)sink;
+}
+
+}  // namespace bench
@@ -0,0 +1,20 @@
+#pragma once
+
+// Каждый бенчмарк печатает результаты в std::cout.
+void BenchStorage();
+void BenchPrint();
+void BenchFormula();
+void BenchErrors();
+void BenchParse();
+void BenchRecalculate();
+void BenchGraph();
+void BenchRanges();
+void BenchAggregates();
+void BenchBatch();
+void BenchImport();
+void BenchSnapshot();
+void BenchReads();
+void BenchViews();
+void BenchForks();
+void BenchFrozen();
+void BenchConcurrentWriters();
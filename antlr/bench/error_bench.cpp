@@ -0,0 +1,61 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+
+#include <string>
+
+namespace {
+
+constexpr int DEPENDENTS = 100'000;
+constexpr int ROWS = 10'000;
+
+Position First(int i) {
+    return { i % ROWS, 1 + i / ROWS };
+}
+
+Position Second(int i) {
+    return { i % ROWS, 1 + DEPENDENTS / ROWS + i / ROWS };
+}
+
+// A1 -> 100000 ячеек -> ещё 100000 ячеек: ошибка в A1 доходит до каждой из них.
+std::unique_ptr<SheetInterface> MakeFanOut() {
+    auto sheet = CreateSheet();
+    sheet->SetCell({ 0, 0 }, "1");
+    for (int i = 0; i < DEPENDENTS; ++i) {
+        const std::string first = First(i).ToString();
+        sheet->SetCell(First(i), "=A1+" + std::to_string(i));
+        sheet->SetCell(Second(i), "=" + first + "*2-" + first);
+    }
+    return sheet;
+}
+
+double Recalculate(SheetInterface& sheet, const std::string& source) {
+    return bench::MeasureSeconds([&] {
+        sheet.SetCell({ 0, 0 }, source);
+        for (int i = 0; i < DEPENDENTS; ++i) {
+            bench::DoNotOptimize(sheet.GetCell(Second(i))->GetValue());
+        }
+    });
+}
+
+}  // namespace
+
+void BenchErrors() {
+    auto sheet = MakeFanOut();
+    bench::Report("fan-out 1 -> 100000 -> 100000", "numeric source", Recalculate(*sheet, "=1"));
+    bench::Report("fan-out 1 -> 100000 -> 100000", "#DIV/0! source", Recalculate(*sheet, "=1/0"));
+    bench::Report("fan-out 1 -> 100000 -> 100000", "#VALUE! source", Recalculate(*sheet, "text"));
+
+    // Столько стоило бы раскрутить стек по исключению в каждой зависимой ячейке.
+    bench::Report("throw+catch x200000", "exceptions", bench::MeasureSeconds([] {
+        for (int i = 0; i < 2 * DEPENDENTS; ++i) {
+            try {
+                throw FormulaError(FormulaError::Category::Div0);
+            }
+            catch (const FormulaError& error) {
+                bench::DoNotOptimize(error);
+            }
+        }
+    }));
+}
@@ -0,0 +1,91 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int ROWS = 8192;
+constexpr int COLS = 16;
+constexpr int FORKS = 100;
+// полные копии занимают столько же памяти, сколько лист, их меньше
+constexpr int REBUILDS = 4;
+
+// Столбец чисел, строки формул над ним и сумма столбца.
+std::vector<std::pair<Position, std::string>> MakeCells() {
+    std::vector<std::pair<Position, std::string>> cells;
+    cells.reserve(ROWS * COLS + 1);
+    for (int row = 0; row < ROWS; ++row) {
+        cells.emplace_back(Position{ row, 0 }, std::to_string(row));
+        for (int col = 1; col < COLS; ++col) {
+            cells.emplace_back(Position{ row, col }, "=" + Position{ row, col - 1 }.ToString() + "*2+1");
+        }
+    }
+    cells.emplace_back(Position{ 0, COLS }, "=SUM(A1:A" + std::to_string(ROWS) + ")");
+    return cells;
+}
+
+// Каждая копия меняет одно число, что пересчитывает строку формул и сумму.
+template <typename MakeCopy>
+void BenchCopies(std::string_view variant, int count, SheetInterface& sheet, MakeCopy make_copy) {
+    std::vector<std::unique_ptr<SheetInterface>> copies;
+    copies.reserve(count);
+    const size_t heap_before = bench::AllocatedBytes();
+    const double seconds = bench::MeasureSeconds([&] {
+        for (int i = 0; i < count; ++i) {
+            copies.push_back(make_copy(sheet));
+            copies.back()->SetCell({ i * 97 % ROWS, 0 }, std::to_string(-i));
+            copies.back()->Recalculate();
+        }
+    });
+    const size_t bytes = bench::AllocatedBytes() - heap_before;
+
+    const std::string name = std::to_string(ROWS * COLS / 1000) + "k cells, copy+edit";
+    bench::Report(name, variant, seconds / count * 1000, "ms/copy");
+    bench::Report(name, variant, static_cast<double>(bytes) / count / 1024, "KiB/copy");
+}
+
+}  // namespace
+
+void BenchForks() {
+    const auto cells = MakeCells();
+    auto sheet = CreateSheet();
+    sheet->SetCells(cells);
+    sheet->Recalculate();
+
+    // полная копия: все тексты заново
+    BenchCopies("rebuild", REBUILDS, *sheet, [&cells](SheetInterface& /* sheet */) {
+        auto copy = CreateSheet();
+        copy->SetCells(cells);
+        copy->Recalculate();
+        return copy;
+    });
+
+    // первая копия берёт состояние листа и строит его обратные ссылки
+    double first_seconds = bench::MeasureSeconds([&] {
+        auto fork = sheet->Fork();
+        fork->SetCell({ 0, 0 }, "0");
+        bench::DoNotOptimize(fork->GetCell({ 0, COLS })->GetValue());
+    });
+    bench::Report("first fork", "state+index", first_seconds);
+
+    BenchCopies("fork", FORKS, *sheet, [](SheetInterface& sheet) {
+        return sheet.Fork();
+    });
+
+    // само копирование, без правок
+    std::vector<std::unique_ptr<SheetInterface>> forks;
+    forks.reserve(FORKS);
+    const double seconds = bench::MeasureSeconds([&] {
+        for (int i = 0; i < FORKS; ++i) {
+            forks.push_back(sheet->Fork());
+        }
+    });
+    bench::Report("Fork() x " + std::to_string(FORKS), "unchanged", seconds);
+}
@@ -0,0 +1,64 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "FormulaAST.h"
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int EVALUATIONS = 2'000'000;
+
+std::unique_ptr<SheetInterface> MakeInputs() {
+    auto sheet = CreateSheet();
+    for (int row = 0; row < 64; ++row) {
+        for (int col = 0; col < 8; ++col) {
+            sheet->SetCell({ row, col }, "=" + std::to_string(row * 8 + col + 1));
+            // столбцы I:P - числа, заданные текстом, как в импортированных данных
+            sheet->SetCell({ row, col + 8 }, std::to_string(row * 8 + col + 1) + ".25");
+        }
+    }
+    return sheet;
+}
+
+std::string MakeLongSum(int terms) {
+    std::string expression = "1";
+    for (int i = 0; i < terms; ++i) {
+        expression += i % 2 ? "+" : "*";
+        expression += std::to_string(i % 7 + 1);
+    }
+    return expression;
+}
+
+}  // namespace
+
+void BenchFormula() {
+    const auto sheet = MakeInputs();
+    const std::vector<std::string> expressions = {
+        "1+2*3-4/5",
+        "(A1+B2)*(C3-D4)/(E5+1)-F6*G7",
+        "(I1+J2)*(K3-L4)/(M5+1)-N6*O7",
+        "-(A1*2+B1*3+C1*4+D1*5+E1*6+F1*7+G1*8+H1*9)/(A2+B2+C2+D2+E2+F2+G2+H2)",
+        MakeLongSum(64),
+    };
+
+    for (const auto& expression : expressions) {
+        const FormulaAST ast = ParseFormulaAST(expression);
+        const std::string name = expression.size() > 24 ? expression.substr(0, 21) + "..." : expression;
+        double sum = 0;
+
+        bench::Report(name, "tree", bench::MeasureSeconds([&] {
+            for (int i = 0; i < EVALUATIONS; ++i) {
+                sum += std::get<double>(ast.ExecuteTree(*sheet));
+            }
+        }));
+        bench::Report(name, "bytecode", bench::MeasureSeconds([&] {
+            for (int i = 0; i < EVALUATIONS; ++i) {
+                sum += std::get<double>(ast.Execute(*sheet));
+            }
+        }));
+        bench::DoNotOptimize(sum);
+    }
+}
@@ -0,0 +1,102 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+#include "frozen_sheet.h"
+
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+
+constexpr int ROWS = 16384;
+constexpr int COLS = 8;
+constexpr int READS = 4'000'000;
+
+// Строка - цепочка формул над числом в первом столбце, в последнем
+// столбце - текст.
+void Build(SheetInterface& sheet) {
+    std::vector<std::pair<Position, std::string>> cells;
+    for (int row = 0; row < ROWS; ++row) {
+        cells.emplace_back(Position{ row, 0 }, std::to_string(row));
+        for (int col = 1; col < COLS - 1; ++col) {
+            cells.emplace_back(Position{ row, col }, "=" + Position{ row, col - 1 }.ToString() + "*2+1");
+        }
+        cells.emplace_back(Position{ row, COLS - 1 }, "row " + std::to_string(row));
+    }
+    sheet.SetCells(std::move(cells));
+    sheet.Recalculate();
+}
+
+std::vector<Position> RandomPositions() {
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> row(0, ROWS - 1);
+    std::uniform_int_distribution<int> col(0, COLS - 2);
+    std::vector<Position> positions(READS);
+    for (Position& pos : positions) {
+        pos = { row(random), col(random) };
+    }
+    return positions;
+}
+
+template <typename Read>
+void BenchReads(std::string_view variant, const std::vector<Position>& positions, Read read) {
+    double sum = 0;
+    const double seconds = bench::MeasureSeconds([&] {
+        for (Position pos : positions) {
+            sum += read(pos);
+        }
+    });
+    bench::DoNotOptimize(sum);
+    bench::Report("random reads", variant, READS / seconds / 1e6, "M reads/s");
+}
+
+template <typename Sheet>
+void BenchPrint(std::string_view variant, const Sheet& sheet) {
+    const double seconds = bench::MeasureSeconds([&] {
+        std::ostringstream output;
+        sheet.PrintValues(output);
+        bench::DoNotOptimize(output);
+    });
+    bench::Report("PrintValues", variant, seconds);
+}
+
+}  // namespace
+
+void BenchFrozen() {
+    const std::string name = std::to_string(ROWS * COLS / 1000) + "k cells, memory";
+
+    size_t heap_before = bench::AllocatedBytes();
+    auto sheet = CreateSheet();
+    Build(*sheet);
+    bench::Report(name, "sheet", (bench::AllocatedBytes() - heap_before) / 1024.0 / 1024, "MiB");
+
+    heap_before = bench::AllocatedBytes();
+    std::unique_ptr<const FrozenSheet> frozen;
+    const double freeze_seconds = bench::MeasureSeconds([&] {
+        frozen = sheet->Freeze();
+    });
+    bench::Report(name, "frozen", (bench::AllocatedBytes() - heap_before) / 1024.0 / 1024, "MiB");
+    bench::Report("Freeze()", "", freeze_seconds);
+
+    const auto positions = RandomPositions();
+    const SheetInterface& readable = *sheet;
+    BenchReads("sheet", positions, [&readable](Position pos) {
+        return std::get<double>(readable.GetCell(pos)->GetNumericValue());
+    });
+    BenchReads("frozen cell", positions, [&frozen](Position pos) {
+        return std::get<double>(frozen->GetCell(pos)->GetNumericValue());
+    });
+    BenchReads("frozen direct", positions, [&frozen](Position pos) {
+        return std::get<double>(frozen->GetNumericValue(pos));
+    });
+
+    BenchPrint("sheet", readable);
+    BenchPrint("frozen", *frozen);
+}
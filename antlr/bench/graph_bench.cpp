@@ -0,0 +1,110 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "small_ptr_set.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int NODES = 1'250'000;
+constexpr int INPUTS_PER_NODE = 4;
+constexpr int HOT_NODES = 8;
+
+// Рёбра модели: каждая формула ссылается на три ячейки рядом с собой и на
+// одну из нескольких "горячих" ячеек, как на курс или ставку налога. У
+// горячих ячеек больше ста тысяч зависимых.
+std::vector<std::pair<int, int>> MakeEdges() {
+    std::mt19937 gen(42);
+    std::vector<std::pair<int, int>> edges;
+    edges.reserve(static_cast<size_t>(NODES) * INPUTS_PER_NODE);
+    for (int node = HOT_NODES; node < NODES; ++node) {
+        for (int i = 0; i < INPUTS_PER_NODE - 1; ++i) {
+            int input = node - 1 - static_cast<int>(gen() % std::min(node, 64));
+            edges.push_back({ input, node });
+        }
+        edges.push_back({ static_cast<int>(gen() % HOT_NODES), node });
+    }
+    return edges;
+}
+
+// Узел графа в прежнем представлении ячейки.
+struct SetNode {
+    std::set<SetNode*> dependents;
+    std::set<SetNode*> inputs;
+
+    void AddInput(SetNode* input) {
+        if (inputs.insert(input).second) {
+            input->dependents.insert(this);
+        }
+    }
+
+    template <typename F>
+    void ForEachDependent(F&& f) const {
+        for (SetNode* dependent : dependents) {
+            f(dependent);
+        }
+    }
+};
+
+struct CompactNode {
+    SmallPtrSet<CompactNode> dependents;
+    SmallPtrSet<CompactNode> inputs;
+
+    void AddInput(CompactNode* input) {
+        if (inputs.Insert(input)) {
+            input->dependents.Insert(this);
+        }
+    }
+
+    template <typename F>
+    void ForEachDependent(F&& f) const {
+        for (CompactNode* dependent : dependents) {
+            f(dependent);
+        }
+    }
+};
+
+template <typename Node>
+void Run(const std::vector<std::pair<int, int>>& edges, std::string_view variant) {
+    const size_t heap_before = bench::AllocatedBytes();
+    auto nodes = std::make_unique<Node[]>(NODES);
+    const size_t nodes_bytes = bench::AllocatedBytes() - heap_before;
+
+    double seconds = bench::MeasureSeconds([&] {
+        for (auto [input, node] : edges) {
+            nodes[node].AddInput(&nodes[input]);
+        }
+    });
+    const size_t edge_bytes = bench::AllocatedBytes() - heap_before - nodes_bytes;
+    // каждое ребро хранится у обоих концов; встроенную в узел часть
+    // множеств тоже относим к рёбрам
+    const double bytes_per_edge = static_cast<double>(edge_bytes + nodes_bytes) / edges.size();
+
+    bench::Report("5M edges build", variant, seconds);
+    bench::Report("5M edges memory", variant, bytes_per_edge, "bytes/edge");
+
+    size_t visited = 0;
+    seconds = bench::MeasureSeconds([&] {
+        for (int node = 0; node < NODES; ++node) {
+            nodes[node].ForEachDependent([&visited](const Node* dependent) {
+                visited += dependent != nullptr;
+            });
+        }
+    });
+    bench::DoNotOptimize(visited);
+    bench::Report("5M edges scan dependents", variant, seconds);
+}
+
+}  // namespace
+
+void BenchGraph() {
+    const auto edges = MakeEdges();
+    Run<SetNode>(edges, "std::set");
+    Run<CompactNode>(edges, "SmallPtrSet");
+}
@@ -0,0 +1,81 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+#include "text_import.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+constexpr int INPUT_COLS = 6;
+
+// Полный по высоте лист: шесть столбцов чисел, формула над ними и текст в
+// каждой строке.
+std::string MakeText(char separator) {
+    std::string text;
+    for (int row = 0; row < Position::MAX_ROWS; ++row) {
+        for (int col = 0; col < INPUT_COLS; ++col) {
+            text += std::to_string((row * 7 + col) % 1000) + separator;
+        }
+        text += "=" + Position{ row, 0 }.ToString() + "*" + Position{ row, 1 }.ToString() + "+SUM("
+            + Range{ { row, 2 }, { row, INPUT_COLS - 1 } }.ToString() + ")";
+        text += separator;
+        text += separator == ',' ? "\"row, " + std::to_string(row) + "\"\n" : "row " + std::to_string(row) + "\n";
+    }
+    return text;
+}
+
+void ReportImport(std::string_view name, std::string_view variant, double seconds) {
+    bench::Report(name, variant, seconds);
+    bench::Report(name, variant, Position::MAX_ROWS / seconds / 1000, "k rows/s");
+}
+
+// Прежний способ: чтение строк потоком и SetCell() для каждой ячейки.
+void BenchSetCell(const std::string& path) {
+    auto sheet = CreateSheet();
+    ReportImport("16k rows TSV import", "getline+SetCell", bench::MeasureSeconds([&] {
+        std::ifstream input(path, std::ios::binary);
+        std::string line;
+        for (int row = 0; std::getline(input, line); ++row) {
+            std::istringstream fields(line);
+            std::string field;
+            for (int col = 0; std::getline(fields, field, '\t'); ++col) {
+                if (!field.empty()) {
+                    sheet->SetCell({ row, col }, field);
+                }
+            }
+        }
+    }));
+}
+
+void BenchFormat(std::string_view name, const std::string& path, TextFormat format) {
+    for (size_t threads : { 1, 2, 4 }) {
+        auto sheet = CreateSheet();
+        sheet->SetRecalculationThreads(threads);
+        const std::string variant = std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+        ReportImport(name, variant, bench::MeasureSeconds([&] {
+            ImportTexts(*sheet, path, format, threads);
+        }));
+    }
+}
+
+}  // namespace
+
+void BenchImport() {
+    const auto directory = std::filesystem::temp_directory_path();
+    const std::string tsv_path = (directory / "spreadsheet_import_bench.tsv").string();
+    const std::string csv_path = (directory / "spreadsheet_import_bench.csv").string();
+    std::ofstream(tsv_path, std::ios::binary) << MakeText('\t');
+    std::ofstream(csv_path, std::ios::binary) << MakeText(',');
+
+    BenchSetCell(tsv_path);
+    BenchFormat("16k rows TSV import", tsv_path, TextFormat::Tsv);
+    BenchFormat("16k rows CSV import", csv_path, TextFormat::Csv);
+
+    std::filesystem::remove(tsv_path);
+    std::filesystem::remove(csv_path);
+}
@@ -0,0 +1,48 @@
+#include "benchmarks.h"
+
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+struct Benchmark {
+    std::string_view name;
+    void (*run)();
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"storage", BenchStorage},
+    {"print", BenchPrint},
+    {"formula", BenchFormula},
+    {"errors", BenchErrors},
+    {"parse", BenchParse},
+    {"recalc", BenchRecalculate},
+    {"graph", BenchGraph},
+    {"ranges", BenchRanges},
+    {"aggregates", BenchAggregates},
+    {"batch", BenchBatch},
+    {"import", BenchImport},
+    {"snapshot", BenchSnapshot},
+    {"reads", BenchReads},
+    {"views", BenchViews},
+    {"forks", BenchForks},
+    {"frozen", BenchFrozen},
+    {"writers", BenchConcurrentWriters},
+};
+
+}  // namespace
+
+// Запуск: spreadsheet_bench [имя...]. Без аргументов выполняются все бенчмарки.
+int main(int argc, char* argv[]) {
+    for (const auto& benchmark : BENCHMARKS) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || benchmark.name == argv[i];
+        }
+        if (selected) {
+            std::cout << "== " << benchmark.name << " ==" << std::endl;
+            benchmark.run();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "FormulaAST.h"
+#include "formula.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int FORMULAS = 200'000;
+
+std::vector<std::string> MakeFormulas() {
+    std::mt19937 gen(42);
+    std::vector<std::string> formulas;
+    formulas.reserve(FORMULAS);
+    for (int i = 0; i < FORMULAS; ++i) {
+        const std::string row = std::to_string(i % Position::MAX_ROWS + 1);
+        switch (gen() % 3) {
+        case 0:
+            formulas.push_back("A" + row + "*B" + row + "+C" + row + "/2");
+            break;
+        case 1:
+            formulas.push_back("(D" + row + " - 1.5e3) * (E" + row + " + F" + row + ") / -G" + row);
+            break;
+        default:
+            formulas.push_back(std::to_string(gen() % 1000) + ".25 + H" + row + " * (I1 - J2 + K3 * L4)");
+            break;
+        }
+    }
+    return formulas;
+}
+
+// Столбец, заполненный протягиванием: =A1*B1+C1/2, =A2*B2+C2/2, ...
+void BenchFillDown() {
+    std::vector<std::string> formulas;
+    formulas.reserve(Position::MAX_ROWS);
+    for (int row = 1; row <= Position::MAX_ROWS; ++row) {
+        const std::string index = std::to_string(row);
+        formulas.push_back("A" + index + "*B" + index + "+C" + index + "/2");
+    }
+
+    double seconds = bench::MeasureSeconds([&] {
+        std::vector<FormulaAST> asts;
+        asts.reserve(formulas.size());
+        for (const auto& formula : formulas) {
+            asts.push_back(ParseFormulaAST(formula));
+        }
+        bench::DoNotOptimize(asts);
+    });
+    bench::Report("fill down 16384 formulas", "own AST", seconds);
+
+    seconds = bench::MeasureSeconds([&] {
+        std::vector<std::unique_ptr<FormulaInterface>> shared;
+        shared.reserve(formulas.size());
+        for (int row = 0; row < Position::MAX_ROWS; ++row) {
+            shared.push_back(ParseFormula(formulas[row], Position{ row, 3 }));
+        }
+        bench::DoNotOptimize(shared);
+    });
+    bench::Report("fill down 16384 formulas", "shared AST", seconds);
+}
+
+}  // namespace
+
+void BenchParse() {
+    const auto formulas = MakeFormulas();
+    size_t bytes = 0;
+    for (const auto& formula : formulas) {
+        bytes += formula.size();
+    }
+
+    for (auto [backend, name] : { std::pair{ FormulaParserBackend::Antlr, "antlr" },
+                                  std::pair{ FormulaParserBackend::Native, "native" } }) {
+        size_t cells = 0;
+        double seconds = bench::MeasureSeconds([&] {
+            for (const auto& formula : formulas) {
+                FormulaAST ast = ParseFormulaAST(formula, backend);
+                cells += !ast.GetCells().empty();
+            }
+        });
+        bench::DoNotOptimize(cells);
+        bench::Report("parse 200000 formulas", name, seconds);
+        bench::Report("parse 200000 formulas", name, FORMULAS / seconds / 1e3, "k formulas/s");
+        bench::Report("parse 200000 formulas", name, bytes / seconds / (1 << 20), "MB/s");
+    }
+
+    BenchFillDown();
+}
@@ -0,0 +1,81 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <variant>
+
+namespace {
+
+const char* const OUTPUT_FILE = "print_bench.tmp";
+
+// Прежний способ печати: поиск каждой позиции прямоугольника и std::endl после
+// каждой строки.
+void PrintCellByCell(const SheetInterface& sheet, std::ostream& output) {
+    Size range = sheet.GetPrintableSize();
+    for (int row = 0; row < range.rows; row++) {
+        for (int col = 0; col < range.cols; col++) {
+            const CellInterface* cell = sheet.GetCell({ row, col });
+            if (col > 0) {
+                output << '\t';
+            }
+            if (cell != nullptr) {
+                std::visit([&output](const auto& x) {
+                    output << x;
+                }, cell->GetValue());
+            }
+        }
+        output << std::endl;
+    }
+}
+
+std::unique_ptr<SheetInterface> MakeDense() {
+    auto sheet = CreateSheet();
+    for (int row = 0; row < 2000; ++row) {
+        for (int col = 0; col < 100; ++col) {
+            sheet->SetCell({ row, col }, std::to_string(row * 100 + col));
+        }
+    }
+    return sheet;
+}
+
+std::unique_ptr<SheetInterface> MakeSparse() {
+    auto sheet = CreateSheet();
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> col(0, 99);
+    for (int row = 0; row < Position::MAX_ROWS; row += 8) {
+        sheet->SetCell({ row, col(gen) }, "sparse value " + std::to_string(row));
+    }
+    sheet->SetCell({ Position::MAX_ROWS - 1, 99 }, "corner");
+    return sheet;
+}
+
+template <typename Printer>
+void Run(const std::string& name, std::string_view variant, const SheetInterface& sheet, Printer print) {
+    std::streamoff bytes = 0;
+    double seconds = bench::MeasureSeconds([&] {
+        std::ofstream output(OUTPUT_FILE, std::ios::binary);
+        print(sheet, output);
+        bytes = output.tellp();
+    });
+    bench::Report(name, variant, bytes / seconds / (1 << 20), "MB/s");
+}
+
+}  // namespace
+
+void BenchPrint() {
+    const auto dense = MakeDense();
+    const auto sparse = MakeSparse();
+    for (const auto& [name, sheet] : { std::pair{ "print dense 2000x100", dense.get() },
+                                       std::pair{ "print sparse 16384x100", sparse.get() } }) {
+        Run(name, "cell by cell", *sheet, PrintCellByCell);
+        Run(name, "streaming", *sheet, [](const SheetInterface& sheet, std::ostream& output) {
+            sheet.PrintValues(output);
+        });
+    }
+    std::remove(OUTPUT_FILE);
+}
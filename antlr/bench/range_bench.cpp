@@ -0,0 +1,110 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+#include "range_index.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int WINDOW = 64;
+
+// Скользящие окна: формула в строке row столбца B ссылается на WINDOW ячеек
+// столбца A, начиная со своей строки.
+std::string WindowRange(int row) {
+    return Position{ row, 0 }.ToString() + ":" + Position{ row + WINDOW - 1, 0 }.ToString();
+}
+
+std::string WindowSum(int row) {
+    std::string formula = "=";
+    for (int i = 0; i < WINDOW; ++i) {
+        formula += (i == 0 ? "" : "+") + Position{ row + i, 0 }.ToString();
+    }
+    return formula;
+}
+
+void BenchWindows(std::string_view variant, std::string (*make_formula)(int)) {
+    constexpr int ROWS = Position::MAX_ROWS - WINDOW;
+    auto sheet = CreateSheet();
+    for (int row = 0; row < Position::MAX_ROWS; ++row) {
+        sheet->SetCell({ row, 0 }, "1");
+    }
+
+    const size_t heap_before = bench::AllocatedBytes();
+    double seconds = bench::MeasureSeconds([&] {
+        for (int row = 0; row < ROWS; ++row) {
+            sheet->SetCell({ row, 1 }, make_formula(row));
+        }
+    });
+    bench::Report("16320 windows of 64 build", variant, seconds);
+    bench::Report("16320 windows of 64 memory", variant,
+        static_cast<double>(bench::AllocatedBytes() - heap_before) / (1024 * 1024), "MiB");
+
+    sheet->Recalculate();
+    int value = 1;
+    seconds = bench::MeasureSeconds([&] {
+        for (int row = 0; row < Position::MAX_ROWS; row += 7) {
+            sheet->SetCell({ row, 0 }, std::to_string(++value));
+        }
+    });
+    bench::Report("16320 windows of 64 edit inputs", variant, seconds);
+}
+
+// Поиск диапазонов, содержащих ячейку, в сравнении с перебором.
+void BenchLookup() {
+    constexpr int RANGES = 100'000;
+    constexpr int QUERIES = 2'000;
+    std::mt19937 gen(7);
+    std::vector<Range> ranges;
+    for (int i = 0; i < RANGES; ++i) {
+        Position from{ static_cast<int>(gen() % 16000), static_cast<int>(gen() % 200) };
+        ranges.push_back({ from, { from.row + static_cast<int>(gen() % 256), from.col + static_cast<int>(gen() % 4) } });
+    }
+    std::vector<Position> queries;
+    for (int i = 0; i < QUERIES; ++i) {
+        queries.push_back({ static_cast<int>(gen() % 16384), static_cast<int>(gen() % 204) });
+    }
+
+    RangeIndex<int> index;
+    double seconds = bench::MeasureSeconds([&] {
+        for (int i = 0; i < RANGES; ++i) {
+            index.Insert(ranges[i], i);
+        }
+    });
+    bench::Report("100k ranges insert", "RangeIndex", seconds);
+
+    size_t found = 0;
+    seconds = bench::MeasureSeconds([&] {
+        for (Position pos : queries) {
+            index.ForEachContaining(pos, [&found](int) {
+                ++found;
+            });
+        }
+    });
+    bench::DoNotOptimize(found);
+    bench::Report("100k ranges 2k lookups", "RangeIndex", seconds);
+
+    found = 0;
+    seconds = bench::MeasureSeconds([&] {
+        for (Position pos : queries) {
+            for (const Range& range : ranges) {
+                found += range.Contains(pos);
+            }
+        }
+    });
+    bench::DoNotOptimize(found);
+    bench::Report("100k ranges 2k lookups", "linear scan", seconds);
+}
+
+}  // namespace
+
+void BenchRanges() {
+    BenchWindows("cell refs", WindowSum);
+    BenchWindows("ranges", [](int row) {
+        return "=" + WindowRange(row);
+    });
+    BenchLookup();
+}
@@ -0,0 +1,72 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace {
+
+constexpr int ROWS = 4096;
+constexpr int COLS = 16;
+constexpr int READS_PER_THREAD = ROWS * COLS;
+
+// Строка - цепочка формул над числом в первом столбце.
+void Build(SheetInterface& sheet) {
+    for (int row = 0; row < ROWS; ++row) {
+        sheet.SetCell({ row, 0 }, std::to_string(row));
+        for (int col = 1; col < COLS; ++col) {
+            const std::string input = Position{ row, col - 1 }.ToString();
+            sheet.SetCell({ row, col }, "=" + input + "*1.5+" + input + "/3");
+        }
+    }
+}
+
+// Каждый поток читает все ячейки таблицы, начиная со своей строки, так что
+// потоки сначала вычисляют разные формулы, а затем встречаются на чужих.
+double ReadAll(const SheetInterface& sheet, size_t threads) {
+    return bench::MeasureSeconds([&] {
+        std::vector<double> sums(threads);
+        std::vector<std::thread> readers;
+        for (size_t reader = 0; reader < threads; ++reader) {
+            readers.emplace_back([&sheet, &sum = sums[reader], first = static_cast<int>(reader * ROWS / threads)] {
+                for (int i = 0; i < ROWS; ++i) {
+                    const int row = (first + i) % ROWS;
+                    for (int col = 0; col < COLS; ++col) {
+                        sum += std::get<double>(sheet.GetCell({ row, col })->GetNumericValue());
+                    }
+                }
+            });
+        }
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        bench::DoNotOptimize(sums);
+    });
+}
+
+void ReportReads(std::string_view name, size_t threads, double seconds) {
+    const std::string variant = std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+    bench::Report(name, variant, seconds);
+    bench::Report(name, variant, threads * READS_PER_THREAD / seconds / 1e6, "M reads/s");
+}
+
+}  // namespace
+
+void BenchReads() {
+    auto sheet = CreateSheet();
+    Build(*sheet);
+
+    for (size_t threads : { 1, 2, 4, 8, 16, 32 }) {
+        // сброс кешей: читатели вычисляют формулы сами
+        for (int row = 0; row < ROWS; ++row) {
+            sheet->SetCell({ row, 0 }, std::to_string(row + threads));
+        }
+        ReportReads("64k formulas, first reads", threads, ReadAll(*sheet, threads));
+        ReportReads("64k formulas, cached reads", threads, ReadAll(*sheet, threads));
+    }
+}
@@ -0,0 +1,87 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Graph {
+    std::string name;
+    // ячейки с числами, от которых зависят все формулы
+    std::vector<Position> inputs;
+    std::function<void(SheetInterface&)> build;
+};
+
+std::string Ref(int row, int col) {
+    return Position{ row, col }.ToString();
+}
+
+std::string Step(const std::string& input) {
+    return "=" + input + "*1.5+" + input + "/3-(" + input + "-2)*0.25";
+}
+
+// Много независимых коротких цепочек: строка - цепочка из 15 формул.
+Graph MakeWide() {
+    constexpr int ROWS = 16384;
+    constexpr int COLS = 16;
+    Graph graph{ "wide 16384 chains of 15", {}, {} };
+    for (int row = 0; row < ROWS; ++row) {
+        graph.inputs.push_back({ row, 0 });
+    }
+    graph.build = [](SheetInterface& sheet) {
+        for (int row = 0; row < ROWS; ++row) {
+            sheet.SetCell({ row, 0 }, "1");
+            for (int col = 1; col < COLS; ++col) {
+                sheet.SetCell({ row, col }, Step(Ref(row, col - 1)));
+            }
+        }
+    };
+    return graph;
+}
+
+// Несколько длинных цепочек: столбец - цепочка из 1023 формул.
+Graph MakeDeep() {
+    constexpr int ROWS = 1024;
+    constexpr int COLS = 64;
+    Graph graph{ "deep 64 chains of 1023", {}, {} };
+    for (int col = 0; col < COLS; ++col) {
+        graph.inputs.push_back({ 0, col });
+    }
+    graph.build = [](SheetInterface& sheet) {
+        for (int col = 0; col < COLS; ++col) {
+            sheet.SetCell({ 0, col }, "1");
+            for (int row = 1; row < ROWS; ++row) {
+                sheet.SetCell({ row, col }, Step(Ref(row - 1, col)));
+            }
+        }
+    };
+    return graph;
+}
+
+}  // namespace
+
+void BenchRecalculate() {
+    for (const Graph& graph : { MakeWide(), MakeDeep() }) {
+        auto sheet = CreateSheet();
+        graph.build(*sheet);
+        sheet->Recalculate();
+
+        int value = 0;
+        for (size_t threads : { 1, 2, 4, 8, 16 }) {
+            sheet->SetRecalculationThreads(threads);
+            ++value;
+            for (Position input : graph.inputs) {
+                sheet->SetCell(input, std::to_string(value));
+            }
+
+            double seconds = bench::MeasureSeconds([&] {
+                sheet->Recalculate();
+            });
+            bench::Report(graph.name, std::to_string(threads) + " threads", seconds);
+        }
+    }
+}
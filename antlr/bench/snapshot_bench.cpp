@@ -0,0 +1,95 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+#include "text_import.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int ROWS = 16000;
+constexpr int NUMBER_COLS = 8;
+constexpr int FORMULA_COLS = 8;
+
+// Восемь столбцов чисел и восемь столбцов формул над ними, формулы
+// вычислены перед сохранением.
+std::unique_ptr<SheetInterface> MakeSheet() {
+    std::vector<std::pair<Position, std::string>> cells;
+    for (int row = 0; row < ROWS; ++row) {
+        for (int col = 0; col < NUMBER_COLS; ++col) {
+            cells.push_back({ { row, col }, std::to_string((row * 7 + col) % 1000) });
+        }
+        for (int col = 0; col < FORMULA_COLS; ++col) {
+            cells.push_back({ { row, NUMBER_COLS + col },
+                "=" + Position{ row, col }.ToString() + "*2+" + Position{ row, (col + 1) % NUMBER_COLS }.ToString() });
+        }
+    }
+    auto sheet = CreateSheet();
+    sheet->SetCells(std::move(cells));
+    sheet->Recalculate();
+    return sheet;
+}
+
+}  // namespace
+
+void BenchSnapshot() {
+    const std::string name = std::to_string(ROWS * (NUMBER_COLS + FORMULA_COLS) / 1000) + "k cells";
+    const auto directory = std::filesystem::temp_directory_path();
+    const std::string tsv_path = (directory / "spreadsheet_snapshot_bench.tsv").string();
+    const std::string snapshot_path = (directory / "spreadsheet_snapshot_bench.bin").string();
+
+    auto source = MakeSheet();
+    {
+        std::ofstream file(tsv_path, std::ios::binary);
+        source->PrintTexts(file);
+    }
+    bench::Report(name + " save", "PrintTexts", bench::MeasureSeconds([&] {
+        std::ofstream file(tsv_path, std::ios::binary);
+        source->PrintTexts(file);
+    }));
+    bench::Report(name + " save", "SaveSnapshot", bench::MeasureSeconds([&] {
+        std::ofstream file(snapshot_path, std::ios::binary);
+        source->SaveSnapshot(file);
+    }));
+    bench::Report(name + " file size", "TSV", std::filesystem::file_size(tsv_path) / 1024.0, "KB");
+    bench::Report(name + " file size", "snapshot", std::filesystem::file_size(snapshot_path) / 1024.0, "KB");
+
+    // Текст: формулы разбираются при загрузке и вычисляются заново.
+    const Position probe{ ROWS / 2, NUMBER_COLS };
+    {
+        auto sheet = CreateSheet();
+        bench::Report(name + " open + one value", "ImportTexts", bench::MeasureSeconds([&] {
+            ImportTexts(*sheet, tsv_path, TextFormat::Tsv);
+            bench::DoNotOptimize(sheet->GetCell(probe)->GetValue());
+        }));
+        bench::Report(name + " all values", "ImportTexts", bench::MeasureSeconds([&] {
+            std::ostringstream output;
+            sheet->PrintValues(output);
+        }));
+    }
+
+    // Снимок: открытие читает только каталоги, блоки загружаются по обращению.
+    std::unique_ptr<SheetInterface> sheet;
+    bench::Report(name + " open + one value", "LoadSnapshot", bench::MeasureSeconds([&] {
+        sheet = LoadSnapshot(snapshot_path);
+        bench::DoNotOptimize(sheet->GetCell(probe)->GetValue());
+    }));
+    bench::Report(name + " all values", "LoadSnapshot", bench::MeasureSeconds([&] {
+        std::ostringstream output;
+        sheet->PrintValues(output);
+    }));
+    bench::Report(name + " first edit", "LoadSnapshot", bench::MeasureSeconds([&] {
+        sheet->SetCell({ 0, 0 }, "1");
+    }));
+
+    sheet.reset();
+    std::filesystem::remove(tsv_path);
+    std::filesystem::remove(snapshot_path);
+}
@@ -0,0 +1,189 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "block_storage.h"
+#include "cell.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Прежнее хранилище листа: хеш-таблица указателей на ячейки.
+class MapStorage {
+public:
+    Cell& GetOrCreate(Position pos, SheetInterface& sheet) {
+        auto& cell = table_[pos];
+        if (!cell) {
+            cell = std::make_unique<Cell>(sheet, graph_, pos);
+        }
+        return *cell;
+    }
+
+    const Cell* Find(Position pos) const {
+        auto it = table_.find(pos);
+        return it == table_.end() ? nullptr : it->second.get();
+    }
+
+    template <typename F>
+    void ForEachInRow(int row, int cols, F&& f) const {
+        for (int col = 0; col < cols; ++col) {
+            if (const Cell* cell = Find({ row, col })) {
+                f(col, *cell);
+            }
+        }
+    }
+
+private:
+    class Hasher {
+    public:
+        size_t operator() (const Position& pos) const {
+            return hasher_(pos.col) + (hasher_(pos.row) * 37);
+        }
+    private:
+        std::hash<int> hasher_;
+    };
+
+    DependencyGraph graph_;
+    std::unordered_map<Position, std::unique_ptr<Cell>, Hasher> table_;
+};
+
+class TiledStorage {
+public:
+    Cell& GetOrCreate(Position pos, SheetInterface& sheet) {
+        return table_.GetOrCreate(pos, sheet, graph_, pos);
+    }
+
+    const Cell* Find(Position pos) const {
+        return table_.Find(pos);
+    }
+
+    template <typename F>
+    void ForEachInRow(int row, int /* cols */, F&& f) const {
+        table_.ForEachInRow(row, f);
+    }
+
+private:
+    DependencyGraph graph_;
+    BlockStorage<Cell> table_;
+};
+
+struct Pattern {
+    std::string name;
+    std::vector<Position> cells;
+    Size size;
+};
+
+Pattern MakeDense() {
+    Pattern pattern{ "dense 1000x1000", {}, { 1000, 1000 } };
+    for (int row = 0; row < 1000; ++row) {
+        for (int col = 0; col < 1000; ++col) {
+            pattern.cells.push_back({ row, col });
+        }
+    }
+    return pattern;
+}
+
+Pattern MakeStriped() {
+    Pattern pattern{ "striped 1000x2000", {}, { 1000, 2000 } };
+    for (int row = 0; row < 1000; ++row) {
+        for (int col = 0; col < 2000; col += 2) {
+            pattern.cells.push_back({ row, col });
+        }
+    }
+    return pattern;
+}
+
+Pattern MakeSparse() {
+    Pattern pattern{ "random 16384x256", {}, { Position::MAX_ROWS, 256 } };
+    std::mt19937 gen(42);
+    std::vector<Position> all;
+    all.reserve(static_cast<size_t>(Position::MAX_ROWS) * 256);
+    for (int row = 0; row < Position::MAX_ROWS; ++row) {
+        for (int col = 0; col < 256; ++col) {
+            all.push_back({ row, col });
+        }
+    }
+    std::shuffle(all.begin(), all.end(), gen);
+    all.resize(1'000'000);
+    pattern.cells = std::move(all);
+    return pattern;
+}
+
+// Читает саму ячейку, а не только признак её наличия.
+size_t Touch(const Cell* cell) {
+    return cell != nullptr && !cell->IsReferenced();
+}
+
+template <typename Storage>
+void Run(const Pattern& pattern, std::string_view variant) {
+    auto sheet = CreateSheet();
+    Storage storage;
+
+    bench::Report(pattern.name + " fill", variant, bench::MeasureSeconds([&] {
+        for (Position pos : pattern.cells) {
+            storage.GetOrCreate(pos, *sheet);
+        }
+    }));
+
+    std::vector<Position> probes = pattern.cells;
+    std::shuffle(probes.begin(), probes.end(), std::mt19937(7));
+    size_t found = 0;
+    bench::Report(pattern.name + " random lookup", variant, bench::MeasureSeconds([&] {
+        for (Position pos : probes) {
+            found += Touch(storage.Find(pos));
+        }
+    }));
+
+    size_t visited = 0;
+    bench::Report(pattern.name + " row-major scan", variant, bench::MeasureSeconds([&] {
+        for (int row = 0; row < pattern.size.rows; ++row) {
+            storage.ForEachInRow(row, pattern.size.cols, [&visited](int, const Cell& cell) {
+                visited += Touch(&cell);
+            });
+        }
+    }));
+
+    bench::Report(pattern.name + " range 64x16 reads", variant, bench::MeasureSeconds([&] {
+        for (int top = 0; top + 64 <= pattern.size.rows; top += 64) {
+            for (int left = 0; left + 16 <= pattern.size.cols; left += 16) {
+                for (int row = top; row < top + 64; ++row) {
+                    for (int col = left; col < left + 16; ++col) {
+                        found += Touch(storage.Find({ row, col }));
+                    }
+                }
+            }
+        }
+    }));
+
+    bench::Report(pattern.name + " neighbour lookups", variant, bench::MeasureSeconds([&] {
+        for (Position pos : pattern.cells) {
+            const Position neighbours[] = {
+                { pos.row - 1, pos.col }, { pos.row + 1, pos.col },
+                { pos.row, pos.col - 1 }, { pos.row, pos.col + 1 },
+            };
+            for (Position neighbour : neighbours) {
+                if (neighbour.IsValid()) {
+                    found += Touch(storage.Find(neighbour));
+                }
+            }
+        }
+    }));
+
+    bench::DoNotOptimize(found);
+    bench::DoNotOptimize(visited);
+}
+
+}  // namespace
+
+void BenchStorage() {
+    for (const auto& pattern : { MakeDense(), MakeStriped(), MakeSparse() }) {
+        Run<MapStorage>(pattern, "unordered_map");
+        Run<TiledStorage>(pattern, "blocks");
+    }
+}
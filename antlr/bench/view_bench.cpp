@@ -0,0 +1,104 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int ROWS = 4096;
+constexpr int COLS = 8;
+constexpr int EDITS = 20000;
+
+// Столбец чисел, строки формул над ним и сумма столбца.
+std::unique_ptr<SheetInterface> MakeSheet() {
+    auto sheet = CreateSheet();
+    for (int row = 0; row < ROWS; ++row) {
+        sheet->SetCell({ row, 0 }, std::to_string(row));
+        for (int col = 1; col < COLS; ++col) {
+            sheet->SetCell({ row, col }, "=" + Position{ row, col - 1 }.ToString() + "+1");
+        }
+    }
+    sheet->SetCell({ 0, COLS }, "=SUM(A1:A" + std::to_string(ROWS) + ")");
+    return sheet;
+}
+
+// Писатель меняет числа первого столбца по одному, readers потоков в это
+// время берут состояния и печатают их значения. prepare(sheet) вызывается
+// до записи, её результат живёт, пока писатель пишет.
+template <typename Prepare>
+void BenchWriter(std::string_view variant, size_t readers, Prepare prepare) {
+    auto sheet = MakeSheet();
+    const std::shared_ptr<const void> held = prepare(*sheet);
+
+    std::atomic<bool> done = false;
+    std::atomic<int> reports = 0;
+    std::vector<std::thread> threads;
+    for (size_t reader = 0; reader < readers; ++reader) {
+        threads.emplace_back([&sheet, &done, &reports] {
+            while (!done) {
+                std::ostringstream output;
+                sheet->Snapshot()->PrintValues(output);
+                ++reports;
+            }
+        });
+    }
+
+    const double seconds = bench::MeasureSeconds([&] {
+        for (int edit = 0; edit < EDITS; ++edit) {
+            sheet->SetCell({ edit % ROWS, 0 }, std::to_string(edit));
+        }
+    });
+    done = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    const std::string name = std::to_string(ROWS * COLS / 1000) + "k cells, writer";
+    bench::Report(name, variant, seconds);
+    bench::Report(name, variant, EDITS / seconds / 1000, "k edits/s");
+    if (readers > 0) {
+        bench::Report(std::to_string(ROWS * COLS / 1000) + "k cells, readers", variant, reports / seconds,
+            "reports/s");
+    }
+}
+
+}  // namespace
+
+void BenchViews() {
+    auto nothing = [](SheetInterface& /* sheet */) {
+        return std::shared_ptr<const void>();
+    };
+    auto released_view = [](SheetInterface& sheet) {
+        sheet.Snapshot();
+        return std::shared_ptr<const void>();
+    };
+    BenchWriter("no views", 0, nothing);
+    BenchWriter("views released", 0, released_view);
+    BenchWriter("view held", 0, [](SheetInterface& sheet) {
+        return std::shared_ptr<const void>(sheet.Snapshot());
+    });
+    BenchWriter("fork held", 0, [](SheetInterface& sheet) {
+        return std::shared_ptr<const void>(sheet.Fork());
+    });
+    BenchWriter("views+1 reader", 1, released_view);
+    BenchWriter("views+4 readers", 4, released_view);
+
+    // взятие состояния без изменений - атомарное чтение указателя
+    auto sheet = MakeSheet();
+    sheet->Snapshot();
+    constexpr int SNAPSHOTS = 1'000'000;
+    const double seconds = bench::MeasureSeconds([&] {
+        for (int i = 0; i < SNAPSHOTS; ++i) {
+            bench::DoNotOptimize(sheet->Snapshot());
+        }
+    });
+    bench::Report("Snapshot() x 1M", "unchanged", seconds);
+}
@@ -0,0 +1,76 @@
+#include "bench_utils.h"
+#include "benchmarks.h"
+
+#include "common.h"
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int ROWS_PER_WRITER = 2048;
+
+// Строка полосы: число и формула над ним. Константы формул не повторяются
+// ни в одном запуске, поэтому тексты разбираются заново, а не берутся из
+// кеша шаблонов. Формула меняет граф, поэтому правки идут по очереди.
+void WriteFormulas(SheetInterface& sheet, int first_row, int salt) {
+    for (int i = 0; i < ROWS_PER_WRITER; ++i) {
+        const int row = first_row + i;
+        sheet.SetCell({ row, 0 }, std::to_string(row + salt));
+        sheet.SetCell({ row, 1 }, "=A" + std::to_string(row + 1) + "*" + std::to_string(i + salt) + "+1");
+    }
+}
+
+// Строка полосы: число и текст, на которые не ссылается ни одна формула.
+// Такие правки ждут только правок своей полосы строк.
+void WriteValues(SheetInterface& sheet, int first_row, int salt) {
+    for (int i = 0; i < ROWS_PER_WRITER; ++i) {
+        const int row = first_row + i;
+        sheet.SetCell({ row, 0 }, std::to_string(row + salt));
+        sheet.SetCell({ row, 1 }, "item " + std::to_string(i + salt));
+    }
+}
+
+// writers потоков пишут каждый в свою полосу строк либо все в одну.
+template <typename WriteBand>
+void BenchWriters(std::string_view name, size_t writers, bool disjoint, WriteBand write_band) {
+    static int runs = 0;
+    const int first_salt = runs++ * 8 * ROWS_PER_WRITER;
+    auto sheet = CreateSheet();
+    const double seconds = bench::MeasureSeconds([&] {
+        std::vector<std::thread> threads;
+        for (size_t writer = 0; writer < writers; ++writer) {
+            const int first_row = disjoint ? static_cast<int>(writer) * ROWS_PER_WRITER : 0;
+            const int salt = first_salt + static_cast<int>(writer) * ROWS_PER_WRITER;
+            threads.emplace_back([&sheet, &write_band, first_row, salt] {
+                write_band(*sheet, first_row, salt);
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    });
+    const std::string variant = std::to_string(writers) + (writers == 1 ? " writer" : " writers");
+    bench::Report(name, variant, writers * ROWS_PER_WRITER * 2 / seconds / 1000, "k edits/s");
+}
+
+}  // namespace
+
+void BenchConcurrentWriters() {
+    // прирост от потоков ограничен числом ядер
+    bench::Report("hardware threads", "", std::thread::hardware_concurrency(), "threads");
+    for (size_t writers : { 1, 2, 4, 8 }) {
+        BenchWriters("formulas, disjoint bands", writers, true, WriteFormulas);
+    }
+    for (size_t writers : { 1, 2, 4, 8 }) {
+        BenchWriters("formulas, same band", writers, false, WriteFormulas);
+    }
+    for (size_t writers : { 1, 2, 4, 8 }) {
+        BenchWriters("values, disjoint bands", writers, true, WriteValues);
+    }
+    for (size_t writers : { 1, 2, 4, 8 }) {
+        BenchWriters("values, same band", writers, false, WriteValues);
+    }
+}
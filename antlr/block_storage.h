@@ -0,0 +1,247 @@
+#pragma once
+
+#include "common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Разреженное двухуровневое хранилище элементов листа.
+// Лист разбит на блоки фиксированного размера BLOCK_ROWS x BLOCK_COLS. Блок
+// выделяется при первой записи в него и хранит элементы непосредственно внутри
+// себя, поэтому соседние ячейки лежат в памяти рядом. Адрес элемента не
+// меняется, пока элемент не удалён.
+// Позиции, передаваемые в методы, должны быть корректными.
+// Массив строк блоков и длину строк меняет только GetOrCreate(), поэтому
+// Find(), CreateInBlock() и Erase() в разных строках блоков можно вызывать
+// из разных потоков одновременно.
+template <typename T>
+class BlockStorage {
+public:
+    static constexpr int BLOCK_ROWS = 8;
+    static constexpr int BLOCK_COLS = 8;
+    static constexpr int BLOCK_SIZE = BLOCK_ROWS * BLOCK_COLS;
+
+    BlockStorage() = default;
+    BlockStorage(const BlockStorage&) = delete;
+    BlockStorage& operator=(const BlockStorage&) = delete;
+
+    T* Find(Position pos) {
+        Block* block = FindBlock(pos);
+        if (block == nullptr || !block->IsOccupied(IndexInBlock(pos))) {
+            return nullptr;
+        }
+        return block->At(IndexInBlock(pos));
+    }
+
+    const T* Find(Position pos) const {
+        return const_cast<BlockStorage*>(this)->Find(pos);
+    }
+
+    // Возвращает элемент в позиции pos, создавая его из args, если его ещё нет.
+    template <typename... Args>
+    T& GetOrCreate(Position pos, Args&&... args) {
+        Block& block = GetOrCreateBlock(pos);
+        int index = IndexInBlock(pos);
+        if (!block.IsOccupied(index)) {
+            block.Emplace(index, std::forward<Args>(args)...);
+            size_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return *block.At(index);
+    }
+
+    // То же, но только в уже выделенном блоке, иначе nullptr.
+    template <typename... Args>
+    T* CreateInBlock(Position pos, Args&&... args) {
+        Block* block = FindBlock(pos);
+        if (block == nullptr) {
+            return nullptr;
+        }
+        int index = IndexInBlock(pos);
+        if (!block->IsOccupied(index)) {
+            block->Emplace(index, std::forward<Args>(args)...);
+            size_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return block->At(index);
+    }
+
+    void Erase(Position pos) {
+        Block* block = FindBlock(pos);
+        int index = IndexInBlock(pos);
+        if (block == nullptr || !block->IsOccupied(index)) {
+            return;
+        }
+
+        block->Destroy(index);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        if (block->occupied == 0) {
+            blocks_[pos.row / BLOCK_ROWS][pos.col / BLOCK_COLS].reset();
+        }
+    }
+
+    size_t Size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    bool Empty() const {
+        return Size() == 0;
+    }
+
+    // Обходит элементы строки row в порядке возрастания столбца: f(col, item).
+    template <typename F>
+    void ForEachInRow(int row, F&& f) const {
+        size_t block_row = row / BLOCK_ROWS;
+        if (block_row >= blocks_.size()) {
+            return;
+        }
+
+        int shift = (row % BLOCK_ROWS) * BLOCK_COLS;
+        const auto& line = blocks_[block_row];
+        for (size_t block_col = 0; block_col < line.size(); ++block_col) {
+            const Block* block = line[block_col].get();
+            if (block == nullptr) {
+                continue;
+            }
+
+            std::uint64_t row_mask = (block->occupied >> shift) & ROW_MASK;
+            for (int col = 0; row_mask != 0; ++col, row_mask >>= 1) {
+                if (row_mask & 1) {
+                    f(static_cast<int>(block_col) * BLOCK_COLS + col, *block->At(shift + col));
+                }
+            }
+        }
+    }
+
+    // Обходит элементы диапазона range по строкам, в строке - в порядке
+    // возрастания столбца: f(pos, item). Отсутствующие блоки пропускаются
+    // целиком.
+    template <typename F>
+    void ForEachInRange(Range range, F&& f) const {
+        const int last_row = std::min(range.to.row, static_cast<int>(blocks_.size()) * BLOCK_ROWS - 1);
+        for (int row = range.from.row; row <= last_row; ++row) {
+            const auto& line = blocks_[row / BLOCK_ROWS];
+            const size_t last_block = std::min(line.size(), static_cast<size_t>(range.to.col / BLOCK_COLS) + 1);
+            const int shift = (row % BLOCK_ROWS) * BLOCK_COLS;
+            for (size_t block_col = range.from.col / BLOCK_COLS; block_col < last_block; ++block_col) {
+                const Block* block = line[block_col].get();
+                if (block == nullptr) {
+                    continue;
+                }
+
+                const int first_col = static_cast<int>(block_col) * BLOCK_COLS;
+                const int begin = std::max(range.from.col - first_col, 0);
+                const int end = std::min(range.to.col - first_col + 1, BLOCK_COLS);
+                std::uint64_t row_mask = (block->occupied >> (shift + begin)) & (ROW_MASK >> (BLOCK_COLS - (end - begin)));
+                for (int col = begin; row_mask != 0; ++col, row_mask >>= 1) {
+                    if (row_mask & 1) {
+                        f(Position{ row, first_col + col }, *block->At(shift + col));
+                    }
+                }
+            }
+        }
+    }
+
+    // Обходит все элементы поблочно: f(pos, item).
+    template <typename F>
+    void ForEach(F&& f) const {
+        for (size_t block_row = 0; block_row < blocks_.size(); ++block_row) {
+            const auto& line = blocks_[block_row];
+            for (size_t block_col = 0; block_col < line.size(); ++block_col) {
+                const Block* block = line[block_col].get();
+                if (block == nullptr) {
+                    continue;
+                }
+
+                for (int index = 0; index < BLOCK_SIZE; ++index) {
+                    if (block->IsOccupied(index)) {
+                        Position pos{ static_cast<int>(block_row) * BLOCK_ROWS + index / BLOCK_COLS,
+                            static_cast<int>(block_col) * BLOCK_COLS + index % BLOCK_COLS };
+                        f(pos, *block->At(index));
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    static_assert(BLOCK_SIZE <= 64, "block occupancy must fit into a 64-bit mask");
+    static constexpr std::uint64_t ROW_MASK = (std::uint64_t{ 1 } << BLOCK_COLS) - 1;
+
+    struct Block {
+        std::uint64_t occupied = 0;
+        alignas(T) unsigned char storage[sizeof(T) * BLOCK_SIZE];
+
+        Block() = default;
+        Block(const Block&) = delete;
+        Block& operator=(const Block&) = delete;
+
+        ~Block() {
+            for (int index = 0; index < BLOCK_SIZE; ++index) {
+                if (IsOccupied(index)) {
+                    At(index)->~T();
+                }
+            }
+        }
+
+        bool IsOccupied(int index) const {
+            return (occupied >> index) & 1;
+        }
+
+        T* At(int index) {
+            return std::launder(reinterpret_cast<T*>(storage) + index);
+        }
+
+        const T* At(int index) const {
+            return std::launder(reinterpret_cast<const T*>(storage) + index);
+        }
+
+        template <typename... Args>
+        void Emplace(int index, Args&&... args) {
+            new (storage + sizeof(T) * index) T(std::forward<Args>(args)...);
+            occupied |= std::uint64_t{ 1 } << index;
+        }
+
+        void Destroy(int index) {
+            occupied &= ~(std::uint64_t{ 1 } << index);
+            At(index)->~T();
+        }
+    };
+
+    static int IndexInBlock(Position pos) {
+        return (pos.row % BLOCK_ROWS) * BLOCK_COLS + pos.col % BLOCK_COLS;
+    }
+
+    Block* FindBlock(Position pos) const {
+        size_t block_row = pos.row / BLOCK_ROWS;
+        size_t block_col = pos.col / BLOCK_COLS;
+        if (block_row >= blocks_.size() || block_col >= blocks_[block_row].size()) {
+            return nullptr;
+        }
+        return blocks_[block_row][block_col].get();
+    }
+
+    Block& GetOrCreateBlock(Position pos) {
+        size_t block_row = pos.row / BLOCK_ROWS;
+        size_t block_col = pos.col / BLOCK_COLS;
+        if (block_row >= blocks_.size()) {
+            blocks_.resize(block_row + 1);
+        }
+
+        auto& line = blocks_[block_row];
+        if (block_col >= line.size()) {
+            line.resize(block_col + 1);
+        }
+        if (!line[block_col]) {
+            line[block_col] = std::make_unique<Block>();
+        }
+        return *line[block_col];
+    }
+
+    std::vector<std::vector<std::unique_ptr<Block>>> blocks_;
+    std::atomic<size_t> size_ = 0;
+};
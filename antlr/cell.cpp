@@ -1,43 +1,363 @@
 #include "cell.h"
 
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <optional>
+#include <thread>
+#include <vector>
 
-Cell::Cell(SheetInterface& sheet) 
+Cell::Cell(SheetInterface& sheet, DependencyGraph& graph, Position pos) 
     : impl_(std::make_unique<EmptyImpl>())
-    , sheet_(sheet) {
+    , sheet_(sheet)
+    , graph_(graph)
+    , pos_(pos) {
 }
-Cell::~Cell() = default;
 
-void Cell::Set(std::string text, Position pos) {
+Cell::~Cell() {
+    if (dirty_) {
+        DirtyCells& dirty_cells = graph_.dirty_cells;
+        dirty_cells[dirty_index_] = dirty_cells.back();
+        dirty_cells[dirty_index_]->dirty_index_ = dirty_index_;
+        dirty_cells.pop_back();
+    }
+}
+
+namespace {
+// Номер последнего обхода графа зависимостей: проверки на циклы или сброса
+// кешей. У каждого обхода свой номер.
+std::atomic<std::uint64_t> last_visit_generation{ 0 };
+}  // namespace
+
+void Cell::Set(Edit edit) {
+    if (edit.type == FORMULA) {
+        CheckCyclic(edit.pos, edit.cells, edit.ranges);
+    }
+
     ClearCache();
     RemoveDependencies();
-    auto impl = CreateImpl(text);
-    auto cells = impl->GetReferencedCells();
-
+    impl_ = std::move(edit.impl);
+    type_ = edit.type;
     if (type_ == FORMULA) {
-        CheckCyclic(pos, cells);
+        MarkDirty();
+    }
+
+    AttachDependencies(edit.cells, edit.ranges);
+    SyncColumnValue();
+    for (const Range& range : edit.ranges) {
+        AcquireColumns(range);
     }
+}
+
+void Cell::LoadText(std::string text) {
+    impl_ = std::make_unique<TextImpl>(std::move(text));
+    type_ = TEXT;
+}
+
+void Cell::LoadFormula(std::unique_ptr<FormulaInterface> formula, std::optional<NumericValue> cache) {
+    impl_ = std::make_unique<FormulaImpl>(std::move(formula), sheet_, std::move(cache));
+    type_ = FORMULA;
+}
+
+void Cell::AttachLoaded() {
+    const std::vector<Range> ranges = impl_->GetReferencedRanges();
+    AttachDependencies(impl_->GetReferencedCells(), ranges);
+    for (const Range& range : ranges) {
+        AcquireColumns(range);
+    }
+    SyncColumnValue();
+    if (type_ == FORMULA && !impl_->HasCache()) {
+        MarkDirty();
+    }
+}
 
-    impl_ = std::move(impl);
+const FormulaInterface* Cell::GetFormula() const {
+    return impl_->GetFormula();
+}
+
+std::optional<Cell::NumericValue> Cell::GetCachedValue() const {
+    if (type_ != FORMULA || !impl_->HasCache()) {
+        return std::nullopt;
+    }
+    return impl_->GetNumericValue();
+}
+
+Cell::Edit Cell::Prepare(SheetInterface& sheet, Position pos, std::string text) {
+    Edit edit;
+    edit.pos = pos;
+    edit.impl = CreateImpl(std::move(text), pos, sheet, edit.type);
+    edit.cells = edit.impl->GetReferencedCells();
+    edit.ranges = edit.impl->GetReferencedRanges();
+    return edit;
+}
+
+void Cell::ApplyBatch(std::vector<Edit>& edits) {
+    // Новое содержимое ставится на место старого, которое остаётся в правке,
+    // пока пакет не проверен: при цикле оно возвращается вместе со связями.
+    // Из правок одной ячейки действует последняя.
+    std::uint64_t generation = ++last_visit_generation;
+    for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+        Cell* cell = it->cell;
+        if (cell->visit_generation_ == generation) {
+            it->cell = nullptr;
+            continue;
+        }
+        cell->visit_generation_ = generation;
+        cell->DetachDependencies();
+        std::swap(cell->impl_, it->impl);
+        std::swap(cell->type_, it->type);
+        cell->AttachDependencies(it->cells, it->ranges);
+    }
+    edits.erase(std::remove_if(edits.begin(), edits.end(), [](const Edit& edit) {
+        return edit.cell == nullptr;
+    }), edits.end());
+
+    if (HasCycleThroughFormulas(edits)) {
+        for (Edit& edit : edits) {
+            Cell* cell = edit.cell;
+            cell->DetachDependencies();
+            std::swap(cell->impl_, edit.impl);
+            std::swap(cell->type_, edit.type);
+            cell->AttachDependencies(cell->impl_->GetReferencedCells(), cell->impl_->GetReferencedRanges());
+        }
+        throw CircularDependencyException("Circular dependency detected in a batch of edits");
+    }
+
+    // Один сброс на весь пакет. Как и в ClearCache(), формула без кеша уже
+    // сброшена вместе с зависимыми от неё, но от изменённых ячеек сброс
+    // распространяется всегда.
+    generation = ++last_visit_generation;
+    std::vector<Cell*> worklist;
+    auto push_dependents = [&worklist, generation](const Cell* cell) {
+        cell->ForEachDependent([&worklist, generation](Cell* dependent) {
+            if (dependent->visit_generation_ != generation) {
+                dependent->visit_generation_ = generation;
+                worklist.push_back(dependent);
+            }
+        });
+    };
+    for (Edit& edit : edits) {
+        Cell* cell = edit.cell;
+        // сначала новые ссылки, чтобы общий столбец не собирался заново
+        for (const Range& range : edit.ranges) {
+            cell->AcquireColumns(range);
+        }
+        for (const Range& range : edit.impl->GetReferencedRanges()) {
+            cell->ReleaseColumns(range);
+        }
+        cell->SyncColumnValue();
+        if (cell->type_ == FORMULA) {
+            cell->MarkDirty();
+        }
+        cell->visit_generation_ = generation;
+        push_dependents(cell);
+    }
+    while (!worklist.empty()) {
+        Cell* cell = worklist.back();
+        worklist.pop_back();
+        if (cell->type_ == FORMULA && !cell->impl_->HasCache()) {
+            continue;
+        }
+        cell->impl_->ClearCache();
+        if (cell->type_ == FORMULA) {
+            cell->MarkDirty();
+            cell->InvalidateColumnValue();
+        }
+        push_dependents(cell);
+    }
+}
 
-    for (auto& cell : cells) {
-        UpdDependent(pos, cell);
+bool Cell::HasCycleThroughFormulas(const std::vector<Edit>& edits) {
+    // Прежний граф ацикличен, поэтому новый цикл проходит через одну из
+    // новых формул. От них выполняется обход в глубину по зависимым: ребро
+    // в ячейку на текущем пути замыкает цикл. Каждая ячейка проходится один раз.
+    const std::uint64_t on_path = ++last_visit_generation;
+    const std::uint64_t done = ++last_visit_generation;
+    // ячейка и признак выхода из неё
+    std::vector<std::pair<Cell*, bool>> stack;
+    for (const Edit& edit : edits) {
+        if (edit.cell->type_ != FORMULA) {
+            continue;
+        }
+        bool cyclic = false;
+        stack.push_back({ edit.cell, false });
+        while (!stack.empty() && !cyclic) {
+            auto [cell, leaving] = stack.back();
+            stack.pop_back();
+            if (leaving) {
+                cell->visit_generation_ = done;
+                continue;
+            }
+            if (cell->visit_generation_ == done) {
+                continue;
+            }
+            if (cell->visit_generation_ == on_path) {
+                return true;
+            }
+            cell->visit_generation_ = on_path;
+            stack.push_back({ cell, true });
+            cell->ForEachDependent([&](Cell* dependent) {
+                if (dependent->visit_generation_ == on_path) {
+                    cyclic = true;
+                }
+                else if (dependent->visit_generation_ != done) {
+                    stack.push_back({ dependent, false });
+                }
+            });
+        }
+        if (cyclic) {
+            return true;
+        }
     }
+    return false;
 }
 
 void Cell::Clear() {
+    ClearCache();
+    RemoveDependencies();
     impl_ = std::make_unique<EmptyImpl>();
+    type_ = EMPTY;
+    SyncColumnValue();
+}
+
+bool Cell::IsReferenced() const {
+    return !cells_dependent_on_this_.Empty();
+}
+
+bool Cell::IsEmpty() const {
+    return type_ == EMPTY;
+}
+
+Position Cell::GetPosition() const {
+    return pos_;
+}
+
+bool Cell::IsDirty() const {
+    return dirty_;
+}
+
+void Cell::MarkDirty() {
+    if (!dirty_) {
+        dirty_ = true;
+        dirty_index_ = static_cast<std::uint32_t>(graph_.dirty_cells.size());
+        graph_.dirty_cells.push_back(this);
+    }
+}
+
+namespace {
+// Снимок грязного подграфа в формате CSR: ячейки, зависимые от cells[i], -
+// это dependents[offsets[i]] .. dependents[offsets[i + 1] - 1].
+struct DirtyGraph {
+    const std::vector<Cell*>& cells;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> dependents;
+    // число ещё не вычисленных грязных входов каждой ячейки
+    std::vector<std::atomic<int>> pending_inputs;
+
+    // Вычисляет ячейку index и передаёт в on_ready зависимые, у которых не
+    // осталось невычисленных входов. Кеш уже вычисленной ячейки
+    // GetNumericValue() не пересчитывает.
+    template <typename OnReady>
+    void Evaluate(std::uint32_t index, OnReady on_ready) {
+        cells[index]->GetNumericValue();
+        for (std::uint32_t edge = offsets[index]; edge < offsets[index + 1]; ++edge) {
+            std::uint32_t dependent = dependents[edge];
+            if (pending_inputs[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                on_ready(dependent);
+            }
+        }
+    }
+};
+}  // namespace
+
+void Cell::Recalculate(DirtyCells& dirty_cells, ThreadPool* pool) {
+    // меньшие пересчёты быстрее выполнить в одном потоке
+    constexpr size_t MIN_PARALLEL_CELLS = 256;
+
+    // номер ячейки в снимке - её место в dirty_cells
+    DirtyGraph graph{ dirty_cells, {}, {}, {} };
+    const auto size = static_cast<std::uint32_t>(dirty_cells.size());
+    graph.offsets.reserve(size + 1);
+    graph.pending_inputs = std::vector<std::atomic<int>>(size);
+    for (Cell* cell : graph.cells) {
+        graph.offsets.push_back(static_cast<std::uint32_t>(graph.dependents.size()));
+        cell->ForEachDependent([&graph](const Cell* dependent) {
+            if (dependent->dirty_) {
+                graph.dependents.push_back(dependent->dirty_index_);
+                graph.pending_inputs[dependent->dirty_index_].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    graph.offsets.push_back(static_cast<std::uint32_t>(graph.dependents.size()));
+
+    std::vector<std::uint32_t> ready;
+    ready.reserve(size);
+    for (std::uint32_t index = 0; index < size; ++index) {
+        if (graph.pending_inputs[index].load(std::memory_order_relaxed) == 0) {
+            ready.push_back(index);
+        }
+    }
+
+    // Граф ацикличен, поэтому каждая грязная ячейка станет готовой ровно
+    // один раз.
+    if (pool == nullptr || pool->GetThreadCount() == 1 || size < MIN_PARALLEL_CELLS) {
+        for (size_t i = 0; i < ready.size(); ++i) {
+            graph.Evaluate(ready[i], [&ready](std::uint32_t dependent) {
+                ready.push_back(dependent);
+            });
+        }
+        assert(ready.size() == size);
+    }
+    else {
+        WorkStealingQueues<std::uint32_t> queues(pool->GetThreadCount());
+        for (size_t i = 0; i < ready.size(); ++i) {
+            queues.Push(i % pool->GetThreadCount(), ready[i]);
+        }
+
+        std::atomic<size_t> remaining = size;
+        pool->Run([&graph, &queues, &remaining](size_t worker) {
+            while (remaining.load(std::memory_order_acquire) > 0) {
+                std::optional<std::uint32_t> index = queues.Pop(worker);
+                if (!index) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                graph.Evaluate(*index, [&queues, worker](std::uint32_t dependent) {
+                    queues.Push(worker, dependent);
+                });
+                remaining.fetch_sub(1, std::memory_order_release);
+            }
+        });
+    }
+
+    for (Cell* cell : dirty_cells) {
+        cell->dirty_ = false;
+    }
+    dirty_cells.clear();
 }
 
 Cell::Value Cell::GetValue() const { 
+    if (type_ == FORMULA && !impl_->HasCache()) {
+        // через GetNumericValue(), чтобы значение попало в кеш столбца
+        GetNumericValue();
+    }
     return impl_->GetValue(); 
 }
 std::string Cell::GetText() const { 
     return impl_->GetText(); 
 }
+Cell::NumericValue Cell::GetNumericValue() const {
+    if (type_ != FORMULA) {
+        return impl_->GetNumericValue();
+    }
+    // значение записывается в кеш столбца только вычислившим его потоком
+    return static_cast<const FormulaImpl&>(*impl_).GetNumericValue(graph_.column_caches.Find(pos_.col), pos_.row);
+}
 
 Cell::Value Cell::EmptyImpl::GetValue() const { 
     return ""; 
@@ -47,7 +367,24 @@ std::string Cell::EmptyImpl::GetText() const {
     return ""; 
 }
 
-Cell::TextImpl::TextImpl(std::string text) : text_(std::move(text)) {}
+Cell::NumericValue Cell::EmptyImpl::GetNumericValue() const {
+    return 0.0;
+}
+
+Cell::TextImpl::TextImpl(std::string text) 
+    : text_(std::move(text))
+    , number_(FormulaError::Category::Value) {
+    std::string_view value = text_;
+    if (!value.empty() && value[0] == ESCAPE_SIGN) {
+        value.remove_prefix(1);
+    }
+    if (value.empty()) {
+        number_ = 0.0;
+    }
+    else if (auto number = ParseNumber(value)) {
+        number_ = *number;
+    }
+}
 
 Cell::Value Cell::TextImpl::GetValue() const {
     if (text_.empty()) {
@@ -65,26 +402,67 @@ Cell::Value Cell::TextImpl::GetValue() const {
 
 std::string Cell::TextImpl::GetText() const { return text_; }
 
-Cell::FormulaImpl::FormulaImpl(std::string text, SheetInterface& sheet) 
-    : formula_ptr_(ParseFormula(text))
+Cell::NumericValue Cell::TextImpl::GetNumericValue() const {
+    return number_;
+}
+
+Cell::FormulaImpl::FormulaImpl(std::string text, Position pos, SheetInterface& sheet) 
+    : formula_ptr_(ParseFormula(std::move(text), pos))
     , sheet_prt_(sheet)
 {}
 
+Cell::FormulaImpl::FormulaImpl(std::unique_ptr<FormulaInterface> formula, SheetInterface& sheet,
+    std::optional<FormulaInterface::Value> cache)
+    : formula_ptr_(std::move(formula))
+    , sheet_prt_(sheet)
+    , cache_state_(cache ? CACHE_READY : CACHE_EMPTY)
+    , cache_(cache ? *cache : FormulaInterface::Value{})
+{}
+
 Cell::Value Cell::FormulaImpl::GetValue() const {
-    if (!cache_.has_value()) {
-        cache_ = formula_ptr_->Evaluate(sheet_prt_);
-    }
+    NumericValue value = GetNumericValue();
 
-    if (std::holds_alternative<double>(cache_.value())) {
-        return std::get<double>(cache_.value());
+    if (std::holds_alternative<double>(value)) {
+        return std::get<double>(value);
     }
     else {
-        return std::get<FormulaError>(cache_.value());
+        return std::get<FormulaError>(value);
     }
 }
 
 std::string Cell::FormulaImpl::GetText() const { return FORMULA_SIGN + formula_ptr_->GetExpression(); }
 
+Cell::NumericValue Cell::FormulaImpl::GetNumericValue() const {
+    return GetNumericValue(nullptr, 0);
+}
+
+Cell::NumericValue Cell::FormulaImpl::GetNumericValue(ColumnCache* column, int row) const {
+    for (;;) {
+        std::uint8_t state = cache_state_.load(std::memory_order_acquire);
+        if (state == CACHE_READY) {
+            return cache_;
+        }
+        if (state == CACHE_EMPTY
+            && cache_state_.compare_exchange_strong(state, CACHE_COMPUTING, std::memory_order_acquire)) {
+            try {
+                cache_ = formula_ptr_->Evaluate(sheet_prt_);
+            }
+            catch (...) {
+                cache_state_.store(CACHE_EMPTY, std::memory_order_release);
+                throw;
+            }
+            if (column != nullptr) {
+                column->Store(row, cache_);
+            }
+            cache_state_.store(CACHE_READY, std::memory_order_release);
+            return cache_;
+        }
+        // Формулу вычисляет другой поток. Её входы к этому времени уже
+        // вычислены либо вычисляются, так что ожидание недолгое.
+        std::this_thread::yield();
+    }
+}
+
 std::vector<Position> Cell::GetReferencedCells() const {
     return impl_->GetReferencedCells();
 }
@@ -97,64 +475,201 @@ std::vector<Position> Cell::FormulaImpl::GetReferencedCells() const {
     return formula_ptr_->GetReferencedCells();
 }
 
-std::unique_ptr<Cell::Impl> Cell::CreateImpl(std::string text) {
+std::vector<Range> Cell::GetReferencedRanges() const {
+    return impl_->GetReferencedRanges();
+}
+
+std::vector<Range> Cell::Impl::GetReferencedRanges() const {
+    return {};
+}
+
+std::vector<Range> Cell::FormulaImpl::GetReferencedRanges() const {
+    return formula_ptr_->GetReferencedRanges();
+}
+
+std::unique_ptr<Cell::Impl> Cell::CreateImpl(std::string text, Position pos, SheetInterface& sheet, Type& type) {
     std::unique_ptr<Cell::Impl> impl;
     if (text.empty()) {
-        type_ = EMPTY;
+        type = EMPTY;
         impl = std::make_unique<EmptyImpl>();
     }
     else if (text.size() > 1 && text[0] == FORMULA_SIGN) {
-        type_ = FORMULA;
-        impl = std::make_unique<FormulaImpl>(std::move(text.substr(1)), sheet_);
+        type = FORMULA;
+        impl = std::make_unique<FormulaImpl>(std::move(text.substr(1)), pos, sheet);
     }
     else {
-        type_ = TEXT;
+        type = TEXT;
         impl = std::make_unique<TextImpl>(std::move(text));
     }
 
     return impl;
 }
 
-void Cell::CheckCyclic(const Position& pos, const std::vector<Position>& cells) {
+void Cell::CheckCyclic(const Position& pos, const std::vector<Position>& cells,
+    const std::vector<Range>& ranges) {
     for (const auto& cell : cells) {
         if (pos == cell) {
             throw CircularDependencyException("Circular dependency detected at position : " + pos.ToString());
         }
-        
-        auto current_cell = sheet_.GetCell(cell);
-        if (current_cell == nullptr) {
+
+        if (sheet_.GetCell(cell) == nullptr) {
             sheet_.SetCell(cell, {});
         }
-
-        if (current_cell != nullptr) {
-            CheckCyclic(pos, current_cell->GetReferencedCells());
+    }
+    for (const Range& range : ranges) {
+        if (range.Contains(pos)) {
+            throw CircularDependencyException("Circular dependency detected at position : " + pos.ToString());
         }
     }
+
+    // Цикл возникает, если новая формула ссылается на ячейку, которая сама
+    // зависит от этой. Зависимые через диапазоны находятся только в прямом
+    // направлении, поэтому обходятся ячейки, зависящие от этой, и каждая
+    // сверяется со ссылками новой формулы. Каждая ячейка посещается один раз.
+    const std::uint64_t generation = ++last_visit_generation;
+    visit_generation_ = generation;
+    std::vector<Cell*> stack{ this };
+    while (!stack.empty()) {
+        Cell* current_cell = stack.back();
+        stack.pop_back();
+        current_cell->ForEachDependent([&](Cell* dependent) {
+            if (dependent->visit_generation_ == generation) {
+                return;
+            }
+            dependent->visit_generation_ = generation;
+
+            bool referenced = std::binary_search(cells.begin(), cells.end(), dependent->pos_)
+                || std::any_of(ranges.begin(), ranges.end(), [dependent](const Range& range) {
+                    return range.Contains(dependent->pos_);
+                });
+            if (referenced) {
+                throw CircularDependencyException("Circular dependency detected at position : " + pos.ToString());
+            }
+            stack.push_back(dependent);
+        });
+    }
+}
+
+void Cell::AttachDependencies(const std::vector<Position>& cells, const std::vector<Range>& ranges) {
+    for (const Position& cell : cells) {
+        UpdDependent(pos_, cell);
+    }
+    for (const Range& range : ranges) {
+        graph_.range_dependents.Insert(range, this);
+    }
 }
 
 void Cell::UpdDependent(const Position& current_pos, const Position& dependent_pos) {
     Cell* current_cell = dynamic_cast<Cell*>(sheet_.GetCell(current_pos));
     Cell* dependent_cell = dynamic_cast<Cell*>(sheet_.GetCell(dependent_pos));
-    dependent_cell->cells_dependent_on_this_.insert(current_cell);
-    cells_this_depends_on_.insert(dependent_cell);
+    dependent_cell->cells_dependent_on_this_.Insert(current_cell);
+    cells_this_depends_on_.Insert(dependent_cell);
 }
 
 void Cell::Impl::ClearCache() {}
 
+bool Cell::Impl::HasCache() const {
+    return false;
+}
+
+const FormulaInterface* Cell::Impl::GetFormula() const {
+    return nullptr;
+}
+
+const FormulaInterface* Cell::FormulaImpl::GetFormula() const {
+    return formula_ptr_.get();
+}
+
+bool Cell::FormulaImpl::HasCache() const {
+    return cache_state_.load(std::memory_order_acquire) == CACHE_READY;
+}
+
 void Cell::FormulaImpl::ClearCache() {
-    cache_.reset();
+    cache_state_.store(CACHE_EMPTY, std::memory_order_relaxed);
 }
 
 void Cell::ClearCache() {
-    impl_->ClearCache();
-    for (auto dep_cell : cells_dependent_on_this_) {
-        dep_cell->ClearCache();
+    const std::uint64_t generation = ++last_visit_generation;
+    visit_generation_ = generation;
+    std::vector<Cell*> worklist{ this };
+    while (!worklist.empty()) {
+        Cell* cell = worklist.back();
+        worklist.pop_back();
+        // Формула без кеша уже сброшена вместе со всеми зависимыми от неё:
+        // значение вычисляется только после значений всех входов.
+        if (cell != this && cell->type_ == FORMULA && !cell->impl_->HasCache()) {
+            continue;
+        }
+
+        cell->impl_->ClearCache();
+        if (cell->type_ == FORMULA) {
+            cell->MarkDirty();
+            cell->InvalidateColumnValue();
+        }
+        cell->ForEachDependent([&worklist, generation](Cell* dependent) {
+            if (dependent->visit_generation_ != generation) {
+                dependent->visit_generation_ = generation;
+                worklist.push_back(dependent);
+            }
+        });
     }
 }
 
 void Cell::RemoveDependencies() {
+    for (const Range& range : impl_->GetReferencedRanges()) {
+        ReleaseColumns(range);
+    }
+    DetachDependencies();
+}
+
+void Cell::DetachDependencies() {
     for (auto dep_cell : cells_this_depends_on_) {
-        dep_cell->cells_dependent_on_this_.erase(this);
+        dep_cell->cells_dependent_on_this_.Erase(this);
+    }
+    cells_this_depends_on_.Clear();
+    for (const Range& range : impl_->GetReferencedRanges()) {
+        graph_.range_dependents.Erase(range, this);
+    }
+}
+
+void Cell::AcquireColumns(const Range& range) {
+    for (int col = range.from.col; col <= range.to.col; ++col) {
+        ColumnCache* column = graph_.column_caches.Acquire(col);
+        if (column == nullptr) {
+            continue;
+        }
+        const Range whole_column{ { 0, col }, { Position::MAX_ROWS - 1, col } };
+        sheet_.ForEachCellInRange(whole_column, [column](Position /* pos */, const CellInterface& cell) {
+            static_cast<const Cell&>(cell).WriteColumnValue(*column);
+        });
+    }
+}
+
+void Cell::ReleaseColumns(const Range& range) {
+    for (int col = range.from.col; col <= range.to.col; ++col) {
+        graph_.column_caches.Release(col);
+    }
+}
+
+void Cell::WriteColumnValue(ColumnCache& column) const {
+    if (type_ == EMPTY) {
+        column.Erase(pos_.row);
+        return;
+    }
+    column.Insert(pos_.row);
+    if (type_ == TEXT || impl_->HasCache()) {
+        column.Store(pos_.row, impl_->GetNumericValue());
+    }
+}
+
+void Cell::SyncColumnValue() const {
+    if (ColumnCache* column = graph_.column_caches.Find(pos_.col)) {
+        WriteColumnValue(*column);
+    }
+}
+
+void Cell::InvalidateColumnValue() const {
+    if (ColumnCache* column = graph_.column_caches.Find(pos_.col)) {
+        column->Invalidate(pos_.row);
     }
-    cells_this_depends_on_.clear();
 }
\ No newline at end of file
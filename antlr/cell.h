@@ -1,9 +1,16 @@
 #pragma once
 
+#include "column_cache.h"
 #include "common.h"
 #include "formula.h"
+#include "range_index.h"
+#include "small_ptr_set.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <optional>
-#include <set>
+#include <string>
+#include <vector>
 
 enum Type {
     EMPTY,
@@ -11,22 +18,84 @@ enum Type {
     TEXT
 };
 
+class Cell;
+class ThreadPool;
+
+// Формульные ячейки, чей кеш сброшен после последнего пересчёта.
+using DirtyCells = std::vector<Cell*>;
+
+// Общее для ячеек одного листа состояние графа зависимостей.
+struct DependencyGraph {
+    DirtyCells dirty_cells;
+    // Формулы по диапазонам, на которые они ссылаются. Ссылка на диапазон не
+    // раскладывается на рёбра к его ячейкам: зависимые от ячейки формулы
+    // находятся поиском диапазонов, которые её содержат.
+    RangeIndex<Cell*> range_dependents;
+    // Значения столбцов, на которые ссылаются диапазоны. Сбрасываются вместе
+    // с кешами формул.
+    ColumnCaches column_caches;
+};
+
 class Cell : public CellInterface {
 public:
-    Cell(SheetInterface& sheet);
+    Cell(SheetInterface& sheet, DependencyGraph& graph, Position pos);
     ~Cell();
 
-    void Set(std::string text, Position pos);
-    void CheckCyclic(const Position& pos, const std::vector<Position>& cells);
+    // Новое содержимое ячейки, разобранное заранее для пакетного изменения.
+    struct Edit;
+    // Разбирает текст ячейки pos листа sheet, не обращаясь к самой ячейке,
+    // поэтому правки разных ячеек можно разбирать параллельно. Поля cell и
+    // was_empty заполняет вызывающий. Бросает FormulaException.
+    static Edit Prepare(SheetInterface& sheet, Position pos, std::string text);
+    // Задаёт содержимое, разобранное Prepare(). Поля cell и was_empty не
+    // используются. При цикле бросает CircularDependencyException, не
+    // меняя ячейку.
+    void Set(Edit edit);
+    // Применяет правки разных ячеек разом: перестраивает связи, один раз
+    // проверяет затронутую часть графа на циклы и один раз сбрасывает кеши
+    // зависимых формул. Из правок одной ячейки остаётся последняя. Ячейки,
+    // на которые ссылаются правки, должны существовать. При цикле бросает
+    // CircularDependencyException, оставляя ячейки и кеши как были.
+    static void ApplyBatch(std::vector<Edit>& edits);
+
+    // Содержимое из снимка листа. Текст формулы не разбирается, кеш
+    // восстанавливается как был. Связи с другими ячейками не создаются, пока
+    // не вызван AttachLoaded().
+    void LoadText(std::string text);
+    void LoadFormula(std::unique_ptr<FormulaInterface> formula, std::optional<NumericValue> cache);
+    // Связывает загруженную ячейку с графом зависимостей, как это делает
+    // Set(); формула без кеша становится грязной. Ячейки, на которые она
+    // ссылается, должны существовать.
+    void AttachLoaded();
+    // Формула ячейки либо nullptr.
+    const FormulaInterface* GetFormula() const;
+    // Значение формулы, если оно вычислено, не вычисляя его.
+    std::optional<NumericValue> GetCachedValue() const;
+
+    void CheckCyclic(const Position& pos, const std::vector<Position>& cells,
+        const std::vector<Range>& ranges);
     void UpdDependent(const Position& current_pos, const Position& dependent_pos);
     void RemoveDependencies();
     void Clear();
     void ClearCache();
+    bool IsReferenced() const;
+    bool IsEmpty() const;
+    bool IsDirty() const;
+    Position GetPosition() const;
+
+    // Вычисляет грязные ячейки в топологическом порядке: каждая формула
+    // вычисляется один раз и после всех ячеек, на которые она ссылается,
+    // поэтому вычисление не уходит в рекурсию. Множество очищается.
+    // С пулом потоков формула ставится в очередь, как только вычислены все
+    // её входы; результат тот же, что и при вычислении в одном потоке.
+    static void Recalculate(DirtyCells& dirty_cells, ThreadPool* pool = nullptr);
 
 
     Value GetValue() const override;
     std::string GetText() const override;
     std::vector<Position> GetReferencedCells() const override;
+    std::vector<Range> GetReferencedRanges() const;
+    NumericValue GetNumericValue() const override;
 
 private:
 
@@ -36,7 +105,11 @@ private:
         virtual Value GetValue() const = 0;
         virtual std::string GetText() const = 0;
         virtual std::vector<Position> GetReferencedCells() const;
+        virtual std::vector<Range> GetReferencedRanges() const;
         virtual void ClearCache();
+        virtual bool HasCache() const;
+        virtual NumericValue GetNumericValue() const = 0;
+        virtual const FormulaInterface* GetFormula() const;
 
         virtual ~Impl() = default;
     };
@@ -46,6 +119,7 @@ private:
 
         Value GetValue() const override;
         std::string GetText() const override;
+        NumericValue GetNumericValue() const override;
     };
 
     class TextImpl : public Impl {
@@ -54,33 +128,98 @@ private:
         explicit TextImpl(std::string text);
         Value GetValue() const override;
         std::string GetText() const override;
+        NumericValue GetNumericValue() const override;
 
     private:
         std::string text_;
+        // текст разбирается как число один раз, при задании ячейки
+        NumericValue number_;
     };
 
     class FormulaImpl : public Impl {
     public:
 
-        explicit FormulaImpl(std::string text, SheetInterface& sheet);
+        FormulaImpl(std::string text, Position pos, SheetInterface& sheet);
+        FormulaImpl(std::unique_ptr<FormulaInterface> formula, SheetInterface& sheet,
+            std::optional<FormulaInterface::Value> cache);
         Value GetValue() const override;
         std::string GetText() const override;
         void ClearCache() override;
+        bool HasCache() const override;
         std::vector<Position> GetReferencedCells() const override;
+        std::vector<Range> GetReferencedRanges() const override;
+        NumericValue GetNumericValue() const override;
+        // То же, но вычисленное значение записывается и в кеш столбца column,
+        // если он задан, до того как станет видно другим потокам.
+        NumericValue GetNumericValue(ColumnCache* column, int row) const;
+        const FormulaInterface* GetFormula() const override;
 
     private:
+        enum CacheState : std::uint8_t {
+            CACHE_EMPTY,
+            CACHE_COMPUTING,
+            CACHE_READY,
+        };
+
         std::unique_ptr<FormulaInterface> formula_ptr_;
         SheetInterface& sheet_prt_;
-        mutable std::optional<FormulaInterface::Value> cache_;
+        // Кеш читается без блокировок. Значение вычисляет и записывает поток,
+        // который перевёл состояние из CACHE_EMPTY в CACHE_COMPUTING, прочие
+        // читатели ждут CACHE_READY. Граф ацикличен, поэтому ожидающие потоки
+        // не ждут друг друга по кругу. Сбрасывается кеш только при изменении
+        // таблицы, когда читателей нет.
+        mutable std::atomic<std::uint8_t> cache_state_{ CACHE_EMPTY };
+        mutable FormulaInterface::Value cache_;
     };
 
-    std::unique_ptr<Impl> CreateImpl(std::string text);
-
+    static std::unique_ptr<Impl> CreateImpl(std::string text, Position pos, SheetInterface& sheet, Type& type);
+    void MarkDirty();
+    void AttachDependencies(const std::vector<Position>& cells, const std::vector<Range>& ranges);
+    // Удаляет связи, не трогая кеши столбцов.
+    void DetachDependencies();
+    static bool HasCycleThroughFormulas(const std::vector<Edit>& edits);
+
+    // Кеш столбца создаётся для первого диапазона, который на него ссылается,
+    // и заполняется значениями, уже известными ячейкам столбца.
+    void AcquireColumns(const Range& range);
+    void ReleaseColumns(const Range& range);
+    void WriteColumnValue(ColumnCache& column) const;
+    void SyncColumnValue() const;
+    void InvalidateColumnValue() const;
+
+    // Вызывает f(cell) для каждой формулы, которая ссылается на эту ячейку
+    // напрямую или через диапазон. Формула может встретиться несколько раз.
+    template <typename F>
+    void ForEachDependent(F&& f) const {
+        for (Cell* dependent : cells_dependent_on_this_) {
+            f(dependent);
+        }
+        graph_.range_dependents.ForEachContaining(pos_, f);
+    }
 
     std::unique_ptr<Impl> impl_;
     SheetInterface& sheet_;
-    std::set<Cell*> cells_dependent_on_this_;
-    std::set<Cell*> cells_this_depends_on_;
+    SmallPtrSet<Cell> cells_dependent_on_this_;
+    SmallPtrSet<Cell> cells_this_depends_on_;
+    DependencyGraph& graph_;
+    Position pos_;
 
     Type type_ = EMPTY;
+    bool dirty_ = false;
+    // место ячейки в graph_.dirty_cells, пока она грязная; оно же - номер ячейки
+    // в снимке графа, который строит Recalculate()
+    std::uint32_t dirty_index_ = 0;
+    // номер последнего обхода графа, посетившего ячейку
+    std::uint64_t visit_generation_ = 0;
+};
+
+struct Cell::Edit {
+    Cell* cell = nullptr;
+    Position pos;
+    // была ли ячейка пуста до правки
+    bool was_empty = true;
+    Type type = EMPTY;
+    std::unique_ptr<Impl> impl;
+    std::vector<Position> cells;
+    std::vector<Range> ranges;
 };
\ No newline at end of file
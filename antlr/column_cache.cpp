@@ -0,0 +1,84 @@
+#include "column_cache.h"
+
+#include <limits>
+
+namespace {
+int CountTrailingZeros(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int count = 0;
+    for (; (word & 1) == 0; word >>= 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+}  // namespace
+
+ColumnCache::ColumnCache()
+    : present_(WORDS)
+    , valid_(std::make_unique<std::atomic<std::uint64_t>[]>(WORDS)) {
+}
+
+void ColumnCache::Insert(int row) {
+    if (values_.size() <= static_cast<size_t>(row)) {
+        const int rows = (row / ROWS_STEP + 1) * ROWS_STEP;
+        values_.resize(rows < Position::MAX_ROWS ? rows : Position::MAX_ROWS);
+    }
+    present_[row / WORD_BITS] |= std::uint64_t{ 1 } << (row % WORD_BITS);
+    Invalidate(row);
+}
+
+void ColumnCache::Erase(int row) {
+    present_[row / WORD_BITS] &= ~(std::uint64_t{ 1 } << (row % WORD_BITS));
+    Invalidate(row);
+}
+
+void ColumnCache::Store(int row, const CellInterface::NumericValue& value) {
+    const double* number = std::get_if<double>(&value);
+    values_[row] = number != nullptr ? *number : std::numeric_limits<double>::quiet_NaN();
+    valid_[row / WORD_BITS].fetch_or(std::uint64_t{ 1 } << (row % WORD_BITS), std::memory_order_release);
+}
+
+void ColumnCache::Invalidate(int row) {
+    valid_[row / WORD_BITS].fetch_and(~(std::uint64_t{ 1 } << (row % WORD_BITS)), std::memory_order_relaxed);
+}
+
+int ColumnCache::FindRow(int row, int last, bool present) const {
+    while (row <= last) {
+        const int word = row / WORD_BITS;
+        std::uint64_t bits = present ? present_[word] : ~present_[word];
+        bits &= ~std::uint64_t{ 0 } << (row % WORD_BITS);
+        if (bits != 0) {
+            return std::min(word * WORD_BITS + CountTrailingZeros(bits), last + 1);
+        }
+        row = (word + 1) * WORD_BITS;
+    }
+    return last + 1;
+}
+
+ColumnCache* ColumnCaches::Acquire(int col) {
+    if (disabled_) {
+        return nullptr;
+    }
+    if (columns_.size() <= static_cast<size_t>(col)) {
+        columns_.resize(col + 1);
+    }
+    Column& column = columns_[col];
+    if (column.references++ > 0) {
+        return nullptr;
+    }
+    column.cache = std::make_unique<ColumnCache>();
+    return column.cache.get();
+}
+
+void ColumnCaches::Release(int col) {
+    if (disabled_) {
+        return;
+    }
+    Column& column = columns_[col];
+    if (--column.references == 0) {
+        column.cache.reset();
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Значения ячеек одного столбца в непрерывном массиве, чтобы агрегатные
+// функции читали диапазоны со скоростью памяти, а не по одной ячейке.
+// Для каждой строки хранятся два бита: ячейка непуста и её значение в массиве
+// актуально. Значение - число текста или вычисленное значение формулы, ошибка
+// записывается как NaN.
+// Непустота меняется только вместе с содержимым таблицы. Значения формул
+// записываются и при пересчёте в нескольких потоках: каждая ячейка пишет
+// только своё значение, а биты актуальности меняются атомарно.
+class ColumnCache {
+public:
+    ColumnCache();
+
+    // Ячейка стала непустой, её значение пока неизвестно.
+    void Insert(int row);
+    // Ячейка стала пустой.
+    void Erase(int row);
+    // Запоминает значение непустой ячейки.
+    void Store(int row, const CellInterface::NumericValue& value);
+    // Значение ячейки устарело.
+    void Invalidate(int row);
+
+    // Вызывает f(row) для непустых ячеек строк [first, last], значение
+    // которых неизвестно.
+    template <typename F>
+    void ForEachStale(int first, int last, F&& f) const {
+        for (int word = first / WORD_BITS; word <= last / WORD_BITS; ++word) {
+            std::uint64_t stale = present_[word] & ~valid_[word].load(std::memory_order_acquire)
+                & RowMask(word, first, last);
+            for (int bit = 0; stale != 0; ++bit, stale >>= 1) {
+                if (stale & 1) {
+                    f(word * WORD_BITS + bit);
+                }
+            }
+        }
+    }
+
+    // Вызывает f(row, values, count) для отрезков подряд идущих непустых
+    // ячеек строк [first, last]: values[i] - значение строки row + i.
+    // Значения отрезков должны быть актуальны, см. ForEachStale().
+    template <typename F>
+    void ForEachRun(int first, int last, F&& f) const {
+        int row = FindRow(first, last, true);
+        while (row <= last) {
+            const int end = FindRow(row, last, false);
+            f(row, values_.data() + row, static_cast<size_t>(end - row));
+            row = FindRow(end, last, true);
+        }
+    }
+
+private:
+    static constexpr int WORD_BITS = 64;
+    static constexpr int WORDS = Position::MAX_ROWS / WORD_BITS;
+    // массив значений растёт такими шагами
+    static constexpr int ROWS_STEP = 1024;
+
+    // биты строк [first, last] в слове word
+    static std::uint64_t RowMask(int word, int first, int last) {
+        const int begin = std::max(first - word * WORD_BITS, 0);
+        const int end = std::min(last - word * WORD_BITS, WORD_BITS - 1);
+        return (~std::uint64_t{ 0 } >> (WORD_BITS - 1 - end)) & (~std::uint64_t{ 0 } << begin);
+    }
+
+    // первая строка из [row, last] с битом непустоты, равным present, либо last + 1
+    int FindRow(int row, int last, bool present) const;
+
+    std::vector<double> values_;
+    std::vector<std::uint64_t> present_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> valid_;
+};
+
+// Кеши столбцов листа. Столбец кешируется, пока на него ссылается хотя бы
+// один диапазон формулы, остальные столбцы памяти не занимают.
+class ColumnCaches {
+public:
+    // Возвращает кеш столбца, если он создан этим вызовом и его нужно
+    // заполнить, иначе nullptr.
+    ColumnCache* Acquire(int col);
+    void Release(int col);
+    // Кеши больше не создаются: Acquire() возвращает nullptr.
+    void Disable() {
+        disabled_ = true;
+    }
+
+    ColumnCache* Find(int col) const {
+        return static_cast<size_t>(col) < columns_.size() ? columns_[col].cache.get() : nullptr;
+    }
+
+private:
+    struct Column {
+        std::unique_ptr<ColumnCache> cache;
+        size_t references = 0;
+    };
+
+    std::vector<Column> columns_;
+    bool disabled_ = false;
+};
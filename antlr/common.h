@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <iosfwd>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -33,6 +36,20 @@ struct Size {
     bool operator==(Size rhs) const;
 };
 
+// Прямоугольный диапазон ячеек, например A1:C3, вместе с угловыми ячейками.
+// from - верхний левый угол, to - нижний правый.
+struct Range {
+    Position from;
+    Position to;
+
+    bool operator==(Range rhs) const;
+    bool operator<(Range rhs) const;
+
+    bool IsValid() const;
+    bool Contains(Position pos) const;
+    std::string ToString() const;
+};
+
 // Описывает ошибки, которые могут возникнуть при вычислении формулы.
 class FormulaError {
 public:
@@ -56,6 +73,12 @@ private:
 
 std::ostream& operator<<(std::ostream& output, FormulaError fe);
 
+// Разбирает текст, представляющий число: необязательный знак, цифры с
+// необязательной десятичной точкой и необязательный порядок ("12", "-.5",
+// "3.", "1e-3"). Возвращает std::nullopt, если текст не является числом или
+// число не представимо в double.
+std::optional<double> ParseNumber(std::string_view text);
+
 // Исключение, выбрасываемое при попытке передать в метод некорректную позицию
 class InvalidPositionException : public std::out_of_range {
 public:
@@ -81,6 +104,8 @@ public:
     // Либо текст ячейки, либо значение формулы, либо сообщение об ошибке из
     // формулы
     using Value = std::variant<std::string, double, FormulaError>;
+    // Значение ячейки с точки зрения формулы: число либо ошибка
+    using NumericValue = std::variant<double, FormulaError>;
 
     virtual ~CellInterface() = default;
 
@@ -97,12 +122,53 @@ public:
     // формуле. Список отсортирован по возрастанию и не содержит повторяющихся
     // ячеек. В случае текстовой ячейки список пуст.
     virtual std::vector<Position> GetReferencedCells() const = 0;
+
+    // Возвращает значение ячейки в том виде, в котором его использует формула.
+    // Пустой текст трактуется как ноль, текст, представляющий число, - как это
+    // число, прочий текст - как ошибка #VALUE!. Ошибка формулы возвращается
+    // как есть.
+    virtual NumericValue GetNumericValue() const;
+};
+
+// Неизменяемое состояние таблицы после одного из её изменений, см.
+// SheetInterface::Snapshot(). Методы можно вызывать из любых потоков, в том
+// числе пока таблица изменяется; значения формул уже вычислены.
+class SheetViewInterface {
+public:
+    virtual ~SheetViewInterface() = default;
+
+    // Номер состояния. Каждое изменение таблицы после первого вызова
+    // Snapshot() увеличивает его на единицу.
+    virtual std::uint64_t GetVersion() const = 0;
+
+    // Ячейка в этом состоянии либо nullptr, если она пуста. Ячейка живёт,
+    // пока жив объект состояния.
+    virtual const CellInterface* GetCell(Position pos) const = 0;
+    virtual Size GetPrintableSize() const = 0;
+    // Выводят состояние так же, как одноимённые методы таблицы.
+    virtual void PrintValues(std::ostream& output) const = 0;
+    virtual void PrintTexts(std::ostream& output) const = 0;
 };
 
+class FrozenSheet;
+
 inline constexpr char FORMULA_SIGN = '=';
 inline constexpr char ESCAPE_SIGN = '\'';
 
 // Интерфейс таблицы
+// Константные методы таблицы и её ячеек можно вызывать из нескольких потоков
+// одновременно, пока таблица не изменяется: формулу без кеша вычисляет один
+// из читателей, остальные ждут её значения, общей блокировки нет. Таблица из
+// LoadSnapshot() читает блоки при обращении, поэтому перед чтением в
+// нескольких потоках её нужно загрузить, например вызовом Recalculate().
+// SetCell(), SetCells() и ClearCell() можно вызывать из нескольких потоков
+// одновременно: тексты разбираются параллельно, а связи ячеек, проверка
+// циклов и сброс кешей применяются по очереди, как если бы изменения шли
+// одно за другим. Число или текст в ячейке, которая не была формулой и на
+// которую не ссылаются ни формулы, ни диапазоны, SetCell() и ClearCell()
+// меняют, ожидая только изменений той же полосы из восьми строк. Чтение
+// таблицы с изменениями по-прежнему не пересекается, для этого есть
+// Snapshot().
 class SheetInterface {
 public:
     virtual ~SheetInterface() = default;
@@ -122,6 +188,14 @@ public:
     // начать текст со знака "=", но чтобы он не интерпретировался как формула.
     virtual void SetCell(Position pos, std::string text) = 0;
 
+    // Задаёт содержимое нескольких ячеек как одно изменение: результат тот же,
+    // что у вызовов SetCell() по порядку, но граф зависимостей перестраивается,
+    // проверяется на циклы и сбрасывает кеши один раз на весь пакет. Если
+    // ячейка встречается несколько раз, действует последний текст. Если хотя
+    // бы одна правка некорректна, бросается то же исключение, что и у
+    // SetCell(), и таблица не изменяется.
+    virtual void SetCells(std::vector<std::pair<Position, std::string>> cells) = 0;
+
     // Возвращает значение ячейки.
     // Если ячейка пуста, может вернуть nullptr.
     virtual const CellInterface* GetCell(Position pos) const = 0;
@@ -143,7 +217,74 @@ public:
     // соответственно. Пустая ячейка представляется пустой строкой в любом случае.
     virtual void PrintValues(std::ostream& output) const = 0;
     virtual void PrintTexts(std::ostream& output) const = 0;
+
+    // Вызывает f(pos, cell) для каждой непустой ячейки диапазона: по строкам,
+    // в строке слева направо. Пустые области диапазона не перебираются.
+    virtual void ForEachCellInRange(Range range,
+        const std::function<void(Position, const CellInterface&)>& f) const = 0;
+
+    // Вызывает f(first, values, count) для отрезков подряд идущих непустых
+    // ячеек диапазона, по столбцам: values[i] - число на i строк ниже first,
+    // ошибка представлена NaN, а её категорию хранит сама ячейка. Порядок
+    // отличается от ForEachCellInRange(), поэтому первую по строкам ошибку
+    // диапазона вызывающий находит сам, сравнивая позиции. Возвращает false и
+    // не вызывает f, если таблица не хранит значения этих столбцов подряд;
+    // тогда диапазон читается через ForEachCellInRange().
+    virtual bool ForEachValueRun(Range range,
+        const std::function<void(Position, const double*, size_t)>& f) const;
+
+    // Пересчитывает формулы, затронутые изменениями с прошлого пересчёта.
+    // Каждая такая формула вычисляется один раз, после ячеек, на которые она
+    // ссылается. Без вызова Recalculate() формулы вычисляются при обращении к
+    // значению, как и раньше.
+    virtual void Recalculate() = 0;
+
+    // Задаёт число потоков, на которых Recalculate() вычисляет независимые
+    // формулы, а SetCells() разбирает тексты большого пакета. По умолчанию
+    // используется один поток. Результат от числа потоков не зависит.
+    virtual void SetRecalculationThreads(size_t threads) = 0;
+
+    // Записывает таблицу в двоичный снимок: тексты ячеек, скомпилированные
+    // формулы и значения формул, которые уже вычислены, см. Recalculate().
+    // Снимок открывается LoadSnapshot() без разбора формул. Бросает
+    // std::runtime_error, если запись в поток не удалась.
+    virtual void SaveSnapshot(std::ostream& output) const = 0;
+
+    // Возвращает состояние таблицы после последнего завершённого изменения.
+    // Состояние не меняется, когда таблица изменяется дальше, и освобождается,
+    // когда его больше никто не держит. Можно вызывать из любого потока
+    // одновременно с изменениями таблицы. Первый вызов вычисляет все формулы и
+    // строит состояние целиком. Изменения таблицы только отмечают его
+    // устаревшим, а следующий вызов пересчитывает затронутые формулы и
+    // копирует только изменённые ячейки; без изменений вызов лишь читает
+    // указатель. Вызов после изменений, как и изменение, не должен
+    // пересекаться с чтением самой таблицы в других потоках.
+    virtual std::shared_ptr<const SheetViewInterface> Snapshot() = 0;
+
+    // Создаёт независимую копию таблицы в её текущем состоянии, см. Snapshot().
+    // Копия и таблица дальше изменяются порознь. Копия не дублирует ячейки,
+    // скомпилированные формулы и вычисленные значения, а ссылается на общее
+    // состояние и хранит только то, что в ней изменено, вместе с формулами,
+    // которые от изменений зависят. Поэтому копирование занимает постоянное
+    // время, кроме первого вызова Snapshot(), а память растёт с числом правок.
+    virtual std::unique_ptr<SheetInterface> Fork() = 0;
+
+    // Вычисляет все формулы и возвращает неизменяемую копию таблицы для
+    // чтения, см. FrozenSheet. Копия не связана с таблицей: она занимает
+    // меньше памяти, быстрее читается и не требует синхронизации между
+    // читателями. Вызов, как и изменение, не должен пересекаться с чтением
+    // самой таблицы в других потоках.
+    virtual std::unique_ptr<const FrozenSheet> Freeze() = 0;
 };
 
 // Создаёт готовую к работе пустую таблицу.
-std::unique_ptr<SheetInterface> CreateSheet();
\ No newline at end of file
+std::unique_ptr<SheetInterface> CreateSheet();
+
+// Открывает таблицу из файла, записанного SaveSnapshot(). Файл отображается в
+// память, ячейки читаются из него блоками при первом обращении, поэтому время
+// открытия от размера таблицы не зависит. Перед первым изменением таблицы или
+// вызовом Recalculate() загружаются все ячейки, после чего файл больше не
+// нужен. До этого файл не должен меняться. Бросает std::runtime_error, если
+// файл не удалось прочитать или он не является снимком, в том числе при
+// чтении блока.
+std::unique_ptr<SheetInterface> LoadSnapshot(const std::string& path);
\ No newline at end of file
@@ -5,8 +5,11 @@
 #include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <mutex>
+#include <optional>
 #include <sstream>
-#include <set>
+#include <string>
+#include <unordered_map>
 
 using namespace std::literals;
 
@@ -15,47 +18,152 @@ std::ostream& operator<<(std::ostream& output, FormulaError fe) {
 }
 
 namespace {
+// Скомпилированные формулы, общие для всех ячеек с одинаковым шаблоном
+// формулы в относительной записи (=A1*B1 в C1 и =A2*B2 в C2). Таблица хранит
+// слабые ссылки, поэтому формула освобождается вместе с последней ячейкой,
+// которая её использует.
+class FormulaCache {
+public:
+    std::shared_ptr<const FormulaAST> Get(const std::string& expression, Position anchor) {
+        auto key = MakeRelativeFormulaKey(expression, anchor);
+        if (!key) {
+            // выражение некорректно, разбор сообщит об ошибке
+            return Compile(expression, anchor);
+        }
+
+        {
+            std::lock_guard guard(mutex_);
+            auto it = asts_.find(*key);
+            if (it != asts_.end()) {
+                if (auto ast = it->second.lock()) {
+                    return ast;
+                }
+            }
+        }
+
+        auto ast = Compile(expression, anchor);
+
+        std::lock_guard guard(mutex_);
+        auto& entry = asts_[std::move(*key)];
+        if (auto existing = entry.lock()) {
+            return existing;
+        }
+        entry = ast;
+        if (asts_.size() >= sweep_at_) {
+            RemoveExpired();
+        }
+        return ast;
+    }
+
+private:
+    static constexpr size_t MIN_SWEEP_SIZE = 1024;
+
+    static std::shared_ptr<const FormulaAST> Compile(const std::string& expression, Position anchor) {
+        FormulaAST ast = ParseFormulaAST(expression);
+        ast.MakeRelativeTo(anchor);
+        return std::make_shared<const FormulaAST>(std::move(ast));
+    }
+
+    void RemoveExpired() {
+        for (auto it = asts_.begin(); it != asts_.end();) {
+            if (it->second.expired()) {
+                it = asts_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        sweep_at_ = std::max(MIN_SWEEP_SIZE, asts_.size() * 2);
+    }
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::weak_ptr<const FormulaAST>> asts_;
+    size_t sweep_at_ = MIN_SWEEP_SIZE;
+};
+
+FormulaCache& GetFormulaCache() {
+    static FormulaCache cache;
+    return cache;
+}
+
 class Formula : public FormulaInterface {
 public:
 // Реализуйте следующие методы:
-    explicit Formula(std::string expression)
-        :ast_(ParseFormulaAST(expression)) {}
+    Formula(const std::string& expression, Position anchor)
+        : ast_(GetFormulaCache().Get(expression, anchor))
+        , anchor_(anchor) {}
+
+    Formula(std::shared_ptr<const FormulaAST> ast, Position anchor, std::string expression)
+        : ast_(std::move(ast))
+        , anchor_(anchor)
+        , expression_(std::move(expression)) {}
 
     Value Evaluate(const SheetInterface& args) const override {
-        try {
-            return ast_.Execute(args);
-        }
-        catch (const FormulaError& e) {
-            return e;
-        }
+        return ast_->Execute(args, anchor_);
     }
 
     std::string GetExpression() const override {
+        if (expression_) {
+            return *expression_;
+        }
         std::stringstream ss;
-        ast_.PrintFormula(ss);
+        ast_->PrintFormula(ss, anchor_);
         return ss.str();
     }
 
     std::vector<Position> GetReferencedCells() const override {
-        std::set<Position> cells;
-        for (Position pos : ast_.GetCells()) {
-            if (pos.IsValid()) {
-                cells.insert(pos);
+        // смещения в AST отсортированы, а сдвиг на anchor_ порядок сохраняет
+        std::vector<Position> result;
+        for (Position offset : ast_->GetCells()) {
+            Position pos{ offset.row + anchor_.row, offset.col + anchor_.col };
+            if (pos.IsValid() && (result.empty() || !(result.back() == pos))) {
+                result.push_back(pos);
             }
         }
 
-        std::vector<Position> result(cells.begin(), cells.end());
+        return result;
+    }
+
+    std::vector<Range> GetReferencedRanges() const override {
+        std::vector<Range> result;
+        for (Range offset : ast_->GetRanges()) {
+            Range range{ { offset.from.row + anchor_.row, offset.from.col + anchor_.col },
+                { offset.to.row + anchor_.row, offset.to.col + anchor_.col } };
+            if (range.IsValid() && (result.empty() || !(result.back() == range))) {
+                result.push_back(range);
+            }
+        }
 
         return result;
     }
 
+    const std::shared_ptr<const FormulaAST>& GetAST() const {
+        return ast_;
+    }
+
 private:
-    FormulaAST ast_;
+    std::shared_ptr<const FormulaAST> ast_;
+    Position anchor_;
+    // текст формулы, загруженной из снимка
+    std::optional<std::string> expression_;
 };
 }  // namespace
 
 std::unique_ptr<FormulaInterface> ParseFormula(std::string expression) {
-    return std::make_unique<Formula>(std::move(expression));
+    return ParseFormula(std::move(expression), Position{});
+}
+
+std::unique_ptr<FormulaInterface> ParseFormula(std::string expression, Position anchor) {
+    return std::make_unique<Formula>(expression, anchor);
+}
+
+std::shared_ptr<const FormulaAST> GetFormulaAST(const FormulaInterface& formula) {
+    return static_cast<const Formula&>(formula).GetAST();
+}
+
+std::unique_ptr<FormulaInterface> MakeFormula(std::shared_ptr<const FormulaAST> ast, Position anchor,
+    std::string expression) {
+    return std::make_unique<Formula>(std::move(ast), anchor, std::move(expression));
 }
 
 FormulaError::FormulaError(Category category)
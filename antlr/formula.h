@@ -3,12 +3,22 @@
 #include "common.h"
 
 #include <memory>
+#include <string>
 #include <vector>
 
+class FormulaAST;
+
 // Формула, позволяющая вычислять и обновлять арифметическое выражение.
 // Поддерживаемые возможности:
 // * Простые бинарные операции и числа, скобки: 1+2*3, 2.5*(2+3.5/7)
 // * Значения ячеек в качестве переменных: A1+B2*C3
+// * Диапазоны ячеек: A1:C3. Вне функций диапазон из одной ячейки означает её
+//   значение, больший диапазон - ошибку #VALUE!.
+// * Сравнения = <> < <= > >=, результат - 1 или 0.
+// * Функции SUM, MIN, MAX, AVERAGE, AND, OR, COUNT, аргументы которых - числа
+//   или диапазоны; пустые ячейки диапазона пропускаются, COUNT считает
+//   числовые значения. IF(условие, да[, нет]) вычисляет только выбранную
+//   ветвь.
 // Ячейки, указанные в формуле, могут быть как формулами, так и текстом. Если это
 // текст, но он представляет число, тогда его нужно трактовать как число. Пустая
 // ячейка или ячейка с пустым текстом трактуется как число ноль.
@@ -34,8 +44,27 @@ public:
     // формулы. Список отсортирован по возрастанию и не содержит повторяющихся
     // ячеек.
     virtual std::vector<Position> GetReferencedCells() const = 0;
+
+    // Возвращает диапазоны, на которые ссылается формула, например A1:C3.
+    // Ячейки диапазонов в GetReferencedCells() не входят. Список отсортирован
+    // по возрастанию и не содержит повторов.
+    virtual std::vector<Range> GetReferencedRanges() const = 0;
 };
 
 // Парсит переданное выражение и возвращает объект формулы.
 // Бросает FormulaException в случае, если формула синтаксически некорректна.
-std::unique_ptr<FormulaInterface> ParseFormula(std::string expression);
\ No newline at end of file
+std::unique_ptr<FormulaInterface> ParseFormula(std::string expression);
+
+// То же для формулы ячейки anchor. Формулы, совпадающие в относительной записи
+// (=A1*B1 в C1 и =A2*B2 в C2), разделяют одно скомпилированное выражение.
+std::unique_ptr<FormulaInterface> ParseFormula(std::string expression, Position anchor);
+
+// Скомпилированное выражение формулы, созданной функциями этого файла. Нужно
+// для сохранения листа в снимок.
+std::shared_ptr<const FormulaAST> GetFormulaAST(const FormulaInterface& formula);
+
+// Формула ячейки anchor из готового выражения, например загруженного из
+// снимка. GetExpression() возвращает переданный текст expression: у
+// загруженного выражения нет дерева, по которому его можно напечатать.
+std::unique_ptr<FormulaInterface> MakeFormula(std::shared_ptr<const FormulaAST> ast, Position anchor,
+    std::string expression);
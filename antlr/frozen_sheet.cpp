@@ -0,0 +1,180 @@
+#include "frozen_sheet.h"
+
+#include "output_buffer.h"
+
+#include <algorithm>
+#include <variant>
+
+FrozenSheet::FrozenCell::FrozenCell(const FrozenSheet& sheet, std::uint32_t index)
+    : sheet_(&sheet)
+    , index_(index) {
+}
+
+CellInterface::Value FrozenSheet::FrozenCell::GetValue() const {
+    if (sheet_->flags_[index_] & IS_FORMULA) {
+        return std::visit([](auto value) {
+            return Value(value);
+        }, sheet_->GetNumericValue(index_));
+    }
+    std::string_view text = sheet_->GetText(index_);
+    if (text[0] == ESCAPE_SIGN) {
+        text.remove_prefix(1);
+    }
+    return std::string(text);
+}
+
+std::string FrozenSheet::FrozenCell::GetText() const {
+    return std::string(sheet_->GetText(index_));
+}
+
+std::vector<Position> FrozenSheet::FrozenCell::GetReferencedCells() const {
+    return std::vector<Position>(sheet_->references_.begin() + sheet_->reference_offsets_[index_],
+        sheet_->references_.begin() + sheet_->reference_offsets_[index_ + 1]);
+}
+
+CellInterface::NumericValue FrozenSheet::FrozenCell::GetNumericValue() const {
+    return sheet_->GetNumericValue(index_);
+}
+
+FrozenSheet::FrozenSheet(const SheetInterface& sheet, std::uint64_t version)
+    : version_(version)
+    , printable_size_(sheet.GetPrintableSize())
+    , row_offsets_(printable_size_.rows + 1, 0)
+    , text_offsets_{ 0 }
+    , reference_offsets_{ 0 } {
+    if (printable_size_.rows > 0 && printable_size_.cols > 0) {
+        const Range all{ { 0, 0 }, { printable_size_.rows - 1, printable_size_.cols - 1 } };
+        sheet.ForEachCellInRange(all, [this](Position pos, const CellInterface& cell) {
+            ++row_offsets_[pos.row + 1];
+            cols_.push_back(static_cast<std::uint16_t>(pos.col));
+
+            texts_ += cell.GetText();
+            text_offsets_.push_back(texts_.size());
+
+            std::uint8_t flags = std::holds_alternative<std::string>(cell.GetValue()) ? 0 : IS_FORMULA;
+            const CellInterface::NumericValue value = cell.GetNumericValue();
+            if (const FormulaError* error = std::get_if<FormulaError>(&value)) {
+                flags |= IS_ERROR | static_cast<std::uint8_t>(error->GetCategory()) << CATEGORY_SHIFT;
+                numbers_.push_back(0.0);
+            }
+            else {
+                numbers_.push_back(std::get<double>(value));
+            }
+            flags_.push_back(flags);
+
+            for (Position referenced : cell.GetReferencedCells()) {
+                references_.push_back(referenced);
+            }
+            reference_offsets_.push_back(static_cast<std::uint32_t>(references_.size()));
+        });
+    }
+    for (size_t row = 1; row < row_offsets_.size(); ++row) {
+        row_offsets_[row] += row_offsets_[row - 1];
+    }
+    // массивы росли по одной ячейке, запас ёмкости больше не нужен
+    cols_.shrink_to_fit();
+    texts_.shrink_to_fit();
+    text_offsets_.shrink_to_fit();
+    flags_.shrink_to_fit();
+    numbers_.shrink_to_fit();
+    reference_offsets_.shrink_to_fit();
+    references_.shrink_to_fit();
+
+    cells_.reserve(cols_.size());
+    for (size_t index = 0; index < cols_.size(); ++index) {
+        cells_.emplace_back(*this, static_cast<std::uint32_t>(index));
+    }
+}
+
+std::uint64_t FrozenSheet::GetVersion() const {
+    return version_;
+}
+
+size_t FrozenSheet::Find(Position pos) const {
+    if (!pos.IsValid()) {
+        throw InvalidPositionException("Get Cell: out of range");
+    }
+    if (pos.row >= printable_size_.rows) {
+        return cols_.size();
+    }
+    const auto begin = cols_.begin() + row_offsets_[pos.row];
+    const auto end = cols_.begin() + row_offsets_[pos.row + 1];
+    const auto it = std::lower_bound(begin, end, pos.col);
+    return it != end && *it == pos.col ? it - cols_.begin() : cols_.size();
+}
+
+const CellInterface* FrozenSheet::GetCell(Position pos) const {
+    const size_t index = Find(pos);
+    return index < cells_.size() ? &cells_[index] : nullptr;
+}
+
+Size FrozenSheet::GetPrintableSize() const {
+    return printable_size_;
+}
+
+std::string_view FrozenSheet::GetText(Position pos) const {
+    const size_t index = Find(pos);
+    return index < cols_.size() ? GetText(index) : std::string_view();
+}
+
+CellInterface::NumericValue FrozenSheet::GetNumericValue(Position pos) const {
+    const size_t index = Find(pos);
+    return index < cols_.size() ? GetNumericValue(index) : 0.0;
+}
+
+std::string_view FrozenSheet::GetText(size_t index) const {
+    return std::string_view(texts_).substr(text_offsets_[index], text_offsets_[index + 1] - text_offsets_[index]);
+}
+
+CellInterface::NumericValue FrozenSheet::GetNumericValue(size_t index) const {
+    const std::uint8_t flags = flags_[index];
+    if (flags & IS_ERROR) {
+        return FormulaError(static_cast<FormulaError::Category>(flags >> CATEGORY_SHIFT));
+    }
+    return numbers_[index];
+}
+
+void FrozenSheet::WriteValue(OutputBuffer& buffer, size_t index) const {
+    const std::uint8_t flags = flags_[index];
+    if (!(flags & IS_FORMULA)) {
+        std::string_view text = GetText(index);
+        if (text[0] == ESCAPE_SIGN) {
+            text.remove_prefix(1);
+        }
+        buffer.Write(text);
+    }
+    else if (flags & IS_ERROR) {
+        buffer.Write(FormulaError(static_cast<FormulaError::Category>(flags >> CATEGORY_SHIFT)));
+    }
+    else {
+        buffer.Write(numbers_[index]);
+    }
+}
+
+void FrozenSheet::PrintValues(std::ostream& output) const {
+    PrintCells(output, [this](OutputBuffer& buffer, size_t index) {
+        WriteValue(buffer, index);
+    });
+}
+
+void FrozenSheet::PrintTexts(std::ostream& output) const {
+    PrintCells(output, [this](OutputBuffer& buffer, size_t index) {
+        buffer.Write(GetText(index));
+    });
+}
+
+template <typename CellPrinter>
+void FrozenSheet::PrintCells(std::ostream& output, CellPrinter print_cell) const {
+    OutputBuffer buffer(output);
+    for (int row = 0; row < printable_size_.rows; ++row) {
+        int tabs = 0;
+        for (size_t index = row_offsets_[row]; index < row_offsets_[row + 1]; ++index) {
+            buffer.Put('\t', cols_[index] - tabs);
+            tabs = cols_[index];
+            print_cell(buffer, index);
+        }
+        buffer.Put('\t', printable_size_.cols - 1 - tabs);
+        buffer.Put('\n');
+    }
+    buffer.Flush();
+}
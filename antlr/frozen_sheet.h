@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class OutputBuffer;
+
+// Неизменяемая копия таблицы для чтения, см. SheetInterface::Freeze().
+// Ячейки лежат в плоских массивах в порядке строк: столбцы ячеек с
+// началами строк, тексты подряд в одной строке, вычисленные значения и
+// ссылки формул в виде смещений в общем массиве. Ячейка находится двоичным
+// поиском по столбцам своей строки. Ни связей графа, ни формул, ни кешей в
+// копии нет, поэтому она в несколько раз меньше таблицы, а читать её можно
+// из любого числа потоков без синхронизации.
+class FrozenSheet : public SheetViewInterface {
+public:
+    // Копирует непустые ячейки sheet. Формулы без кеша вычисляются, поэтому
+    // лучше сначала вызвать sheet.Recalculate(). version - номер состояния,
+    // который возвращает GetVersion().
+    explicit FrozenSheet(const SheetInterface& sheet, std::uint64_t version = 0);
+
+    // Ячейки ссылаются на копию, поэтому она не копируется и не перемещается.
+    FrozenSheet(const FrozenSheet&) = delete;
+    FrozenSheet& operator=(const FrozenSheet&) = delete;
+
+    std::uint64_t GetVersion() const override;
+    const CellInterface* GetCell(Position pos) const override;
+    Size GetPrintableSize() const override;
+    void PrintValues(std::ostream& output) const override;
+    void PrintTexts(std::ostream& output) const override;
+
+    // То же, что GetCell(pos)->GetText() и GetCell(pos)->GetNumericValue(),
+    // но без обращения к ячейке и копирования текста. Для пустой ячейки -
+    // пустой текст и ноль.
+    std::string_view GetText(Position pos) const;
+    CellInterface::NumericValue GetNumericValue(Position pos) const;
+
+private:
+    class FrozenCell : public CellInterface {
+    public:
+        FrozenCell(const FrozenSheet& sheet, std::uint32_t index);
+
+        Value GetValue() const override;
+        std::string GetText() const override;
+        std::vector<Position> GetReferencedCells() const override;
+        NumericValue GetNumericValue() const override;
+
+    private:
+        const FrozenSheet* sheet_;
+        std::uint32_t index_;
+    };
+
+    enum : std::uint8_t {
+        IS_FORMULA = 1,
+        // числовое значение - ошибка, её категория в старших битах
+        IS_ERROR = 2,
+        CATEGORY_SHIFT = 4,
+    };
+
+    static_assert(Position::MAX_COLS <= 1 << 16, "columns must fit into 16 bits");
+
+    // номер ячейки pos в массивах либо cols_.size(), если она пуста
+    size_t Find(Position pos) const;
+
+    std::string_view GetText(size_t index) const;
+    CellInterface::NumericValue GetNumericValue(size_t index) const;
+    // значение ячейки, как его возвращает CellInterface::GetValue()
+    void WriteValue(OutputBuffer& buffer, size_t index) const;
+
+    template <typename CellPrinter>
+    void PrintCells(std::ostream& output, CellPrinter print_cell) const;
+
+    std::uint64_t version_ = 0;
+    Size printable_size_;
+
+    // ячейки строки row - [row_offsets_[row], row_offsets_[row + 1])
+    std::vector<std::uint32_t> row_offsets_;
+    std::vector<std::uint16_t> cols_;
+    // текст ячейки i - [text_offsets_[i], text_offsets_[i + 1]) в texts_
+    std::string texts_;
+    std::vector<size_t> text_offsets_;
+    std::vector<std::uint8_t> flags_;
+    // числовое значение ячейки, если это не ошибка
+    std::vector<double> numbers_;
+    // ссылки формулы i - [reference_offsets_[i], reference_offsets_[i + 1])
+    std::vector<std::uint32_t> reference_offsets_;
+    std::vector<Position> references_;
+    std::vector<FrozenCell> cells_;
+};
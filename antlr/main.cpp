@@ -1,7 +1,25 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
 #include <limits>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include "FormulaAST.h"
+#include "aggregate_kernels.h"
+#include "column_cache.h"
 #include "common.h"
 #include "formula.h"
+#include "frozen_sheet.h"
+#include "range_index.h"
+#include "small_ptr_set.h"
+#include "snapshot.h"
 #include "test_runner_p.h"
+#include "text_import.h"
 
 inline std::ostream& operator<<(std::ostream& output, Position pos) {
     return output << "(" << pos.row << ", " << pos.col << ")";
@@ -351,6 +369,1732 @@ namespace {
         ASSERT(caught);
         ASSERT_EQUAL(sheet->GetCell("M6"_pos)->GetText(), "Ready");
     }
+
+    void TestBlockStorage() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("H8"_pos, "2");
+        sheet->SetCell("I9"_pos, "3");
+        sheet->SetCell("XFD16384"_pos, "=A1+H8+I9");
+
+        ASSERT_EQUAL(sheet->GetCell("XFD16384"_pos)->GetValue(), CellInterface::Value(6.0));
+        ASSERT(sheet->GetCell("H9"_pos) == nullptr);
+        ASSERT(sheet->GetCell("XFC16384"_pos) == nullptr);
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ Position::MAX_ROWS, Position::MAX_COLS }));
+
+        sheet->ClearCell("XFD16384"_pos);
+        ASSERT(sheet->GetCell("XFD16384"_pos) == nullptr);
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 9, 9 }));
+    }
+
+    void TestClearReferencedCell() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "5");
+        sheet->SetCell("B1"_pos, "=A1*2");
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(), CellInterface::Value(10.0));
+
+        sheet->ClearCell("A1"_pos);
+        const CellInterface* cleared = sheet->GetCell("A1"_pos);
+        ASSERT(cleared == nullptr || cleared->GetText().empty());
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(), CellInterface::Value(0.0));
+
+        sheet->SetCell("A1"_pos, "7");
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(), CellInterface::Value(14.0));
+    }
+
+    void TestPrintableSizeTracking() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "=D10");
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 1, 1 }));
+
+        sheet->SetCell("C5"_pos, "text");
+        sheet->SetCell("B7"_pos, "=1");
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 7, 3 }));
+
+        sheet->ClearCell("B7"_pos);
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 5, 3 }));
+
+        sheet->SetCell("C5"_pos, "");
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 1, 1 }));
+
+        try {
+            sheet->SetCell("E5"_pos, "=1+");
+        }
+        catch (const FormulaException&) {
+        }
+        ASSERT(sheet->GetCell("E5"_pos) == nullptr);
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 1, 1 }));
+
+        sheet->ClearCell("A1"_pos);
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 0, 0 }));
+    }
+
+    void TestPrintSparseSheet() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("B1"_pos, "'=text");
+        sheet->SetCell("J3"_pos, "=1/3");
+        sheet->SetCell("A20"_pos, "=J3*1e20");
+        sheet->SetCell("C20"_pos, "=1/0");
+        sheet->SetCell("K25"_pos, "=Z100");
+        sheet->SetCell("D5"_pos, "x");
+        sheet->ClearCell("D5"_pos);
+
+        auto print_cell_by_cell = [&](std::ostream& output, bool values) {
+            Size size = sheet->GetPrintableSize();
+            for (int row = 0; row < size.rows; ++row) {
+                for (int col = 0; col < size.cols; ++col) {
+                    if (col > 0) {
+                        output << '\t';
+                    }
+                    if (const CellInterface* cell = sheet->GetCell({ row, col })) {
+                        if (values) {
+                            output << cell->GetValue();
+                        }
+                        else {
+                            output << cell->GetText();
+                        }
+                    }
+                }
+                output << '\n';
+            }
+        };
+
+        for (bool values : { true, false }) {
+            std::ostringstream expected;
+            std::ostringstream actual;
+            print_cell_by_cell(expected, values);
+            values ? sheet->PrintValues(actual) : sheet->PrintTexts(actual);
+            ASSERT_EQUAL(actual.str(), expected.str());
+        }
+
+        std::ostringstream expected;
+        std::ostringstream actual;
+        expected << std::fixed << std::setprecision(2);
+        actual << std::fixed << std::setprecision(2);
+        print_cell_by_cell(expected, true);
+        sheet->PrintValues(actual);
+        ASSERT_EQUAL(actual.str(), expected.str());
+    }
+
+    void TestBytecodeMatchesTree() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "3");
+        sheet->SetCell("A2"_pos, "=A1/4");
+        sheet->SetCell("B1"_pos, "text");
+        sheet->SetCell("B2"_pos, "=1/0");
+
+        auto execute = [&](const FormulaAST& ast, bool tree) {
+            return std::visit([](auto value) {
+                return CellInterface::Value(value);
+            }, tree ? ast.ExecuteTree(*sheet) : ast.Execute(*sheet));
+        };
+
+        for (std::string expression : { "1", "-(2+3)*+4", "A1*A2-A1/A2", "((A1))+-(-A2)", "1/(A1-3)",
+                                        "A1+B1", "B2*0", "C3*2+1e3", "1-2-3-4-5*6/7/8/9", "IF(A1>2,B2,A2)",
+                                        "IF(B2,1,2)", "IF(0,B2)", "SUM(A1:B2)", "SUM(A1:A2,5)*MAX(A1,A2:A2)",
+                                        "AVERAGE(C1:C9)", "AND(A1,A2)+OR(0,C1:C3)", "IF(A1<3,1,IF(A1=3,2,3))",
+                                        "MIN(A1:A2)<=A2", "-IF(1,2)*IF(A1<>3,4,5)",
+                                        "COUNT(A1:C3,1/0,B2)" }) {
+            FormulaAST ast = ParseFormulaAST(expression);
+            ASSERT_EQUAL(execute(ast, false), execute(ast, true));
+        }
+    }
+
+    void TestErrorPropagation() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "abc");
+        sheet->SetCell("A2"_pos, "=1/0");
+        sheet->SetCell("B1"_pos, "=A1*1e300*1e300");
+        sheet->SetCell("B2"_pos, "=-A2+1");
+        sheet->SetCell("B3"_pos, "=B1+B2");
+
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(),
+            CellInterface::Value(FormulaError::Category::Value));
+        ASSERT_EQUAL(sheet->GetCell("B2"_pos)->GetValue(),
+            CellInterface::Value(FormulaError::Category::Div0));
+        ASSERT_EQUAL(sheet->GetCell("B3"_pos)->GetValue(),
+            CellInterface::Value(FormulaError::Category::Value));
+
+        sheet->SetCell("A1"_pos, "2");
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(),
+            CellInterface::Value(FormulaError::Category::Div0));
+    }
+
+    void TestNumericText() {
+        auto sheet = CreateSheet();
+        auto value_of = [&](std::string text) {
+            sheet->SetCell("A1"_pos, std::move(text));
+            sheet->SetCell("B1"_pos, "=A1*1");
+            return sheet->GetCell("B1"_pos)->GetValue();
+        };
+        const CellInterface::Value not_a_number = FormulaError(FormulaError::Category::Value);
+
+        ASSERT_EQUAL(value_of("12"), CellInterface::Value(12.0));
+        ASSERT_EQUAL(value_of("+3"), CellInterface::Value(3.0));
+        ASSERT_EQUAL(value_of("-2e3"), CellInterface::Value(-2000.0));
+        ASSERT_EQUAL(value_of("1."), CellInterface::Value(1.0));
+        ASSERT_EQUAL(value_of(".5"), CellInterface::Value(0.5));
+        ASSERT_EQUAL(value_of("2.5E-1"), CellInterface::Value(0.25));
+        ASSERT_EQUAL(value_of("'7"), CellInterface::Value(7.0));
+        ASSERT_EQUAL(value_of("'"), CellInterface::Value(0.0));
+        ASSERT_EQUAL(value_of("."), not_a_number);
+        ASSERT_EQUAL(value_of("1e"), not_a_number);
+        ASSERT_EQUAL(value_of("1.2.3"), not_a_number);
+        ASSERT_EQUAL(value_of(" 1"), not_a_number);
+        ASSERT_EQUAL(value_of("0x10"), not_a_number);
+        ASSERT_EQUAL(value_of("inf"), not_a_number);
+        ASSERT_EQUAL(value_of("1e999"), not_a_number);
+    }
+
+    //   : ,      .
+    std::string DescribeParse(const std::string& expression, FormulaParserBackend backend) {
+        try {
+            FormulaAST ast = ParseFormulaAST(expression, backend);
+            std::ostringstream out;
+            ast.Print(out);
+            out << " | ";
+            ast.PrintFormula(out);
+            out << " | ";
+            ast.PrintCells(out);
+            return out.str();
+        }
+        catch (const FormulaException&) {
+            return "FormulaException";
+        }
+    }
+
+    void TestParserBackendsAgree() {
+        std::vector<std::string> corpus = {
+            "1", "  42  ", "-1", "+-+1", "1+2*3", "(1+2)*3", "1-2-3", "1-(2-3)", "8/4/2", "8/(4/2)",
+            "-(1+2)", "-1*2", "2*-3", "--1", "1 - -1", "((((1))))", "1e5", "1E+5", "2.5e-3", ".5",
+            "0.5", "00012", "1e308*10", "1e-999", "A1", "A1+B2*C3", "ZZZ1", "XFD16384", "A1/(B1-C1)",
+            "\t1 +\n2\r", "A1+A2+A1+A3+A1+A2+A1", "3.14159265358979", "123456789012345678901234567890",
+            "A1:B2", "B2:A1", " A1 : C3 ", "A1:A1*2", "-A1:B2", "A1:B2+A1+B2:C3",
+            "SUM(A1:B2,3)", "IF(A1>0,1,2)", "1<2=1", "A1<>B1", "-(1<2)", "MAX(1)", "AND(1,0)",
+            "SUM( A1 , 2 )", "SUM (1)", "1<=2>=3", "IF(1,2,IF(3,4))*2", "OR(A1:A3)+AVERAGE(1,2)",
+            //  
+            "", " ", "1+", "+", "(1", "1)", "()", "1 2", "A1 B2", "A2B", "3X", "A0++", "((1)",
+            "2+4-", "1.", ".", "1..2", "1.2.3", "1e", "1e+", "e5", "a1", "A", "A-1", "X0", "ABCD1",
+            "A123456", "XFE16384", "R2D2", "1e999", "1 # 2", "=1", "1,5",
+            "A1:", ":A1", "A1:B2:C3", "A1:1", "1:A1", "A1:XFE1", "(A1):B2",
+            "SUM()", "FOO(1)", "IF(1)", "IF(1,2,3,4)", "SUM(1,)", "SUM(,1)", "SUM", "SUM(1", "1<",
+            "<1", "1=<2", "1>>2", "1,2", "Sum(1)",
+        };
+
+        std::mt19937 generator(2024);
+        const std::vector<std::string> pieces = {
+            "1", "23", "4.5", ".6", "7e8", "9E-1", "A1", "BC22", "XFD1", "(", ")", "+", "-", "*", "/",
+            " ", "e", ".", "Z", "0", ":", "SUM(", "IF(", ",", "<", ">=", "=",
+        };
+        for (int i = 0; i < 2000; ++i) {
+            std::string expression;
+            int length = 1 + generator() % 12;
+            for (int j = 0; j < length; ++j) {
+                expression += pieces[generator() % pieces.size()];
+            }
+            corpus.push_back(std::move(expression));
+        }
+
+        for (const auto& expression : corpus) {
+            ASSERT_EQUAL(DescribeParse(expression, FormulaParserBackend::Native),
+                DescribeParse(expression, FormulaParserBackend::Antlr));
+        }
+    }
+
+    void TestSharedRelativeFormulas() {
+        auto sheet = CreateSheet();
+        for (int row = 0; row < 100; ++row) {
+            sheet->SetCell(Position{ row, 0 }, std::to_string(row));
+            sheet->SetCell(Position{ row, 1 }, "2");
+            std::string index = std::to_string(row + 1);
+            sheet->SetCell(Position{ row, 2 }, "=A" + index + "*B" + index + "+1");
+        }
+        for (int row = 0; row < 100; ++row) {
+            const CellInterface* cell = sheet->GetCell(Position{ row, 2 });
+            std::string index = std::to_string(row + 1);
+            ASSERT_EQUAL(cell->GetText(), "=A" + index + "*B" + index + "+1");
+            ASSERT_EQUAL(cell->GetValue(), CellInterface::Value(row * 2.0 + 1));
+            ASSERT_EQUAL(cell->GetReferencedCells(),
+                (std::vector<Position>{ Position{ row, 0 }, Position{ row, 1 } }));
+        }
+
+        //      .
+        auto left = ParseFormula("A1+A1", "B1"_pos);
+        auto right = ParseFormula("Y3+Y3", "Z3"_pos);
+        ASSERT_EQUAL(left->GetExpression(), "A1+A1");
+        ASSERT_EQUAL(right->GetExpression(), "Y3+Y3");
+        ASSERT_EQUAL(right->GetReferencedCells(), std::vector<Position>{ "Y3"_pos });
+        ASSERT(GetFormulaAST(*left) == GetFormulaAST(*right));
+        ASSERT(GetFormulaAST(*ParseFormula("A1+1", "B1"_pos)) == GetFormulaAST(*ParseFormula("A2+1", "B2"_pos)));
+        //          -  .
+        ASSERT(GetFormulaAST(*ParseFormula("A1+1", "B2"_pos)) != GetFormulaAST(*ParseFormula("A1+1", "B1"_pos)));
+        ASSERT(GetFormulaAST(*ParseFormula("A1-1", "B1"_pos)) != GetFormulaAST(*ParseFormula("A1+1", "B1"_pos)));
+
+        sheet->SetCell("Y3"_pos, "4");
+        ASSERT_EQUAL(std::get<double>(right->Evaluate(*sheet)), 8.0);
+
+        //   -   .
+        ASSERT_EQUAL(ParseFormula("Y3*2")->GetExpression(), "Y3*2");
+        ASSERT_EQUAL(std::get<double>(ParseFormula("Y3*2")->Evaluate(*sheet)), 8.0);
+    }
+
+    void TestRecalculate() {
+        auto sheet = CreateSheet();
+        //  A1 -> B1, C1 -> D1     D1.
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("B1"_pos, "=A1+1");
+        sheet->SetCell("C1"_pos, "=A1*2");
+        sheet->SetCell("D1"_pos, "=B1+C1");
+        const int chain = 5000;
+        sheet->SetCell(Position{ 1, 3 }, "=D1+1");
+        for (int row = 2; row < chain; ++row) {
+            sheet->SetCell(Position{ row, 3 }, "=D" + std::to_string(row) + "+1");
+        }
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell("D1"_pos)->GetValue(), CellInterface::Value(4.0));
+        ASSERT_EQUAL(sheet->GetCell(Position{ chain - 1, 3 })->GetValue(),
+            CellInterface::Value(4.0 + chain - 1));
+
+        sheet->SetCell("A1"_pos, "10");
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell("D1"_pos)->GetValue(), CellInterface::Value(31.0));
+        ASSERT_EQUAL(sheet->GetCell(Position{ chain - 1, 3 })->GetValue(),
+            CellInterface::Value(31.0 + chain - 1));
+
+        // ,   ,   .
+        sheet->SetCell("A1"_pos, "=1/0");
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(),
+            CellInterface::Value(FormulaError(FormulaError::Category::Div0)));
+        sheet->ClearCell("C1"_pos);
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell("D1"_pos)->GetValue(),
+            CellInterface::Value(FormulaError(FormulaError::Category::Div0)));
+
+        sheet->ClearCell("A1"_pos);
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell("D1"_pos)->GetValue(), CellInterface::Value(1.0));
+        sheet->Recalculate();
+    }
+
+    void TestParallelRecalculate() {
+        //   :      .
+        auto fill = [](SheetInterface& sheet, std::mt19937& gen) {
+            for (int row = 0; row < 8; ++row) {
+                for (int col = 0; col < 64; ++col) {
+                    Position pos{ row, col };
+                    if (row == 0) {
+                        sheet.SetCell(pos, std::to_string(gen() % 100));
+                        continue;
+                    }
+                    std::string formula = "=1";
+                    for (int i = 0; i < 3; ++i) {
+                        Position input{ static_cast<int>(gen() % row), static_cast<int>(gen() % 64) };
+                        formula += (i == 1 ? "/" : "+") + input.ToString() + "*0.5";
+                    }
+                    sheet.SetCell(pos, formula);
+                }
+            }
+        };
+        auto values = [](const SheetInterface& sheet) {
+            std::ostringstream out;
+            out << std::setprecision(17);
+            sheet.PrintValues(out);
+            return out.str();
+        };
+
+        for (size_t threads : { 2, 4, 7 }) {
+            auto single = CreateSheet();
+            auto parallel = CreateSheet();
+            parallel->SetRecalculationThreads(threads);
+            std::mt19937 single_gen(static_cast<unsigned>(threads));
+            std::mt19937 parallel_gen(static_cast<unsigned>(threads));
+            fill(*single, single_gen);
+            fill(*parallel, parallel_gen);
+
+            single->Recalculate();
+            parallel->Recalculate();
+            ASSERT_EQUAL(values(*single), values(*parallel));
+
+            for (int col = 0; col < 64; ++col) {
+                single->SetCell(Position{ 0, col }, std::to_string(col * 3));
+                parallel->SetCell(Position{ 0, col }, std::to_string(col * 3));
+            }
+            single->Recalculate();
+            parallel->Recalculate();
+            ASSERT_EQUAL(values(*single), values(*parallel));
+        }
+    }
+
+    void TestCyclicCheckOnLargeGraphs() {
+        auto sheet = CreateSheet();
+        //  :      .
+        const int rows = Position::MAX_ROWS;
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("B1"_pos, "=A1");
+        for (int row = 1; row < rows; ++row) {
+            std::string above = std::to_string(row);
+            std::string current = std::to_string(row + 1);
+            sheet->SetCell(Position{ row, 0 }, "1");
+            sheet->SetCell(Position{ row, 1 }, "=B" + above + "+A" + current);
+        }
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell(Position{ rows - 1, 1 })->GetValue(), CellInterface::Value(double(rows)));
+
+        try {
+            sheet->SetCell("A1"_pos, "=B" + std::to_string(rows));
+            ASSERT(false);
+        }
+        catch (const CircularDependencyException&) {
+        }
+
+        //  :        .
+        for (int row = 0; row < 60; ++row) {
+            for (int col = 0; col < 4; ++col) {
+                Position pos{ row, 3 + col };
+                if (row == 0) {
+                    sheet->SetCell(pos, "1");
+                }
+                else {
+                    Position left{ row - 1, 3 + col };
+                    Position right{ row - 1, 3 + (col + 1) % 4 };
+                    sheet->SetCell(pos, "=(" + left.ToString() + "+" + right.ToString() + ")/2");
+                }
+            }
+        }
+        try {
+            sheet->SetCell("D1"_pos, "=G60");
+            ASSERT(false);
+        }
+        catch (const CircularDependencyException&) {
+        }
+        sheet->SetCell("H1"_pos, "=G60+1");
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell("H1"_pos)->GetValue(), CellInterface::Value(2.0));
+    }
+
+    void TestRejectedFormulaKeepsDependencies() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("B1"_pos, "=C1");
+        sheet->SetCell("A1"_pos, "=B1");
+        ASSERT_EQUAL(sheet->GetCell("A1"_pos)->GetValue(), CellInterface::Value(0.0));
+
+        try {
+            sheet->SetCell("B1"_pos, "=A1");
+            ASSERT(false);
+        }
+        catch (const CircularDependencyException&) {
+        }
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetText(), "=C1");
+
+        sheet->SetCell("C1"_pos, "5");
+        ASSERT_EQUAL(sheet->GetCell("A1"_pos)->GetValue(), CellInterface::Value(5.0));
+    }
+
+    void TestInvalidationOfLargeCones() {
+        auto sheet = CreateSheet();
+        //  :        2^rows.
+        const int rows = 200;
+        for (int row = 0; row < rows; ++row) {
+            for (int col = 0; col < 4; ++col) {
+                Position pos{ row, col };
+                if (row == 0) {
+                    sheet->SetCell(pos, "1");
+                }
+                else {
+                    Position left{ row - 1, col };
+                    Position right{ row - 1, (col + 1) % 4 };
+                    sheet->SetCell(pos, "=(" + left.ToString() + "+" + right.ToString() + ")/2");
+                }
+            }
+        }
+        const Position bottom{ rows - 1, 0 };
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell(bottom)->GetValue(), CellInterface::Value(1.0));
+
+        for (int col = 0; col < 4; ++col) {
+            sheet->SetCell(Position{ 0, col }, "3");
+        }
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell(bottom)->GetValue(), CellInterface::Value(3.0));
+
+        //      .
+        sheet->SetCell("A1"_pos, "7");
+        sheet->SetCell("B1"_pos, "7");
+        sheet->SetCell("C1"_pos, "7");
+        sheet->SetCell("D1"_pos, "7");
+        ASSERT_EQUAL(sheet->GetCell(Position{ 1, 0 })->GetValue(), CellInterface::Value(7.0));
+        ASSERT_EQUAL(sheet->GetCell(Position{ 2, 0 })->GetValue(), CellInterface::Value(7.0));
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell(bottom)->GetValue(), CellInterface::Value(7.0));
+
+        //  .
+        sheet->SetCell("F1"_pos, "1");
+        for (int row = 1; row < Position::MAX_ROWS; ++row) {
+            sheet->SetCell(Position{ row, 5 }, "=F" + std::to_string(row) + "+1");
+        }
+        sheet->Recalculate();
+        sheet->SetCell("F1"_pos, "2");
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell(Position{ Position::MAX_ROWS - 1, 5 })->GetValue(),
+            CellInterface::Value(double(Position::MAX_ROWS + 1)));
+    }
+
+    void TestSmallPtrSet() {
+        std::vector<int> items(2000);
+        std::mt19937 gen(13);
+        SmallPtrSet<int> set;
+        std::set<int*> expected;
+        for (int step = 0; step < 20000; ++step) {
+            int* item = &items[gen() % (step < 10000 ? items.size() : 40)];
+            if (gen() % 3 == 0) {
+                ASSERT_EQUAL(set.Erase(item), expected.erase(item) == 1);
+            }
+            else {
+                ASSERT_EQUAL(set.Insert(item), expected.insert(item).second);
+            }
+            ASSERT_EQUAL(set.Size(), expected.size());
+
+            if (step % 1000 == 0 || set.Size() < 40) {
+                std::set<int*> actual;
+                for (int* element : set) {
+                    actual.insert(element);
+                }
+                ASSERT(actual == expected);
+            }
+        }
+        for (int& item : items) {
+            ASSERT_EQUAL(set.Contains(&item), expected.count(&item) == 1);
+        }
+
+        set.Clear();
+        ASSERT(set.Empty());
+        ASSERT(!(set.begin() != set.end()));
+    }
+
+    void TestRangeReferences() {
+        auto formula = ParseFormula("C3:A1+B1*A2:B7");
+        ASSERT_EQUAL(formula->GetExpression(), "A1:C3+B1*A2:B7");
+        ASSERT_EQUAL(formula->GetReferencedCells(), std::vector<Position>{ "B1"_pos });
+        ASSERT((formula->GetReferencedRanges()
+            == std::vector<Range>{ { "A1"_pos, "C3"_pos }, { "A2"_pos, "B7"_pos } }));
+
+        auto sheet = CreateSheet();
+        sheet->SetCell("B2"_pos, "4");
+        sheet->SetCell("A1"_pos, "=B2:B2*3");
+        sheet->SetCell("A2"_pos, "=B1:B3");
+        ASSERT_EQUAL(sheet->GetCell("A1"_pos)->GetValue(), CellInterface::Value(12.0));
+        ASSERT_EQUAL(sheet->GetCell("A2"_pos)->GetValue(), CellInterface::Value(FormulaError::Category::Value));
+        //         
+        ASSERT(sheet->GetCell("B3"_pos) == nullptr);
+
+        //        
+        sheet->SetCell("B2"_pos, "5");
+        ASSERT_EQUAL(sheet->GetCell("A1"_pos)->GetValue(), CellInterface::Value(15.0));
+        sheet->SetCell("C1"_pos, "=A1+1");
+        sheet->Recalculate();
+        sheet->SetCell("B2"_pos, "=D1:D1");
+        sheet->SetCell("D1"_pos, "2");
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell("C1"_pos)->GetValue(), CellInterface::Value(7.0));
+
+        //      
+        for (int row = 10; row < 20; ++row) {
+            std::string index = std::to_string(row + 1);
+            sheet->SetCell(Position{ row, 0 }, index);
+            sheet->SetCell(Position{ row, 1 }, "=A" + index + ":A" + index + "*2");
+        }
+        for (int row = 10; row < 20; ++row) {
+            std::string index = std::to_string(row + 1);
+            ASSERT_EQUAL(sheet->GetCell(Position{ row, 1 })->GetText(), "=A" + index + ":A" + index + "*2");
+            ASSERT_EQUAL(sheet->GetCell(Position{ row, 1 })->GetValue(), CellInterface::Value(2.0 * (row + 1)));
+        }
+
+        bool caught = false;
+        try {
+            sheet->SetCell("A1"_pos, "=A1:XFE1");
+        }
+        catch (const FormulaException&) {
+            caught = true;
+        }
+        ASSERT(caught);
+    }
+
+    void TestRangeCircularReferences() {
+        auto expect_cycle = [](SheetInterface& sheet, Position pos, const std::string& text) {
+            auto before = sheet.GetCell(pos) ? sheet.GetCell(pos)->GetText() : std::string();
+            bool caught = false;
+            try {
+                sheet.SetCell(pos, text);
+            }
+            catch (const CircularDependencyException&) {
+                caught = true;
+            }
+            ASSERT(caught);
+            ASSERT_EQUAL(sheet.GetCell(pos) ? sheet.GetCell(pos)->GetText() : std::string(), before);
+        };
+
+        auto sheet = CreateSheet();
+        expect_cycle(*sheet, "B2"_pos, "=A1:C3");
+
+        sheet->SetCell("A1"_pos, "=B1:B100");
+        expect_cycle(*sheet, "B50"_pos, "=A1");
+        sheet->SetCell("C1"_pos, "=A1");
+        expect_cycle(*sheet, "B7"_pos, "=C1+1");
+        sheet->SetCell("E5"_pos, "=C1:C1");
+        expect_cycle(*sheet, "B100"_pos, "=D1:F9");
+        sheet->SetCell("B101"_pos, "=C1");
+
+        //         
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("B50"_pos, "=A1");
+        sheet->SetCell("A1"_pos, "=B60:B70");
+        sheet->ClearCell("A1"_pos);
+        sheet->SetCell("B65"_pos, "=A1");
+        ASSERT_EQUAL(sheet->GetCell("B65"_pos)->GetValue(), CellInterface::Value(0.0));
+    }
+
+    void TestRangeIndex() {
+        std::mt19937 gen(17);
+        auto random_range = [&gen] {
+            Position first{ static_cast<int>(gen() % 200), static_cast<int>(gen() % 50) };
+            Position last{ first.row + static_cast<int>(gen() % 40), first.col + static_cast<int>(gen() % 5) };
+            return Range{ first, last };
+        };
+
+        RangeIndex<int> index;
+        std::multiset<std::pair<Range, int>> expected;
+        for (int step = 0; step < 5000; ++step) {
+            if (!expected.empty() && gen() % 3 == 0) {
+                auto it = std::next(expected.begin(), gen() % expected.size());
+                ASSERT(index.Erase(it->first, it->second));
+                ASSERT(!index.Erase(Range{ { 300, 0 }, { 300, 0 } }, it->second));
+                expected.erase(it);
+            }
+            else {
+                Range range = random_range();
+                int value = static_cast<int>(gen() % 100);
+                index.Insert(range, value);
+                expected.insert({ range, value });
+            }
+            ASSERT_EQUAL(index.Size(), expected.size());
+
+            if (step % 100 == 0) {
+                for (int probe = 0; probe < 20; ++probe) {
+                    Position pos{ static_cast<int>(gen() % 240), static_cast<int>(gen() % 55) };
+                    std::multiset<int> actual_values;
+                    index.ForEachContaining(pos, [&actual_values](int value) {
+                        actual_values.insert(value);
+                    });
+                    std::multiset<int> expected_values;
+                    for (const auto& [range, value] : expected) {
+                        if (range.Contains(pos)) {
+                            expected_values.insert(value);
+                        }
+                    }
+                    ASSERT(actual_values == expected_values);
+                }
+            }
+        }
+
+        index.Clear();
+        ASSERT(index.Empty());
+    }
+
+    void TestFunctions() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("A2"_pos, "2");
+        sheet->SetCell("A4"_pos, "=A1*10");
+        auto value_of = [&](const std::string& formula) {
+            sheet->SetCell("D1"_pos, formula);
+            return sheet->GetCell("D1"_pos)->GetValue();
+        };
+        using Value = CellInterface::Value;
+
+        //    , -  
+        ASSERT_EQUAL(value_of("=SUM(A1:A4)"), Value(13.0));
+        ASSERT_EQUAL(value_of("=SUM(A1:A4,5,B1:B2)"), Value(18.0));
+        ASSERT_EQUAL(value_of("=MIN(A1:A4)"), Value(1.0));
+        ASSERT_EQUAL(value_of("=MAX(A1:A4,100)"), Value(100.0));
+        ASSERT_EQUAL(value_of("=MIN(B1:B5)"), Value(0.0));
+        ASSERT_EQUAL(value_of("=AVERAGE(A1:A4)"), Value(13.0 / 3));
+        ASSERT_EQUAL(value_of("=AVERAGE(B1:B3)"), Value(FormulaError::Category::Div0));
+        ASSERT_EQUAL(value_of("=AND(1,A1:A2)"), Value(1.0));
+        ASSERT_EQUAL(value_of("=OR(0,B1:B2)"), Value(0.0));
+        ASSERT_EQUAL(value_of("=AND(B1:B2)"), Value(FormulaError::Category::Value));
+
+        ASSERT_EQUAL(value_of("=1<2"), Value(1.0));
+        ASSERT_EQUAL(value_of("=A1=1"), Value(1.0));
+        ASSERT_EQUAL(value_of("=2<=1"), Value(0.0));
+        ASSERT_EQUAL(value_of("=1<>1"), Value(0.0));
+        ASSERT_EQUAL(value_of("=1+1>=2"), Value(1.0));
+        ASSERT_EQUAL(value_of("=IF(A1>0,SUM(A1:A4),1/0)"), Value(13.0));
+        ASSERT_EQUAL(value_of("=IF(A1<0,1)"), Value(0.0));
+
+        sheet->SetCell("A5"_pos, "text");
+        sheet->SetCell("A6"_pos, "=1/0");
+        ASSERT_EQUAL(value_of("=SUM(A1:A5)"), Value(FormulaError::Category::Value));
+        ASSERT_EQUAL(value_of("=MAX(A6,A1)"), Value(FormulaError::Category::Div0));
+        ASSERT_EQUAL(value_of("=A5<1"), Value(FormulaError::Category::Value));
+        ASSERT_EQUAL(value_of("=IF(A6,1,2)"), Value(FormulaError::Category::Div0));
+        ASSERT_EQUAL(value_of("=COUNT(A1:A6,1/0,2)"), Value(4.0));
+
+        //      
+        ASSERT_EQUAL(value_of("=SUM(A1:A4)"), Value(13.0));
+        sheet->SetCell("A3"_pos, "7");
+        ASSERT_EQUAL(sheet->GetCell("D1"_pos)->GetValue(), Value(20.0));
+
+        for (const auto& [formula, expression] : std::vector<std::pair<std::string, std::string>>{
+                 { "=IF( A1 > 0 , SUM(A1:A4) , -(1<2) )", "=IF(A1>0,SUM(A1:A4),-(1<2))" },
+                 { "=(1<2)<3", "=1<2<3" },
+                 { "=1<(2<3)", "=1<(2<3)" },
+                 { "=(1<2)+1", "=(1<2)+1" },
+                 { "=1<(2+3)", "=1<2+3" },
+                 { "=MAX((1),(A1:A2))", "=MAX(1,A1:A2)" } }) {
+            sheet->SetCell("D1"_pos, formula);
+            ASSERT_EQUAL(sheet->GetCell("D1"_pos)->GetText(), expression);
+        }
+
+        for (const std::string formula : { "=SUM()", "=FOO(1)", "=IF(1)", "=IF(1,2,3,4)", "=SUM(1,)" }) {
+            bool caught = false;
+            try {
+                sheet->SetCell("D1"_pos, formula);
+            }
+            catch (const FormulaException&) {
+                caught = true;
+            }
+            ASSERT(caught);
+        }
+    }
+
+    // ,     .
+    class CountingSheet : public SheetInterface {
+    public:
+        explicit CountingSheet(SheetInterface& sheet)
+            : sheet_(sheet) {
+        }
+
+        void SetCell(Position pos, std::string text) override {
+            sheet_.SetCell(pos, std::move(text));
+        }
+
+        void SetCells(std::vector<std::pair<Position, std::string>> cells) override {
+            sheet_.SetCells(std::move(cells));
+        }
+
+        const CellInterface* GetCell(Position pos) const override {
+            ++reads;
+            return sheet_.GetCell(pos);
+        }
+
+        CellInterface* GetCell(Position pos) override {
+            ++reads;
+            return sheet_.GetCell(pos);
+        }
+
+        void ClearCell(Position pos) override {
+            sheet_.ClearCell(pos);
+        }
+
+        Size GetPrintableSize() const override {
+            return sheet_.GetPrintableSize();
+        }
+
+        void PrintValues(std::ostream& output) const override {
+            sheet_.PrintValues(output);
+        }
+
+        void PrintTexts(std::ostream& output) const override {
+            sheet_.PrintTexts(output);
+        }
+
+        void ForEachCellInRange(Range range,
+            const std::function<void(Position, const CellInterface&)>& f) const override {
+            sheet_.ForEachCellInRange(range, [this, &f](Position pos, const CellInterface& cell) {
+                ++reads;
+                f(pos, cell);
+            });
+        }
+
+        void Recalculate() override {
+            sheet_.Recalculate();
+        }
+
+        void SetRecalculationThreads(size_t threads) override {
+            sheet_.SetRecalculationThreads(threads);
+        }
+
+        void SaveSnapshot(std::ostream& output) const override {
+            sheet_.SaveSnapshot(output);
+        }
+
+        std::shared_ptr<const SheetViewInterface> Snapshot() override {
+            return sheet_.Snapshot();
+        }
+
+        std::unique_ptr<SheetInterface> Fork() override {
+            return sheet_.Fork();
+        }
+
+        std::unique_ptr<const FrozenSheet> Freeze() override {
+            return sheet_.Freeze();
+        }
+
+        mutable int reads = 0;
+
+    private:
+        SheetInterface& sheet_;
+    };
+
+    void TestIfEvaluatesOneBranch() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("B1"_pos, "2");
+        sheet->SetCell("C1"_pos, "3");
+        CountingSheet counting(*sheet);
+
+        for (auto backend : { false, true }) {
+            auto reads_of = [&](const std::string& expression, double expected) {
+                FormulaAST ast = ParseFormulaAST(expression);
+                counting.reads = 0;
+                auto value = backend ? ast.ExecuteTree(counting) : ast.Execute(counting);
+                ASSERT_EQUAL(std::get<double>(value), expected);
+                return counting.reads;
+            };
+
+            ASSERT_EQUAL(reads_of("IF(A1,B1,C1)", 2), 2);
+            ASSERT_EQUAL(reads_of("IF(A1-1,B1,SUM(B1:C1000))", 5), 3);
+            ASSERT_EQUAL(reads_of("IF(A1>0,IF(A1>1,C1,B1),SUM(A1:C1))", 2), 3);
+
+            FormulaAST ast = ParseFormulaAST("IF(1/0,B1,C1)+A1");
+            counting.reads = 0;
+            auto value = backend ? ast.ExecuteTree(counting) : ast.Execute(counting);
+            ASSERT_EQUAL(std::get<FormulaError>(value), FormulaError(FormulaError::Category::Div0));
+            ASSERT_EQUAL(counting.reads, 1);
+        }
+    }
+
+    void TestAggregateKernels() {
+        using kernels::SimdLevel;
+        std::vector<SimdLevel> levels{ SimdLevel::Scalar };
+        if (kernels::GetSimdLevel() >= SimdLevel::Sse2) {
+            levels.push_back(SimdLevel::Sse2);
+        }
+        if (kernels::GetSimdLevel() >= SimdLevel::Avx2) {
+            levels.push_back(SimdLevel::Avx2);
+        }
+
+        std::vector<double> values;
+        for (int i = 0; i < 1000; ++i) {
+            values.push_back(i * 37 % 101 - 50.25);
+        }
+
+        //           
+        for (size_t count : { 0, 1, 7, 8, 9, 63, 997 }) {
+            for (size_t offset : { 0, 1, 3 }) {
+                const double* data = values.data() + offset;
+                const auto expected = kernels::Reduce(SimdLevel::Scalar, data, count);
+                ASSERT_EQUAL(expected.numbers, count);
+                ASSERT_EQUAL(expected.first_error, kernels::Reduction::NPOS);
+                ASSERT(std::abs(expected.sum - std::accumulate(data, data + count, 0.0)) < 1e-6);
+                if (count > 0) {
+                    ASSERT_EQUAL(expected.min, *std::min_element(data, data + count));
+                    ASSERT_EQUAL(expected.max, *std::max_element(data, data + count));
+                }
+                for (SimdLevel level : levels) {
+                    const auto reduction = kernels::Reduce(level, data, count);
+                    ASSERT_EQUAL(reduction.sum, expected.sum);
+                    ASSERT_EQUAL(reduction.min, expected.min);
+                    ASSERT_EQUAL(reduction.max, expected.max);
+                    ASSERT_EQUAL(reduction.numbers, expected.numbers);
+                }
+            }
+        }
+
+        //      ,   
+        values[500] = values[900] = std::numeric_limits<double>::quiet_NaN();
+        for (SimdLevel level : levels) {
+            auto reduction = kernels::Reduce(level, values.data(), values.size());
+            ASSERT_EQUAL(reduction.numbers, 998u);
+            ASSERT_EQUAL(reduction.first_error, 500u);
+            reduction = kernels::Reduce(level, values.data() + 501, 499);
+            ASSERT_EQUAL(reduction.first_error, 399u);
+            reduction = kernels::Reduce(level, values.data() + 895, 7);
+            ASSERT_EQUAL(reduction.numbers, 6u);
+            ASSERT_EQUAL(reduction.first_error, 5u);
+        }
+
+        //     
+        auto sheet = CreateSheet();
+        for (int row = 0; row < 1000; ++row) {
+            sheet->SetCell({ row, 0 }, std::to_string(row % 10));
+        }
+        auto value_of = [&](const std::string& formula) {
+            sheet->SetCell("C1"_pos, formula);
+            return sheet->GetCell("C1"_pos)->GetValue();
+        };
+        using Value = CellInterface::Value;
+        ASSERT_EQUAL(value_of("=SUM(A1:A1000)"), Value(4500.0));
+        ASSERT_EQUAL(value_of("=MAX(A1:A1000)"), Value(9.0));
+        ASSERT_EQUAL(value_of("=AVERAGE(A1:A1000)"), Value(4.5));
+        sheet->SetCell("A700"_pos, "text");
+        sheet->SetCell("A900"_pos, "=1/0");
+        ASSERT_EQUAL(value_of("=MIN(A1:A1000)"), Value(FormulaError::Category::Value));
+        ASSERT_EQUAL(value_of("=SUM(A800:A1000)"), Value(FormulaError::Category::Div0));
+        ASSERT_EQUAL(value_of("=COUNT(A1:A1000)"), Value(998.0));
+    }
+
+    void TestColumnCache() {
+        ColumnCache column;
+        for (int row : { 0, 1, 2, 63, 64, 65, 200, Position::MAX_ROWS - 1 }) {
+            column.Insert(row);
+            column.Store(row, static_cast<double>(row));
+        }
+        column.Erase(1);
+        column.Invalidate(64);
+        std::vector<std::pair<int, size_t>> runs;
+        column.ForEachRun(0, Position::MAX_ROWS - 1, [&](int row, const double* values, size_t count) {
+            ASSERT_EQUAL(values[0], static_cast<double>(row));
+            runs.push_back({ row, count });
+        });
+        ASSERT((runs == std::vector<std::pair<int, size_t>>{ { 0, 1 }, { 2, 1 }, { 63, 3 }, { 200, 1 }, { Position::MAX_ROWS - 1, 1 } }));
+        runs.clear();
+        column.ForEachRun(64, 199, [&](int row, const double* /* values */, size_t count) {
+            runs.push_back({ row, count });
+        });
+        ASSERT((runs == std::vector<std::pair<int, size_t>>{ { 64, 2 } }));
+        std::vector<int> stale;
+        column.ForEachStale(0, 100, [&](int row) {
+            stale.push_back(row);
+        });
+        ASSERT_EQUAL(stale, std::vector<int>{ 64 });
+
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("A2"_pos, "=A1*2");
+        sheet->SetCell("A4"_pos, "=A2+1");
+        //     ,     
+        ASSERT_EQUAL(sheet->GetCell("A4"_pos)->GetValue(), CellInterface::Value(3.0));
+        sheet->SetCell("B1"_pos, "=SUM(A1:A4)");
+        sheet->SetCell("B2"_pos, "=COUNT(A1:A5)");
+        auto value_of = [&](Position pos) {
+            return sheet->GetCell(pos)->GetValue();
+        };
+        using Value = CellInterface::Value;
+        ASSERT_EQUAL(value_of("B1"_pos), Value(6.0));
+
+        //        
+        sheet->SetCell("A1"_pos, "5");
+        ASSERT_EQUAL(value_of("B1"_pos), Value(26.0));
+        sheet->SetCell("A3"_pos, "=A4*0");
+        ASSERT_EQUAL(value_of("B1"_pos), Value(26.0));
+        ASSERT_EQUAL(value_of("B2"_pos), Value(4.0));
+        sheet->ClearCell("A2"_pos);
+        ASSERT_EQUAL(value_of("B1"_pos), Value(6.0));
+        ASSERT_EQUAL(value_of("B2"_pos), Value(3.0));
+        sheet->SetCell("A2"_pos, "text");
+        ASSERT_EQUAL(value_of("B1"_pos), Value(FormulaError::Category::Value));
+        // A3  A4   A2    
+        ASSERT_EQUAL(value_of("B2"_pos), Value(1.0));
+        sheet->SetCell("A2"_pos, "=1/0");
+        ASSERT_EQUAL(value_of("B1"_pos), Value(FormulaError::Category::Div0));
+        sheet->SetCell("A2"_pos, "2");
+        ASSERT_EQUAL(value_of("B1"_pos), Value(10.0));
+
+        //          
+        sheet->ClearCell("B1"_pos);
+        sheet->ClearCell("B2"_pos);
+        sheet->SetCell("A5"_pos, "10");
+        sheet->SetCell("B1"_pos, "=MAX(A1:A5)");
+        ASSERT_EQUAL(value_of("B1"_pos), Value(10.0));
+
+        //    ,   
+        auto serial = CreateSheet();
+        auto parallel = CreateSheet();
+        parallel->SetRecalculationThreads(4);
+        for (auto* s : { serial.get(), parallel.get() }) {
+            for (int row = 0; row < 2000; ++row) {
+                s->SetCell({ row, 0 }, row == 0 ? "1" : "=" + Position{ row - 1, 0 }.ToString() + "+1");
+                s->SetCell({ row, 1 }, "=SUM(" + Range{ { 0, 0 }, { row, 0 } }.ToString() + ")");
+            }
+            s->Recalculate();
+            s->SetCell("A1"_pos, "2");
+            s->Recalculate();
+        }
+        for (int row = 0; row < 2000; ++row) {
+            ASSERT_EQUAL(parallel->GetCell({ row, 1 })->GetValue(), serial->GetCell({ row, 1 })->GetValue());
+        }
+        ASSERT_EQUAL(serial->GetCell("B2000"_pos)->GetValue(), Value(2000.0 * 2001 / 2 + 2000));
+
+        //    -   ,     
+        // :    Fork()  
+        auto cached = CreateSheet();
+        auto uncached = cached->Fork();
+        for (auto* s : { cached.get(), uncached.get() }) {
+            s->SetCell("B1"_pos, "=1/0");
+            s->SetCell("A2"_pos, "text");
+            s->SetCell("A3"_pos, "=A2");
+            s->SetCell("C2"_pos, "=1/0");
+            s->SetCell("D1"_pos, "=SUM(A1:B2)");
+            s->SetCell("D2"_pos, "=MAX(A2:C3)");
+            s->SetCell("D3"_pos, "=AND(A1:B3)");
+            s->SetCell("D4"_pos, "=AVERAGE(A3:C3)");
+        }
+        ASSERT_EQUAL(cached->GetCell("D1"_pos)->GetValue(), Value(FormulaError::Category::Div0));
+        ASSERT_EQUAL(cached->GetCell("D2"_pos)->GetValue(), Value(FormulaError::Category::Value));
+        for (Position pos : { "D1"_pos, "D2"_pos, "D3"_pos, "D4"_pos }) {
+            ASSERT_EQUAL(cached->GetCell(pos)->GetValue(), uncached->GetCell(pos)->GetValue());
+        }
+    }
+
+    void TestSetCells() {
+        using Value = CellInterface::Value;
+        auto sheet = CreateSheet();
+        //        
+        sheet->SetCells({ { "B1"_pos, "=A1+A2" }, { "A2"_pos, "=A1*3" }, { "A1"_pos, "5" }, { "A1"_pos, "1" },
+            { "C3"_pos, "=SUM(A1:A2)" } });
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(), Value(4.0));
+        ASSERT_EQUAL(sheet->GetCell("A1"_pos)->GetText(), "1");
+        ASSERT_EQUAL(sheet->GetCell("C3"_pos)->GetValue(), Value(4.0));
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 3, 3 }));
+
+        //      
+        sheet->SetCells({ { "A1"_pos, "2" }, { "C3"_pos, "" } });
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(), Value(8.0));
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 2, 2 }));
+        sheet->Recalculate();
+
+        auto expect_unchanged = [&] {
+            ASSERT_EQUAL(sheet->GetCell("A1"_pos)->GetText(), "2");
+            ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(), Value(8.0));
+            ASSERT(sheet->GetCell("D1"_pos) == nullptr);
+            ASSERT(sheet->GetCell("D2"_pos) == nullptr);
+            ASSERT(sheet->GetCell("E9"_pos) == nullptr);
+            ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 2, 2 }));
+        };
+        auto expect_throws = [&](std::vector<std::pair<Position, std::string>> cells, auto exception) {
+            bool caught = false;
+            try {
+                sheet->SetCells(std::move(cells));
+            }
+            catch (const decltype(exception)&) {
+                caught = true;
+            }
+            ASSERT(caught);
+            expect_unchanged();
+        };
+        //   ,      
+        expect_throws({ { "D1"_pos, "=D2+E9" }, { "D2"_pos, "=D1" } }, CircularDependencyException(""));
+        expect_throws({ { "D1"_pos, "1" }, { "A1"_pos, "=B1" } }, CircularDependencyException(""));
+        expect_throws({ { "A1"_pos, "=SUM(D1:D2)" }, { "D2"_pos, "=B1" } }, CircularDependencyException(""));
+        expect_throws({ { "D1"_pos, "=D1" } }, CircularDependencyException(""));
+        expect_throws({ { "D1"_pos, "1" }, { "D2"_pos, "=1+" } }, FormulaException(""));
+        expect_throws({ { "D1"_pos, "1" }, { Position{ -1, 0 }, "1" } }, InvalidPositionException(""));
+
+        //    
+        sheet->SetCell("A1"_pos, "3");
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(), Value(12.0));
+        sheet->Recalculate();
+        ASSERT_EQUAL(sheet->GetCell("B1"_pos)->GetValue(), Value(12.0));
+
+        //     
+        auto batch = CreateSheet();
+        auto single = CreateSheet();
+        std::vector<std::pair<Position, std::string>> cells;
+        for (int row = 0; row < 300; ++row) {
+            const std::string prev = Position{ std::max(row - 1, 0), 0 }.ToString();
+            cells.push_back({ { row, 0 }, row == 0 ? "1" : "=" + prev + "+1" });
+            cells.push_back({ { row, 1 }, "=SUM(A1:" + Position{ row, 0 }.ToString() + ")" });
+            cells.push_back({ { row, 2 }, row % 7 == 0 ? "text" : std::to_string(row) });
+        }
+        for (int round = 0; round < 2; ++round) {
+            for (const auto& [pos, text] : cells) {
+                single->SetCell(pos, text);
+            }
+            batch->SetCells(cells);
+            std::ostringstream expected;
+            std::ostringstream actual;
+            single->PrintValues(expected);
+            batch->PrintValues(actual);
+            ASSERT_EQUAL(actual.str(), expected.str());
+            cells[0].second = "10";
+        }
+    }
+
+    void TestImportTexts() {
+        using Cells = std::vector<std::pair<Position, std::string>>;
+        auto format = [](const Cells& cells) {
+            std::ostringstream output;
+            for (const auto& [pos, text] : cells) {
+                output << pos << '=' << text << ';';
+            }
+            return output.str();
+        };
+
+        //  CSV: ,       
+        ASSERT_EQUAL(format(ParseTexts("a,\"b,\"\"c\"\"\",\r\n\n,\"x\ny\",=1+2\n'5", TextFormat::Csv)),
+            format({ { "A1"_pos, "a" }, { "B1"_pos, "b,\"c\"" }, { "B3"_pos, "x\ny" }, { "C3"_pos, "=1+2" },
+                { "A4"_pos, "'5" } }));
+        //  TSV  -  
+        ASSERT_EQUAL(format(ParseTexts("\"a\"\t\tb\r\n\tc", TextFormat::Tsv)),
+            format({ { "A1"_pos, "\"a\"" }, { "C1"_pos, "b" }, { "B2"_pos, "c" } }));
+        ASSERT(ParseTexts("", TextFormat::Csv).empty());
+
+        bool caught = false;
+        try {
+            ParseTexts(std::string(Position::MAX_COLS, '\t') + "1", TextFormat::Tsv);
+        }
+        catch (const InvalidPositionException&) {
+            caught = true;
+        }
+        ASSERT(caught);
+
+        //        ,    
+        //        
+        std::string tsv;
+        std::string csv;
+        for (int row = 0; row < 16000; ++row) {
+            const std::string number = std::to_string(row);
+            tsv += number + "\t=A" + std::to_string(row + 1) + "*2\t\ttext " + number + "\n";
+            csv += number + ",\"multi\nline " + number + "\",,\"q\"\"" + number + "\"\r\n";
+        }
+        ASSERT_EQUAL(format(ParseTexts(tsv, TextFormat::Tsv, 4)), format(ParseTexts(tsv, TextFormat::Tsv, 1)));
+        ASSERT_EQUAL(format(ParseTexts(csv, TextFormat::Csv, 4)), format(ParseTexts(csv, TextFormat::Csv, 1)));
+        ASSERT_EQUAL(ParseTexts(csv, TextFormat::Csv, 4).size(), 48000u);
+        ASSERT_EQUAL(ParseTexts(csv, TextFormat::Csv, 4).back().first, (Position{ 15999, 3 }));
+
+        //   PrintTexts()     ,  
+        //   
+        auto source = CreateSheet();
+        source->SetCells(ParseTexts(tsv, TextFormat::Tsv));
+        source->SetCell("E1"_pos, "=SUM(A1:A16000)");
+        source->SetCell("F3"_pos, "'=escaped");
+        std::ostringstream texts;
+        source->PrintTexts(texts);
+
+        const std::string path = (std::filesystem::temp_directory_path() / "spreadsheet_import_test.tsv").string();
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << texts.str();
+        }
+        auto imported = CreateSheet();
+        imported->SetRecalculationThreads(4);
+        ImportTexts(*imported, path, TextFormat::Tsv, 4);
+        std::ostringstream imported_texts;
+        imported->PrintTexts(imported_texts);
+        ASSERT_EQUAL(imported_texts.str(), texts.str());
+        std::ostringstream values;
+        std::ostringstream imported_values;
+        source->PrintValues(values);
+        imported->PrintValues(imported_values);
+        ASSERT_EQUAL(imported_values.str(), values.str());
+
+        //       
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << "1\t2\n=A1+\t3\n";
+        }
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "old");
+        caught = false;
+        try {
+            ImportTexts(*sheet, path, TextFormat::Tsv);
+        }
+        catch (const FormulaException&) {
+            caught = true;
+        }
+        ASSERT(caught);
+        ASSERT_EQUAL(sheet->GetCell("A1"_pos)->GetText(), "old");
+        ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{ 1, 1 }));
+
+        std::filesystem::remove(path);
+        caught = false;
+        try {
+            ImportTexts(*sheet, path, TextFormat::Tsv);
+        }
+        catch (const std::runtime_error&) {
+            caught = true;
+        }
+        ASSERT(caught);
+    }
+
+    void TestSnapshot() {
+        const std::string path = (std::filesystem::temp_directory_path() / "spreadsheet_snapshot_test.bin").string();
+        auto save = [&path](const SheetInterface& sheet) {
+            std::ofstream file(path, std::ios::binary);
+            sheet.SaveSnapshot(file);
+        };
+        auto print = [](const SheetInterface& sheet) {
+            std::ostringstream output;
+            sheet.PrintTexts(output);
+            output << "--\n";
+            sheet.PrintValues(output);
+            return output.str();
+        };
+
+        auto source = CreateSheet();
+        for (int row = 0; row < 100; ++row) {
+            source->SetCell({ row, 0 }, std::to_string(row));
+            source->SetCell({ row, 1 }, "=A" + std::to_string(row + 1) + "*2");
+        }
+        source->SetCell("D1"_pos, "=SUM(A1:B100)");
+        source->SetCell("D2"_pos, "=1/0");
+        source->SetCell("D3"_pos, "=IF(A2>0,D1,Z999)");
+        source->SetCell("E1"_pos, "'=escaped");
+        source->SetCell("E2"_pos, "text");
+        //       
+        source->SetCell("F1"_pos, "=Z999+1");
+        //   ,    
+        source->GetCell("D1"_pos)->GetValue();
+        source->GetCell("D2"_pos)->GetValue();
+        save(*source);
+
+        auto loaded = LoadSnapshot(path);
+        ASSERT(loaded->GetPrintableSize() == source->GetPrintableSize());
+        ASSERT_EQUAL(loaded->GetCell("B50"_pos)->GetText(), "=A50*2");
+        ASSERT_EQUAL(std::get<double>(loaded->GetCell("B50"_pos)->GetValue()), 98.0);
+        ASSERT(loaded->GetCell("C50"_pos) == nullptr);
+        ASSERT_EQUAL(std::get<double>(loaded->GetCell("D3"_pos)->GetValue()), 14850.0);
+        ASSERT(std::get<FormulaError>(loaded->GetCell("D2"_pos)->GetValue()).GetCategory()
+            == FormulaError::Category::Div0);
+        ASSERT_EQUAL(loaded->GetCell("E1"_pos)->GetText(), "'=escaped");
+        ASSERT_EQUAL(loaded->GetCell("B2"_pos)->GetReferencedCells().size(), 1u);
+        ASSERT_EQUAL(print(*loaded), print(*source));
+
+        //        
+        loaded->SetCell("A1"_pos, "1000");
+        source->SetCell("A1"_pos, "1000");
+        ASSERT_EQUAL(std::get<double>(loaded->GetCell("B1"_pos)->GetValue()), 2000.0);
+        ASSERT_EQUAL(std::get<double>(loaded->GetCell("D1"_pos)->GetValue()), 17850.0);
+        loaded->SetCell("Z999"_pos, "5");
+        source->SetCell("Z999"_pos, "5");
+        ASSERT_EQUAL(std::get<double>(loaded->GetCell("F1"_pos)->GetValue()), 6.0);
+        ASSERT_EQUAL(print(*loaded), print(*source));
+
+        //       
+        save(*source);
+        auto reloaded = LoadSnapshot(path);
+        const std::string resaved_path = path + ".2";
+        {
+            std::ofstream file(resaved_path, std::ios::binary);
+            reloaded->SaveSnapshot(file);
+        }
+        auto twice = LoadSnapshot(resaved_path);
+        ASSERT_EQUAL(print(*twice), print(*source));
+        twice->Recalculate();
+        ASSERT_EQUAL(print(*twice), print(*source));
+        std::filesystem::remove(resaved_path);
+
+        save(*CreateSheet());
+        auto empty = LoadSnapshot(path);
+        ASSERT(empty->GetPrintableSize() == (Size{ 0, 0 }));
+        ASSERT(empty->GetCell("A1"_pos) == nullptr);
+        ASSERT_EQUAL(print(*empty), print(*CreateSheet()));
+
+        //  
+        save(*source);
+        std::string bytes;
+        {
+            std::ifstream file(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        auto rejects = [&path](const std::string& data) {
+            {
+                std::ofstream file(path, std::ios::binary);
+                file << data;
+            }
+            try {
+                //    ,    
+                std::ostringstream output;
+                LoadSnapshot(path)->PrintValues(output);
+            }
+            catch (const std::runtime_error&) {
+                return true;
+            }
+            return false;
+        };
+        ASSERT(rejects(bytes.substr(0, bytes.size() / 2)));
+        ASSERT(rejects(""));
+        std::string wrong_version = bytes;
+        wrong_version[8] = static_cast<char>(snapshot::VERSION + 1);
+        ASSERT(rejects(wrong_version));
+        std::string wrong_magic = bytes;
+        wrong_magic[bytes.size() - 1] = '?';
+        ASSERT(rejects(wrong_magic));
+        std::filesystem::remove(path);
+
+        // ,     , 
+        ASTImpl::Program program;
+        program.code.push_back({ ASTImpl::OpCode::Add });
+        bool caught = false;
+        try {
+            FormulaAST(std::move(program), {}, {});
+        }
+        catch (const std::invalid_argument&) {
+            caught = true;
+        }
+        ASSERT(caught);
+    }
+
+    void TestConcurrentReads() {
+        constexpr int CHAIN = 1000;
+        constexpr int READERS = 8;
+        auto sheet = CreateSheet();
+        auto expected = CreateSheet();
+        auto set_both = [&](Position pos, const std::string& text) {
+            sheet->SetCell(pos, text);
+            expected->SetCell(pos, text);
+        };
+        // ,     ,   
+        set_both("A1"_pos, "1");
+        for (int row = 1; row < CHAIN; ++row) {
+            const std::string above = Position{ row - 1, 0 }.ToString();
+            set_both({ row, 0 }, "=" + above + "+1");
+            set_both({ row, 1 }, "=SUM(A1:" + above + ")");
+            set_both({ row, 2 }, "=IF(" + above + ">500," + Position{ row, 1 }.ToString() + ",1/0)");
+        }
+        set_both("D1"_pos, "=SUM(A1:C1000)+MAX(B1:B1000)");
+
+        for (int round = 0; round < 5; ++round) {
+            set_both("A1"_pos, std::to_string(round * 10));
+            std::ostringstream values;
+            expected->PrintValues(values);
+
+            //      ,  
+            //       
+            std::vector<std::string> results(READERS);
+            std::vector<std::thread> readers;
+            for (int reader = 0; reader < READERS; ++reader) {
+                readers.emplace_back([&sheet, &results, reader] {
+                    const SheetInterface& const_sheet = *sheet;
+                    for (int i = 0; i < CHAIN; ++i) {
+                        const int row = reader % 2 == 0 ? CHAIN - 1 - i : (i * 7 + reader) % CHAIN;
+                        for (int col = 0; col < 3; ++col) {
+                            if (const CellInterface* cell = const_sheet.GetCell({ row, col })) {
+                                cell->GetValue();
+                            }
+                        }
+                    }
+                    std::ostringstream output;
+                    const_sheet.PrintValues(output);
+                    results[reader] = output.str();
+                });
+            }
+            for (std::thread& reader : readers) {
+                reader.join();
+            }
+            for (const std::string& result : results) {
+                ASSERT_EQUAL(result, values.str());
+            }
+        }
+    }
+
+    void TestSheetViews() {
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("B1"_pos, "=A1*2");
+        sheet->SetCell("C3"_pos, "'=text");
+
+        auto first = sheet->Snapshot();
+        ASSERT_EQUAL(first->GetVersion(), 1u);
+        ASSERT(sheet->Snapshot() == first);
+        auto print = [](const auto& sheet) {
+            std::ostringstream output;
+            sheet.PrintTexts(output);
+            output << "--\n";
+            sheet.PrintValues(output);
+            return output.str();
+        };
+        ASSERT_EQUAL(print(*first), print(*sheet));
+
+        //       
+        sheet->SetCell("A1"_pos, "5");
+        sheet->SetCell("Z100"_pos, "far");
+        sheet->ClearCell("C3"_pos);
+        auto second = sheet->Snapshot();
+        ASSERT_EQUAL(second->GetVersion(), 4u);
+        ASSERT_EQUAL(std::get<double>(first->GetCell("B1"_pos)->GetValue()), 2.0);
+        ASSERT_EQUAL(first->GetCell("C3"_pos)->GetText(), "'=text");
+        ASSERT(first->GetCell("Z100"_pos) == nullptr);
+        ASSERT(first->GetPrintableSize() == (Size{ 3, 3 }));
+        ASSERT_EQUAL(std::get<double>(second->GetCell("B1"_pos)->GetValue()), 10.0);
+        ASSERT(second->GetCell("C3"_pos) == nullptr);
+        ASSERT_EQUAL(std::get<std::string>(second->GetCell("Z100"_pos)->GetValue()), "far");
+        ASSERT_EQUAL(second->GetCell("B1"_pos)->GetReferencedCells().size(), 1u);
+        ASSERT_EQUAL(print(*second), print(*sheet));
+
+        //     
+        try {
+            sheet->SetCell("A1"_pos, "=B1");
+        }
+        catch (const CircularDependencyException&) {
+        }
+        ASSERT(sheet->Snapshot() == second);
+
+        sheet->SetCells({ { "A1"_pos, "=SUM(A2:A3)" }, { "A2"_pos, "3" }, { "A3"_pos, "4" } });
+        ASSERT_EQUAL(std::get<double>(sheet->Snapshot()->GetCell("B1"_pos)->GetValue()), 14.0);
+        ASSERT_EQUAL(print(*sheet->Snapshot()), print(*sheet));
+
+        //  ,     
+        std::weak_ptr<const SheetViewInterface> weak = first;
+        first.reset();
+        ASSERT(weak.expired());
+        weak = sheet->Snapshot();
+        const std::uint64_t version = sheet->Snapshot()->GetVersion();
+        //       Snapshot(), 
+        //     
+        sheet->SetCell("A2"_pos, "0");
+        auto third = sheet->Snapshot();
+        ASSERT(weak.expired());
+        ASSERT_EQUAL(third->GetVersion(), version + 1);
+
+        //   Snapshot() ,  :  
+        // ,    
+        for (int i = 1; i <= 100; ++i) {
+            sheet->SetCell("A2"_pos, std::to_string(i));
+        }
+        ASSERT_EQUAL(sheet->Snapshot()->GetVersion(), version + 101);
+        ASSERT_EQUAL(print(*sheet->Snapshot()), print(*sheet));
+        ASSERT_EQUAL(third->GetCell("A2"_pos)->GetText(), "0");
+
+        // ,    Snapshot(),  
+        sheet->SetCell("A3"_pos, "7");
+        sheet->Recalculate();
+        ASSERT_EQUAL(std::get<double>(sheet->Snapshot()->GetCell("B1"_pos)->GetValue()), 214.0);
+    }
+
+    void TestSheetViewsWhileWriting() {
+        //       SetCells(), 
+        // ,       
+        constexpr int ROWS = 100;
+        auto sheet = CreateSheet();
+        for (int row = 0; row < ROWS; ++row) {
+            sheet->SetCell({ row, 0 }, "0");
+        }
+        sheet->SetCell("B1"_pos, "=SUM(A1:A100)");
+        sheet->Snapshot();
+
+        std::atomic<bool> done = false;
+        std::vector<int> errors(4);
+        std::vector<std::thread> readers;
+        for (size_t reader = 0; reader < errors.size(); ++reader) {
+            readers.emplace_back([&sheet, &done, &errors, reader] {
+                std::uint64_t last_version = 0;
+                while (!done) {
+                    auto view = sheet->Snapshot();
+                    const double value = std::get<double>(view->GetCell("A1"_pos)->GetNumericValue());
+                    bool consistent = view->GetVersion() >= last_version
+                        && std::get<double>(view->GetCell("B1"_pos)->GetValue()) == value * ROWS;
+                    for (int row = 1; row < ROWS; ++row) {
+                        consistent = consistent && std::get<double>(view->GetCell({ row, 0 })->GetNumericValue()) == value;
+                    }
+                    last_version = view->GetVersion();
+                    errors[reader] += consistent ? 0 : 1;
+                }
+            });
+        }
+        for (int value = 1; value <= 200; ++value) {
+            std::vector<std::pair<Position, std::string>> cells;
+            for (int row = 0; row < ROWS; ++row) {
+                cells.push_back({ { row, 0 }, std::to_string(value) });
+            }
+            sheet->SetCells(std::move(cells));
+        }
+        done = true;
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        ASSERT_EQUAL(std::accumulate(errors.begin(), errors.end(), 0), 0);
+        ASSERT_EQUAL(std::get<double>(sheet->Snapshot()->GetCell("B1"_pos)->GetValue()), 200.0 * ROWS);
+    }
+
+    void TestFork() {
+        auto print = [](const auto& sheet) {
+            std::ostringstream output;
+            sheet.PrintTexts(output);
+            output << "--\n";
+            sheet.PrintValues(output);
+            return output.str();
+        };
+        auto value = [](const SheetInterface& sheet, Position pos) {
+            return std::get<double>(sheet.GetCell(pos)->GetValue());
+        };
+
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("A2"_pos, "2");
+        sheet->SetCell("B1"_pos, "=A1*10");
+        sheet->SetCell("C1"_pos, "=B1+SUM(A1:A3)");
+        sheet->SetCell("D4"_pos, "text");
+
+        auto fork = sheet->Fork();
+        ASSERT_EQUAL(print(*fork), print(*sheet));
+        ASSERT(fork->GetPrintableSize() == (Size{ 4, 4 }));
+
+        //      ,   
+        //  ,     
+        fork->SetCell("A1"_pos, "5");
+        ASSERT_EQUAL(value(*fork, "B1"_pos), 50.0);
+        ASSERT_EQUAL(value(*fork, "C1"_pos), 57.0);
+        ASSERT_EQUAL(value(*sheet, "C1"_pos), 13.0);
+        fork->SetCell("A3"_pos, "3");
+        ASSERT_EQUAL(value(*fork, "C1"_pos), 60.0);
+
+        //      
+        sheet->SetCell("A2"_pos, "100");
+        ASSERT_EQUAL(value(*sheet, "C1"_pos), 111.0);
+        ASSERT_EQUAL(value(*fork, "C1"_pos), 60.0);
+
+        //       
+        fork->ClearCell("D4"_pos);
+        const CellInterface* cleared = fork->GetCell("D4"_pos);
+        ASSERT(cleared == nullptr || cleared->GetText().empty());
+        ASSERT(fork->GetPrintableSize() == (Size{ 3, 3 }));
+        ASSERT_EQUAL(sheet->GetCell("D4"_pos)->GetText(), "text");
+
+        //       ,   
+        // 
+        fork->SetCell("E1"_pos, "=C1*2");
+        ASSERT_EQUAL(value(*fork, "E1"_pos), 120.0);
+        try {
+            fork->SetCell("A1"_pos, "=E1");
+            ASSERT(false);
+        }
+        catch (const CircularDependencyException&) {
+        }
+        ASSERT_EQUAL(value(*fork, "E1"_pos), 120.0);
+        fork->SetCells({ { "A1"_pos, "0" }, { "A2"_pos, "=A1+1" } });
+        ASSERT_EQUAL(value(*fork, "E1"_pos), 8.0);
+
+        //       
+        auto nested = fork->Fork();
+        auto sibling = sheet->Fork();
+        nested->SetCell("A3"_pos, "13");
+        ASSERT_EQUAL(value(*nested, "E1"_pos), 28.0);
+        ASSERT_EQUAL(value(*fork, "E1"_pos), 8.0);
+        ASSERT_EQUAL(value(*sibling, "C1"_pos), 111.0);
+        ASSERT(sibling->GetCell("E1"_pos) == nullptr);
+
+        //  ,        
+        //  
+        auto rebuilt = CreateSheet();
+        fork->ForEachCellInRange({ { 0, 0 }, { Position::MAX_ROWS - 1, Position::MAX_COLS - 1 } },
+            [&rebuilt](Position pos, const CellInterface& cell) {
+                rebuilt->SetCell(pos, cell.GetText());
+            });
+        ASSERT_EQUAL(print(*fork), print(*rebuilt));
+        ASSERT_EQUAL(print(*fork->Snapshot()), print(*rebuilt));
+        fork->SetCell("A1"_pos, "1");
+        rebuilt->SetCell("A1"_pos, "1");
+        ASSERT_EQUAL(print(*fork->Snapshot()), print(*rebuilt));
+
+        const std::string path = (std::filesystem::temp_directory_path() / "spreadsheet_fork_test.bin").string();
+        {
+            std::ofstream file(path, std::ios::binary);
+            fork->SaveSnapshot(file);
+        }
+        auto loaded = LoadSnapshot(path);
+        ASSERT_EQUAL(print(*loaded), print(*rebuilt));
+        loaded.reset();
+        std::filesystem::remove(path);
+
+        //     ,       
+        // ,   ,   ,    
+        sheet->SetCell("F1"_pos, "=1/0");
+        sheet->SetCell("E2"_pos, "text");
+        sheet->SetCell("G1"_pos, "=SUM(E1:F2)");
+        sheet->SetCell("G2"_pos, "=MAX(E2:F3)");
+        ASSERT_EQUAL(sheet->GetCell("G1"_pos)->GetValue(), CellInterface::Value(FormulaError::Category::Div0));
+        auto copy = sheet->Fork();
+        ASSERT_EQUAL(print(*copy), print(*sheet));
+        for (auto* s : { sheet.get(), copy.get() }) {
+            s->SetCell("E1"_pos, "1");
+            s->SetCell("F3"_pos, "=1/0");
+            s->Recalculate();
+        }
+        ASSERT_EQUAL(print(*copy), print(*sheet));
+    }
+
+    void TestFrozenSheet() {
+        auto print = [](const auto& sheet) {
+            std::ostringstream output;
+            sheet.PrintTexts(output);
+            output << "--\n";
+            sheet.PrintValues(output);
+            return output.str();
+        };
+
+        auto sheet = CreateSheet();
+        sheet->SetCell("A1"_pos, "1");
+        sheet->SetCell("A2"_pos, "2.5");
+        sheet->SetCell("A3"_pos, "text");
+        sheet->SetCell("B1"_pos, "=A1+A2");
+        sheet->SetCell("B2"_pos, "=A3*2");
+        sheet->SetCell("B3"_pos, "=1/0");
+        sheet->SetCell("C1"_pos, "'=escaped");
+        sheet->SetCell("E5"_pos, "=SUM(A1:B1)+Z9");
+        sheet->SetCell("D2"_pos, "x");
+        sheet->ClearCell("D2"_pos);
+
+        auto frozen = sheet->Freeze();
+        ASSERT_EQUAL(print(*frozen), print(*sheet));
+        ASSERT(frozen->GetPrintableSize() == sheet->GetPrintableSize());
+        ASSERT(frozen->GetCell("D2"_pos) == nullptr);
+        ASSERT(frozen->GetCell("Z9"_pos) == nullptr);
+        ASSERT(frozen->GetCell("A100"_pos) == nullptr);
+
+        for (Position pos : { "A1"_pos, "A2"_pos, "A3"_pos, "B1"_pos, "B2"_pos, "B3"_pos, "C1"_pos, "E5"_pos }) {
+            const CellInterface* expected = sheet->GetCell(pos);
+            const CellInterface* cell = frozen->GetCell(pos);
+            ASSERT(cell != nullptr);
+            ASSERT_EQUAL(cell->GetText(), expected->GetText());
+            ASSERT(cell->GetValue() == expected->GetValue());
+            ASSERT(cell->GetNumericValue() == expected->GetNumericValue());
+            ASSERT(cell->GetReferencedCells() == expected->GetReferencedCells());
+            ASSERT_EQUAL(frozen->GetText(pos), expected->GetText());
+            ASSERT(frozen->GetNumericValue(pos) == expected->GetNumericValue());
+        }
+        ASSERT_EQUAL(std::get<std::string>(frozen->GetCell("C1"_pos)->GetValue()), "=escaped");
+        ASSERT(std::get<FormulaError>(frozen->GetNumericValue("A3"_pos)).GetCategory()
+            == FormulaError::Category::Value);
+        ASSERT_EQUAL(std::get<double>(frozen->GetNumericValue("E5"_pos)), 4.5);
+        ASSERT_EQUAL(frozen->GetText("D2"_pos), "");
+        ASSERT_EQUAL(std::get<double>(frozen->GetNumericValue("D2"_pos)), 0.0);
+
+        //      
+        const std::string before = print(*frozen);
+        sheet->SetCell("A1"_pos, "100");
+        ASSERT_EQUAL(print(*frozen), before);
+        ASSERT_EQUAL(std::get<double>(frozen->GetNumericValue("B1"_pos)), 3.5);
+
+        //   
+        std::vector<std::thread> readers;
+        std::vector<double> sums(4);
+        for (size_t i = 0; i < sums.size(); ++i) {
+            readers.emplace_back([&frozen, &sums, i] {
+                for (int round = 0; round < 1000; ++round) {
+                    sums[i] += std::get<double>(frozen->GetCell("E5"_pos)->GetNumericValue());
+                }
+            });
+        }
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        for (double sum : sums) {
+            ASSERT_EQUAL(sum, 4500.0);
+        }
+
+        //  
+        auto empty = CreateSheet()->Freeze();
+        ASSERT(empty->GetPrintableSize() == (Size{ 0, 0 }));
+        ASSERT(empty->GetCell("A1"_pos) == nullptr);
+    }
+
+    void TestConcurrentWriters() {
+        constexpr int BANDS = 4;
+        constexpr int ROWS = 50;
+        auto sheet = CreateSheet();
+
+        //          
+        std::vector<std::thread> writers;
+        for (int band = 0; band < BANDS; ++band) {
+            writers.emplace_back([&sheet, band] {
+                const std::string neighbour = "A" + std::to_string((band + 1) % BANDS * ROWS + 1);
+                for (int i = 0; i < ROWS; ++i) {
+                    const int row = band * ROWS + i;
+                    const std::string name = std::to_string(row + 1);
+                    sheet->SetCell({ row, 0 }, std::to_string(row));
+                    sheet->SetCell({ row, 1 }, "=A" + name + "*2");
+                    sheet->SetCells({ { { row, 2 }, "=B" + name + "+" + neighbour } });
+                }
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        ASSERT(sheet->GetPrintableSize() == (Size{ BANDS * ROWS, 3 }));
+        for (int row = 0; row < BANDS * ROWS; ++row) {
+            const int neighbour = (row / ROWS + 1) % BANDS * ROWS;
+            ASSERT_EQUAL(std::get<double>(sheet->GetCell({ row, 2 })->GetValue()), row * 2.0 + neighbour);
+        }
+
+        //      :    
+        writers.clear();
+        for (int writer = 0; writer < 4; ++writer) {
+            writers.emplace_back([&sheet, writer] {
+                for (int i = 0; i < 100; ++i) {
+                    sheet->SetCell({ i % 10, 5 }, "=" + std::to_string(writer) + "+A1");
+                }
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        for (int row = 0; row < 10; ++row) {
+            const CellInterface* cell = sheet->GetCell({ row, 5 });
+            const double value = std::get<double>(cell->GetValue());
+            ASSERT(value >= 0.0 && value <= 3.0);
+            ASSERT_EQUAL(cell->GetText(), "=" + std::to_string(static_cast<int>(value)) + "+A1");
+        }
+
+        //  :      
+        for (int round = 0; round < 20; ++round) {
+            std::atomic<int> failures = 0;
+            auto set = [&sheet, &failures](Position pos, std::string text) {
+                try {
+                    sheet->SetCell(pos, std::move(text));
+                }
+                catch (const CircularDependencyException&) {
+                    ++failures;
+                }
+            };
+            std::thread first(set, "X1"_pos, "=Y1");
+            std::thread second(set, "Y1"_pos, "=X1");
+            first.join();
+            second.join();
+            ASSERT_EQUAL(failures.load(), 1);
+            sheet->ClearCell("X1"_pos);
+            sheet->ClearCell("Y1"_pos);
+        }
+
+        //   ,     ,  
+        //    ; ,   
+        //  ,        
+        constexpr int VALUE_ROWS = 256;
+        auto values = CreateSheet();
+        writers.clear();
+        for (int band = 0; band < BANDS; ++band) {
+            writers.emplace_back([&values, band] {
+                for (int round = 0; round < 3; ++round) {
+                    for (int i = 0; i < VALUE_ROWS; ++i) {
+                        const int row = band * VALUE_ROWS + i;
+                        values->SetCell({ row, 0 }, std::to_string(round));
+                        if (round == 2 && row % 2 == 1) {
+                            values->ClearCell({ row, 1 });
+                        }
+                        else {
+                            values->SetCell({ row, 1 }, "row " + std::to_string(row));
+                        }
+                    }
+                }
+            });
+        }
+        writers.emplace_back([&values] {
+            values->SetCell("D1"_pos, "=SUM(A1:A" + std::to_string(BANDS * VALUE_ROWS) + ")");
+        });
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        ASSERT(values->GetPrintableSize() == (Size{ BANDS * VALUE_ROWS, 4 }));
+        for (int row = 0; row < BANDS * VALUE_ROWS; ++row) {
+            ASSERT_EQUAL(values->GetCell({ row, 0 })->GetText(), "2");
+            const CellInterface* text = values->GetCell({ row, 1 });
+            ASSERT_EQUAL(text != nullptr ? text->GetText() : "", row % 2 == 1 ? "" : "row " + std::to_string(row));
+        }
+        ASSERT_EQUAL(std::get<double>(values->GetCell("D1"_pos)->GetValue()), 2.0 * BANDS * VALUE_ROWS);
+        values->SetCell("A1"_pos, "100");
+        ASSERT_EQUAL(std::get<double>(values->GetCell("D1"_pos)->GetValue()), 2.0 * BANDS * VALUE_ROWS + 98);
+    }
 }  // namespace
 
 int main() {
@@ -374,5 +2118,36 @@ int main() {
     RUN_TEST(tr, TestCellReferences);
     RUN_TEST(tr, TestFormulaIncorrect);
     RUN_TEST(tr, TestCellCircularReferences);
+    RUN_TEST(tr, TestBlockStorage);
+    RUN_TEST(tr, TestClearReferencedCell);
+    RUN_TEST(tr, TestPrintableSizeTracking);
+    RUN_TEST(tr, TestPrintSparseSheet);
+    RUN_TEST(tr, TestBytecodeMatchesTree);
+    RUN_TEST(tr, TestErrorPropagation);
+    RUN_TEST(tr, TestNumericText);
+    RUN_TEST(tr, TestParserBackendsAgree);
+    RUN_TEST(tr, TestSharedRelativeFormulas);
+    RUN_TEST(tr, TestRecalculate);
+    RUN_TEST(tr, TestParallelRecalculate);
+    RUN_TEST(tr, TestCyclicCheckOnLargeGraphs);
+    RUN_TEST(tr, TestRejectedFormulaKeepsDependencies);
+    RUN_TEST(tr, TestInvalidationOfLargeCones);
+    RUN_TEST(tr, TestSmallPtrSet);
+    RUN_TEST(tr, TestRangeReferences);
+    RUN_TEST(tr, TestRangeCircularReferences);
+    RUN_TEST(tr, TestRangeIndex);
+    RUN_TEST(tr, TestFunctions);
+    RUN_TEST(tr, TestIfEvaluatesOneBranch);
+    RUN_TEST(tr, TestAggregateKernels);
+    RUN_TEST(tr, TestColumnCache);
+    RUN_TEST(tr, TestSetCells);
+    RUN_TEST(tr, TestImportTexts);
+    RUN_TEST(tr, TestSnapshot);
+    RUN_TEST(tr, TestConcurrentReads);
+    RUN_TEST(tr, TestSheetViews);
+    RUN_TEST(tr, TestSheetViewsWhileWriting);
+    RUN_TEST(tr, TestFork);
+    RUN_TEST(tr, TestFrozenSheet);
+    RUN_TEST(tr, TestConcurrentWriters);
     return 0;
 }
@@ -0,0 +1,98 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+    if (!Open(path)) {
+        Close();
+        throw std::runtime_error("Cannot read file: " + path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    file_ = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size)) {
+        return false;
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0) {
+        return true;
+    }
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+        return false;
+    }
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    return data_ != nullptr;
+}
+
+void MappedFile::Close() {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+    }
+    if (file_ != nullptr) {
+        CloseHandle(file_);
+    }
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+    fd_ = open(path.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd_ < 0 || fstat(fd_, &status) != 0) {
+        return false;
+    }
+    size_ = static_cast<size_t>(status.st_size);
+    if (size_ == 0) {
+        return true;
+    }
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<const char*>(data);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    data_ = nullptr;
+    fd_ = -1;
+}
+
+#endif
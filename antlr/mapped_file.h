@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Файл, отображённый в память только для чтения. Страницы читаются с диска
+// при первом обращении к ним. Бросает std::runtime_error, если файл не удалось
+// открыть или отобразить.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    std::string_view GetText() const {
+        return { data_, size_ };
+    }
+
+private:
+    bool Open(const std::string& path);
+    void Close();
+
+#ifdef _WIN32
+    // HANDLE файла и его отображения
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,78 @@
+#include "output_buffer.h"
+
+#include <cstdio>
+#include <ios>
+#include <locale>
+#include <ostream>
+#include <variant>
+
+namespace {
+    constexpr std::streamsize MAX_PLAIN_PRECISION = 32;
+
+    bool HasDefaultNumberFormat(const std::ostream& output) {
+        const auto flags = output.flags();
+        return (flags & (std::ios_base::floatfield | std::ios_base::showpos
+            | std::ios_base::showpoint | std::ios_base::uppercase)) == 0
+            && output.width() == 0
+            && output.precision() <= MAX_PLAIN_PRECISION
+            && output.getloc() == std::locale::classic();
+    }
+}
+
+OutputBuffer::OutputBuffer(std::ostream& output)
+    : output_(output)
+    , plain_numbers_(HasDefaultNumberFormat(output)) {
+    buffer_.reserve(CAPACITY + CAPACITY / 2);
+    if (!plain_numbers_) {
+        number_.copyfmt(output);
+    }
+}
+
+void OutputBuffer::Put(char c, size_t count) {
+    buffer_.append(count, c);
+    if (buffer_.size() >= CAPACITY) {
+        Drain();
+    }
+}
+
+void OutputBuffer::Write(std::string_view text) {
+    buffer_.append(text);
+    if (buffer_.size() >= CAPACITY) {
+        Drain();
+    }
+}
+
+void OutputBuffer::Write(double value) {
+    if (plain_numbers_) {
+        // std::ostream выводит double без флагов форматирования как "%.*g".
+        char digits[MAX_PLAIN_PRECISION + 16];
+        int length = std::snprintf(digits, sizeof(digits), "%.*g",
+            static_cast<int>(output_.precision()), value);
+        Write(std::string_view(digits, length));
+    }
+    else {
+        number_.str({});
+        number_ << value;
+        Write(number_.str());
+    }
+}
+
+void OutputBuffer::Write(FormulaError error) {
+    Write(error.ToString());
+}
+
+void OutputBuffer::WriteValue(const CellInterface::Value& value) {
+    std::visit([this](const auto& x) {
+        Write(x);
+    }, value);
+}
+
+void OutputBuffer::Flush() {
+    Drain();
+    output_.flush();
+}
+
+void OutputBuffer::Drain() {
+    output_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+}
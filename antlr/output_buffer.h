@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.h"
+
+#include <iosfwd>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+// Буфер для вывода таблицы в поток. Накапливает текст и передаёт его в поток
+// крупными порциями, сбрасывая поток один раз в Flush(). Числа форматируются
+// так же, как их вывел бы сам поток с его текущими настройками.
+class OutputBuffer {
+public:
+    static constexpr size_t CAPACITY = 1 << 16;
+
+    explicit OutputBuffer(std::ostream& output);
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void Put(char c) {
+        buffer_.push_back(c);
+        if (buffer_.size() >= CAPACITY) {
+            Drain();
+        }
+    }
+
+    void Put(char c, size_t count);
+    void Write(std::string_view text);
+    void Write(double value);
+    void Write(FormulaError error);
+    void WriteValue(const CellInterface::Value& value);
+
+    void Flush();
+
+private:
+    void Drain();
+
+    std::ostream& output_;
+    std::string buffer_;
+    bool plain_numbers_;
+    std::ostringstream number_;
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Множество пар (диапазон, значение) с поиском диапазонов, содержащих ячейку.
+// По изменённой ячейке находит формулы, которые ссылаются на неё через
+// диапазон, не перебирая все такие формулы.
+//
+// Пары хранятся в нескольких статических R-деревьях (логарифмический метод
+// Бентли - Сакса): дерево уровня k содержит не больше 2^k пар. Вставка
+// сливает занятые младшие уровни в один, как перенос при сложении двоичных
+// чисел, поэтому каждая пара перестраивается O(log n) раз. Поиск проверяет
+// O(log n) деревьев и спускается только в узлы, чей прямоугольник содержит
+// ячейку. Удалённые пары помечаются и выбрасываются при слиянии уровней или
+// при полной перестройке, когда их становится больше, чем оставшихся.
+template <typename T>
+class RangeIndex {
+public:
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    void Insert(Range range, T value) {
+        std::vector<Entry> entries{ { range, std::move(value), false } };
+        size_t level = 0;
+        for (; level < levels_.size() && !levels_[level].Empty(); ++level) {
+            erased_ -= levels_[level].MoveLiveEntries(entries);
+        }
+        if (level == levels_.size()) {
+            levels_.emplace_back();
+        }
+        levels_[level] = PackedTree(std::move(entries));
+        ++size_;
+    }
+
+    // Удаляет одну пару. Возвращает false, если такой пары нет.
+    bool Erase(Range range, const T& value) {
+        for (PackedTree& tree : levels_) {
+            if (tree.Erase(range, value)) {
+                --size_;
+                ++erased_;
+                if (erased_ > size_) {
+                    Rebuild();
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Вызывает f(value) для каждой пары, диапазон которой содержит pos.
+    template <typename F>
+    void ForEachContaining(Position pos, F&& f) const {
+        if (size_ == 0) {
+            return;
+        }
+        for (const PackedTree& tree : levels_) {
+            tree.ForEachContaining(pos, f);
+        }
+    }
+
+    void Clear() {
+        levels_.clear();
+        size_ = 0;
+        erased_ = 0;
+    }
+
+private:
+    struct Entry {
+        Range range;
+        T value;
+        bool erased;
+    };
+
+    // R-дерево, упакованное по алгоритму STR (Sort-Tile-Recursive): пары
+    // разложены на полосы по строкам, внутри полосы упорядочены по столбцам,
+    // и каждые NODE_CAPACITY соседних пар образуют лист. Узел следующего
+    // уровня объединяет NODE_CAPACITY соседних узлов предыдущего. Дерево
+    // хранится массивами ограничивающих прямоугольников по уровням.
+    class PackedTree {
+    public:
+        PackedTree() = default;
+
+        explicit PackedTree(std::vector<Entry> entries)
+            : entries_(std::move(entries)) {
+            SortTiles();
+            BuildBounds();
+        }
+
+        bool Empty() const {
+            return entries_.empty();
+        }
+
+        // Переносит неудалённые пары в out и опустошает дерево. Возвращает
+        // число выброшенных удалённых пар.
+        size_t MoveLiveEntries(std::vector<Entry>& out) {
+            size_t erased = 0;
+            for (Entry& entry : entries_) {
+                if (entry.erased) {
+                    ++erased;
+                }
+                else {
+                    out.push_back(std::move(entry));
+                }
+            }
+            entries_.clear();
+            bounds_.clear();
+            return erased;
+        }
+
+        bool Erase(Range range, const T& value) {
+            bool found = false;
+            Search(
+                [range](const Range& bounds) {
+                    return Covers(bounds, range);
+                },
+                [&](size_t index) {
+                    Entry& entry = entries_[index];
+                    if (entry.erased || !(entry.range == range) || !(entry.value == value)) {
+                        return false;
+                    }
+                    entry.erased = true;
+                    found = true;
+                    return true;
+                });
+            return found;
+        }
+
+        template <typename F>
+        void ForEachContaining(Position pos, F& f) const {
+            Search(
+                [pos](const Range& bounds) {
+                    return bounds.Contains(pos);
+                },
+                [&](size_t index) {
+                    const Entry& entry = entries_[index];
+                    if (!entry.erased && entry.range.Contains(pos)) {
+                        f(entry.value);
+                    }
+                    return false;
+                });
+        }
+
+    private:
+        static constexpr size_t NODE_CAPACITY = 16;
+
+        static bool Covers(const Range& outer, const Range& inner) {
+            return outer.Contains(inner.from) && outer.Contains(inner.to);
+        }
+
+        static Range Union(const Range& lhs, const Range& rhs) {
+            return { { std::min(lhs.from.row, rhs.from.row), std::min(lhs.from.col, rhs.from.col) },
+                { std::max(lhs.to.row, rhs.to.row), std::max(lhs.to.col, rhs.to.col) } };
+        }
+
+        void SortTiles() {
+            // центры сравниваются удвоенными, чтобы остаться в целых числах
+            auto by_row = [](const Entry& lhs, const Entry& rhs) {
+                return lhs.range.from.row + lhs.range.to.row < rhs.range.from.row + rhs.range.to.row;
+            };
+            auto by_col = [](const Entry& lhs, const Entry& rhs) {
+                return lhs.range.from.col + lhs.range.to.col < rhs.range.from.col + rhs.range.to.col;
+            };
+
+            const size_t leaves = (entries_.size() + NODE_CAPACITY - 1) / NODE_CAPACITY;
+            const auto slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(leaves))));
+            const size_t slice_size = slices * NODE_CAPACITY;
+            std::sort(entries_.begin(), entries_.end(), by_row);
+            for (size_t first = 0; first < entries_.size(); first += slice_size) {
+                const size_t last = std::min(first + slice_size, entries_.size());
+                std::sort(entries_.begin() + first, entries_.begin() + last, by_col);
+            }
+        }
+
+        void BuildBounds() {
+            std::vector<Range> level;
+            for (size_t first = 0; first < entries_.size(); first += NODE_CAPACITY) {
+                Range bounds = entries_[first].range;
+                const size_t last = std::min(first + NODE_CAPACITY, entries_.size());
+                for (size_t index = first + 1; index < last; ++index) {
+                    bounds = Union(bounds, entries_[index].range);
+                }
+                level.push_back(bounds);
+            }
+            bounds_.push_back(std::move(level));
+
+            while (bounds_.back().size() > 1) {
+                const std::vector<Range>& children = bounds_.back();
+                level.clear();
+                for (size_t first = 0; first < children.size(); first += NODE_CAPACITY) {
+                    Range bounds = children[first];
+                    const size_t last = std::min(first + NODE_CAPACITY, children.size());
+                    for (size_t index = first + 1; index < last; ++index) {
+                        bounds = Union(bounds, children[index]);
+                    }
+                    level.push_back(bounds);
+                }
+                bounds_.push_back(std::move(level));
+            }
+        }
+
+        // Обходит пары в узлах, для прямоугольников которых covers вернула
+        // true. visit получает номер пары и возвращает true, чтобы
+        // остановить обход.
+        template <typename CoversFn, typename VisitFn>
+        void Search(CoversFn covers, VisitFn visit) const {
+            if (!entries_.empty() && covers(bounds_.back().front())) {
+                SearchNode(bounds_.size() - 1, 0, covers, visit);
+            }
+        }
+
+        template <typename CoversFn, typename VisitFn>
+        bool SearchNode(size_t level, size_t node, CoversFn& covers, VisitFn& visit) const {
+            const size_t first = node * NODE_CAPACITY;
+            if (level == 0) {
+                const size_t last = std::min(first + NODE_CAPACITY, entries_.size());
+                for (size_t index = first; index < last; ++index) {
+                    if (visit(index)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            const std::vector<Range>& children = bounds_[level - 1];
+            const size_t last = std::min(first + NODE_CAPACITY, children.size());
+            for (size_t child = first; child < last; ++child) {
+                if (covers(children[child]) && SearchNode(level - 1, child, covers, visit)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::vector<Entry> entries_;
+        // bounds_[0] - прямоугольники листьев, bounds_.back() - корень
+        std::vector<std::vector<Range>> bounds_;
+    };
+
+    // Собирает все пары в одно дерево на наименьшем подходящем уровне.
+    void Rebuild() {
+        std::vector<Entry> entries;
+        entries.reserve(size_);
+        for (PackedTree& tree : levels_) {
+            tree.MoveLiveEntries(entries);
+        }
+        erased_ = 0;
+        if (entries.empty()) {
+            levels_.clear();
+            return;
+        }
+
+        size_t level = 0;
+        while ((size_t{ 1 } << level) < entries.size()) {
+            ++level;
+        }
+        levels_.resize(std::max(levels_.size(), level + 1));
+        levels_[level] = PackedTree(std::move(entries));
+    }
+
+    // levels_[k] - дерево не больше чем из 2^k пар, удалённые включая
+    std::vector<PackedTree> levels_;
+    size_t size_ = 0;
+    size_t erased_ = 0;
+};
@@ -2,131 +2,831 @@
 
 #include "cell.h"
 #include "common.h"
+#include "formula.h"
+#include "frozen_sheet.h"
+#include "output_buffer.h"
 
 #include <algorithm>
+#include <exception>
 #include <functional>
 #include <iostream>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 using namespace std::literals;
 
+namespace {
+
+//    ,   .
+class DepthCounter {
+public:
+    explicit DepthCounter(int& depth)
+        : depth_(depth) {
+        ++depth_;
+    }
+
+    ~DepthCounter() {
+        --depth_;
+    }
+
+private:
+    int& depth_;
+};
+
+//     cells   ,  
+// for_each_base.      less.   
+//      ,    :
+// f(pos, cell)   Cell,  SheetView::ViewCell.
+template <typename Less, typename ForEachBase, typename F>
+void MergeWithBase(const std::vector<std::pair<Position, const Cell*>>& cells, Less less,
+    ForEachBase for_each_base, F&& f) {
+    size_t next = 0;
+    auto add_cell = [&f](const std::pair<Position, const Cell*>& entry) {
+        if (!entry.second->IsEmpty()) {
+            f(entry.first, *entry.second);
+        }
+    };
+    for_each_base([&](Position pos, const SheetView::ViewCell& cell) {
+        while (next < cells.size() && less(cells[next].first, pos)) {
+            add_cell(cells[next++]);
+        }
+        if (next < cells.size() && cells[next].first == pos) {
+            add_cell(cells[next++]);
+        }
+        else {
+            f(pos, cell);
+        }
+    });
+    for (; next < cells.size(); ++next) {
+        add_cell(cells[next]);
+    }
+}
+
+}  // namespace
+
+class Sheet::WriteLock {
+public:
+    explicit WriteLock(Sheet& sheet)
+        : sheet_(sheet)
+        , guard_(sheet.write_mutex_) {
+        if (sheet_.write_locks_++ == 0) {
+            sheet_.local_edits_mutex_.lock();
+            sheet_.writer_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        }
+    }
+
+    ~WriteLock() {
+        if (--sheet_.write_locks_ == 0) {
+            sheet_.writer_.store(std::thread::id(), std::memory_order_relaxed);
+            sheet_.local_edits_mutex_.unlock();
+        }
+    }
+
+private:
+    Sheet& sheet_;
+    std::lock_guard<std::recursive_mutex> guard_;
+};
+
 Sheet::~Sheet() {}
 
 void Sheet::SetCell(Position pos, std::string text) {
     if (pos.IsValid()) {
-        if (table_.find(pos) != table_.end()) {
-            table_[pos]->Set(text, pos);
+        //     ,    , 
+        //      .
+        Cell::Edit edit = Cell::Prepare(*this, pos, std::move(text));
+        if (TrySetLocalCell(edit)) {
+            return;
         }
-        else {
-            table_[pos] = std::make_unique<Cell>(*this);
-            table_[pos]->Set(text, pos);
+        const WriteLock lock(*this);
+        const DepthCounter depth(write_depth_);
+        if (snapshot_) {
+            FinishSnapshotLoad();
         }
+        if (base_) {
+            LinkBaseDependents({ pos });
+        }
+        bool created = table_.Find(pos) == nullptr;
+        Cell& cell = table_.GetOrCreate(pos, *this, graph_, pos);
+        bool was_empty = cell.IsEmpty();
+        try {
+            cell.Set(std::move(edit));
+        }
+        catch (...) {
+            if (created) {
+                table_.Erase(pos);
+            }
+            throw;
+        }
+        UpdatePrintableSize(pos, was_empty, cell.IsEmpty());
+        MarkViewStale({ pos });
     }
     else {
         throw InvalidPositionException("Set Cell: out of range");
     }
 }
 
+void Sheet::SetCells(std::vector<std::pair<Position, std::string>> cells) {
+    for (const auto& [pos, text] : cells) {
+        if (!pos.IsValid()) {
+            throw InvalidPositionException("Set Cells: out of range");
+        }
+    }
+    constexpr size_t MIN_PARALLEL_EDITS = 1024;
+    constexpr size_t EDITS_PER_BLOCK = 64;
+
+    std::vector<Cell::Edit> edits(cells.size());
+    auto prepare = [this, &cells, &edits](size_t i) {
+        edits[i] = Cell::Prepare(*this, cells[i].first, std::move(cells[i].second));
+    };
+    //     ,   
+    //  .
+    const bool parallel = cells.size() >= MIN_PARALLEL_EDITS;
+    if (!parallel) {
+        for (size_t i = 0; i < cells.size(); ++i) {
+            prepare(i);
+        }
+    }
+
+    const WriteLock lock(*this);
+    const DepthCounter depth(write_depth_);
+    if (snapshot_) {
+        FinishSnapshotLoad();
+    }
+    if (base_) {
+        std::vector<Position> edited;
+        edited.reserve(cells.size());
+        for (const auto& [pos, text] : cells) {
+            edited.push_back(pos);
+        }
+        LinkBaseDependents(edited);
+    }
+
+    // ,  ,   
+    std::vector<Position> created;
+    auto get_or_create = [this, &created](Position pos) -> Cell& {
+        if (Cell* cell = FindOrCopyCell(pos)) {
+            return *cell;
+        }
+        created.push_back(pos);
+        return table_.GetOrCreate(pos, *this, graph_, pos);
+    };
+
+    //    ,      
+    // .      ,     
+    // , -   .
+    if (parallel && pool_) {
+        std::mutex mutex;
+        size_t error_index = cells.size();
+        std::exception_ptr error;
+        const size_t blocks = (cells.size() + EDITS_PER_BLOCK - 1) / EDITS_PER_BLOCK;
+        ParallelFor(*pool_, blocks, [&](size_t block) {
+            const size_t end = std::min(cells.size(), (block + 1) * EDITS_PER_BLOCK);
+            for (size_t i = block * EDITS_PER_BLOCK; i < end; ++i) {
+                try {
+                    prepare(i);
+                }
+                catch (...) {
+                    std::lock_guard guard(mutex);
+                    if (i < error_index) {
+                        error_index = i;
+                        error = std::current_exception();
+                    }
+                    return;
+                }
+            }
+        });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    else if (parallel) {
+        for (size_t i = 0; i < cells.size(); ++i) {
+            prepare(i);
+        }
+    }
+
+    try {
+        for (Cell::Edit& edit : edits) {
+            edit.cell = &get_or_create(edit.pos);
+            edit.was_empty = edit.cell->IsEmpty();
+        }
+        for (const Cell::Edit& edit : edits) {
+            for (Position pos : edit.cells) {
+                get_or_create(pos);
+            }
+        }
+        Cell::ApplyBatch(edits);
+    }
+    catch (...) {
+        for (Position pos : created) {
+            table_.Erase(pos);
+        }
+        throw;
+    }
+
+    std::vector<Position> edited;
+    edited.reserve(edits.size());
+    for (const Cell::Edit& edit : edits) {
+        UpdatePrintableSize(edit.pos, edit.was_empty, edit.cell->IsEmpty());
+        edited.push_back(edit.pos);
+    }
+    MarkViewStale(edited);
+}
+
 const CellInterface* Sheet::GetCell(Position pos) const {
+    if (base_ && pos.IsValid()) {
+        if (const Cell* cell = table_.Find(pos)) {
+            return cell;
+        }
+        return base_->GetCell(pos);
+    }
     return const_cast<Sheet*>(this)->GetCell(pos);
 }
 
 CellInterface* Sheet::GetCell(Position pos) {
     if (pos.IsValid()) {
-        if (table_.find(pos) != table_.end()) {
-            return table_.at(pos).get();
-        }
-        else {
-            return nullptr;
+        if (snapshot_) {
+            LoadSnapshotBlocks({ pos, pos });
         }
+        return FindOrCopyCell(pos);
     }
     else {
         throw InvalidPositionException("Get Cell: out of range");
     }
 }
 
+Cell* Sheet::FindOrCopyCell(Position pos) {
+    if (Cell* cell = table_.Find(pos)) {
+        return cell;
+    }
+    if (!base_) {
+        return nullptr;
+    }
+    const auto* base_cell = static_cast<const SheetView::ViewCell*>(base_->GetCell(pos));
+    if (base_cell == nullptr) {
+        return nullptr;
+    }
+    Cell& cell = table_.GetOrCreate(pos, *this, graph_, pos);
+    if (const auto& ast = base_cell->GetFormulaAST()) {
+        cell.LoadFormula(MakeFormula(ast, pos, base_cell->GetText().substr(1)), base_cell->GetNumericValue());
+    }
+    else {
+        cell.LoadText(base_cell->GetText());
+    }
+    return &cell;
+}
+
+Cell& Sheet::GetOrCreateCell(Position pos) {
+    if (Cell* cell = FindOrCopyCell(pos)) {
+        return *cell;
+    }
+    return table_.GetOrCreate(pos, *this, graph_, pos);
+}
+
+void Sheet::LinkBaseDependents(const std::vector<Position>& edited) {
+    if (row_counts_.empty() && col_counts_.empty()) {
+        row_counts_ = base_->GetRowCounts();
+        col_counts_ = base_->GetColCounts();
+    }
+
+    //       ,   ,
+    //     . ,   
+    // ,  : ,    ,  
+    //  .
+    std::vector<Position> pending;
+    for (Position pos : edited) {
+        if (linked_.insert(SheetView::GetCellKey(pos)).second) {
+            pending.push_back(pos);
+        }
+    }
+    while (!pending.empty()) {
+        const Position pos = pending.back();
+        pending.pop_back();
+        if (Cell* cell = FindOrCopyCell(pos)) {
+            for (Position referenced : cell->GetReferencedCells()) {
+                GetOrCreateCell(referenced);
+            }
+            cell->AttachLoaded();
+        }
+        base_->ForEachDependent(pos, [this, &pending](Position dependent) {
+            if (linked_.insert(SheetView::GetCellKey(dependent)).second) {
+                pending.push_back(dependent);
+            }
+        });
+    }
+}
+
 void Sheet::ClearCell(Position pos) {
     // Size range = GetPrintableSize();
     if (pos.IsValid() /* && !(range.cols < pos.col && range.rows < pos.row) */ ) {
-        table_.erase(pos);
+        if (TryClearLocalCell(pos)) {
+            return;
+        }
+        const WriteLock lock(*this);
+        const DepthCounter depth(write_depth_);
+        if (snapshot_) {
+            FinishSnapshotLoad();
+        }
+        if (base_) {
+            LinkBaseDependents({ pos });
+        }
+        Cell* cell = table_.Find(pos);
+        if (cell != nullptr) {
+            UpdatePrintableSize(pos, cell->IsEmpty(), true);
+            cell->Clear();
+            //      
+            if (!cell->IsReferenced() && !(base_ && base_->GetCell(pos))) {
+                table_.Erase(pos);
+            }
+            MarkViewStale({ pos });
+        }
     }
     else {
         throw InvalidPositionException("Clear Cell: out of range");
     }
 }
 
+bool Sheet::IsLocalEdit(Position pos, const Cell* cell) const {
+    if (snapshot_ || base_ || graph_.column_caches.Find(pos.col) != nullptr) {
+        return false;
+    }
+    if (cell != nullptr && (cell->GetFormula() != nullptr || cell->IsReferenced())) {
+        return false;
+    }
+    bool in_range = false;
+    graph_.range_dependents.ForEachContaining(pos, [&in_range](const Cell* /* formula */) {
+        in_range = true;
+    });
+    return !in_range;
+}
+
+bool Sheet::TrySetLocalCell(Cell::Edit& edit) {
+    if (edit.type == FORMULA || writer_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        return false;
+    }
+    const std::shared_lock local_guard(local_edits_mutex_);
+    const std::lock_guard band_guard(GetBandMutex(edit.pos));
+    Cell* cell = table_.Find(edit.pos);
+    if (!IsLocalEdit(edit.pos, cell)) {
+        return false;
+    }
+    const bool was_empty = cell == nullptr || cell->IsEmpty();
+    if (cell == nullptr) {
+        //     ,    WriteLock
+        cell = table_.CreateInBlock(edit.pos, *this, graph_, edit.pos);
+        if (cell == nullptr) {
+            return false;
+        }
+    }
+    const Position pos = edit.pos;
+    cell->Set(std::move(edit));
+
+    const std::lock_guard totals_guard(totals_mutex_);
+    UpdatePrintableSize(pos, was_empty, cell->IsEmpty());
+    MarkViewStale({ pos });
+    return true;
+}
+
+bool Sheet::TryClearLocalCell(Position pos) {
+    if (writer_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        return false;
+    }
+    const std::shared_lock local_guard(local_edits_mutex_);
+    const std::lock_guard band_guard(GetBandMutex(pos));
+    Cell* cell = table_.Find(pos);
+    if (!IsLocalEdit(pos, cell)) {
+        return false;
+    }
+    if (cell == nullptr) {
+        return true;
+    }
+    const bool was_empty = cell->IsEmpty();
+    cell->Clear();
+    table_.Erase(pos);
+
+    const std::lock_guard totals_guard(totals_mutex_);
+    UpdatePrintableSize(pos, was_empty, true);
+    MarkViewStale({ pos });
+    return true;
+}
+
+std::mutex& Sheet::GetBandMutex(Position pos) {
+    return band_mutexes_[pos.row / BlockStorage<Cell>::BLOCK_ROWS % BAND_LOCKS];
+}
+
 Size Sheet::GetPrintableSize() const {
-    if (table_.empty()) {
-        return Size{ 0, 0 };
+    return printable_size_;
+}
+
+void Sheet::UpdatePrintableSize(Position pos, bool was_empty, bool is_empty) {
+    if (was_empty == is_empty) {
+        return;
+    }
+
+    if (was_empty) {
+        if (row_counts_.size() <= static_cast<size_t>(pos.row)) {
+            row_counts_.resize(pos.row + 1);
+        }
+        if (col_counts_.size() <= static_cast<size_t>(pos.col)) {
+            col_counts_.resize(pos.col + 1);
+        }
+
+        ++row_counts_[pos.row];
+        ++col_counts_[pos.col];
+        printable_size_.rows = std::max(printable_size_.rows, pos.row + 1);
+        printable_size_.cols = std::max(printable_size_.cols, pos.col + 1);
+    }
+    else {
+        --row_counts_[pos.row];
+        --col_counts_[pos.col];
+        while (printable_size_.rows > 0 && row_counts_[printable_size_.rows - 1] == 0) {
+            --printable_size_.rows;
+        }
+        while (printable_size_.cols > 0 && col_counts_[printable_size_.cols - 1] == 0) {
+            --printable_size_.cols;
+        }
+    }
+}
+
+void Sheet::PrintValues(std::ostream& output) const {
+    auto print_value = [](OutputBuffer& buffer, const CellInterface& cell) {
+        buffer.WriteValue(cell.GetValue());
+    };
+    if (base_) {
+        PrintMergedCells(output, print_value);
+    }
+    else {
+        PrintCells(output, print_value);
     }
+}
 
-    Size num;
+void Sheet::PrintTexts(std::ostream& output) const {
+    auto print_text = [](OutputBuffer& buffer, const CellInterface& cell) {
+        buffer.Write(cell.GetText());
+    };
+    if (base_) {
+        PrintMergedCells(output, print_text);
+    }
+    else {
+        PrintCells(output, print_text);
+    }
+}
 
-    for (const auto& pos : table_) {
-        if (num.cols <= pos.first.col) {
-            num.cols = pos.first.col + 1;
+void Sheet::ForEachCellInRange(Range range,
+    const std::function<void(Position, const CellInterface&)>& f) const {
+    if (snapshot_) {
+        LoadSnapshotBlocks(range);
+    }
+    if (base_) {
+        std::vector<std::pair<Position, const Cell*>> cells;
+        table_.ForEachInRange(range, [&cells](Position pos, const Cell& cell) {
+            cells.emplace_back(pos, &cell);
+        });
+        MergeWithBase(cells, std::less<Position>(), [this, range](const auto& g) {
+            base_->ForEachInRange(range, g);
+        }, [&f](Position pos, const CellInterface& cell) {
+            f(pos, cell);
+        });
+        return;
+    }
+    table_.ForEachInRange(range, [&f](Position pos, const Cell& cell) {
+        if (!cell.IsEmpty()) {
+            f(pos, cell);
         }
+    });
+}
 
-        if (num.rows <= pos.first.row) {
-            num.rows = pos.first.row + 1;
+bool Sheet::ForEachValueRun(Range range,
+    const std::function<void(Position, const double*, size_t)>& f) const {
+    for (int col = range.from.col; col <= range.to.col; ++col) {
+        if (graph_.column_caches.Find(col) == nullptr) {
+            return false;
         }
     }
 
-    return num;
+    for (int col = range.from.col; col <= range.to.col; ++col) {
+        const ColumnCache& column = *graph_.column_caches.Find(col);
+        //         
+        column.ForEachStale(range.from.row, range.to.row, [this, col](int row) {
+            table_.Find({ row, col })->GetNumericValue();
+        });
+        column.ForEachRun(range.from.row, range.to.row, [&f, col](int row, const double* values, size_t count) {
+            f({ row, col }, values, count);
+        });
+    }
+    return true;
 }
 
-void Sheet::PrintValues(std::ostream& output) const {
+template <typename CellPrinter>
+void Sheet::PrintCells(std::ostream& output, CellPrinter print_cell) const {
     Size range = GetPrintableSize();
+    if (snapshot_ && range.rows > 0 && range.cols > 0) {
+        LoadSnapshotBlocks({ { 0, 0 }, { range.rows - 1, range.cols - 1 } });
+    }
+    OutputBuffer buffer(output);
     for (int row = 0; row < range.rows; row++) {
-        for (int col = 0; col < range.cols; col++) {
-            const CellInterface* cell = GetCell({ row, col });
-            if (col > 0) {
-                output << '\t';
-            }
-            if (cell != nullptr) {
-                output << cell->GetValue();
+        int tabs = 0;
+        table_.ForEachInRow(row, [&](int col, const Cell& cell) {
+            if (col >= range.cols || cell.IsEmpty()) {
+                return;
             }
+            buffer.Put('\t', col - tabs);
+            tabs = col;
+            print_cell(buffer, cell);
+        });
+        buffer.Put('\t', range.cols - 1 - tabs);
+        buffer.Put('\n');
+    }
+    buffer.Flush();
+}
+
+template <typename CellPrinter>
+void Sheet::PrintMergedCells(std::ostream& output, CellPrinter print_cell) const {
+    const Size range = GetPrintableSize();
+    OutputBuffer buffer(output);
+    int row = 0;
+    int tabs = 0;
+    auto finish_rows = [&](int end) {
+        for (; row < end; ++row) {
+            buffer.Put('\t', range.cols - 1 - tabs);
+            buffer.Put('\n');
+            tabs = 0;
         }
-        output << std::endl;
+    };
+    if (range.rows > 0 && range.cols > 0) {
+        ForEachCellInRange({ { 0, 0 }, { range.rows - 1, range.cols - 1 } },
+            [&](Position pos, const CellInterface& cell) {
+                finish_rows(pos.row);
+                buffer.Put('\t', pos.col - tabs);
+                tabs = pos.col;
+                print_cell(buffer, cell);
+            });
     }
+    finish_rows(range.rows);
+    buffer.Flush();
 }
 
-void Sheet::PrintTexts(std::ostream& output) const {
-    Size range = GetPrintableSize();
-    for (int row = 0; row < range.rows; row++) {
-        for (int col = 0; col < range.cols; col++) {
-            const CellInterface* cell = GetCell({ row, col });
-            if (col > 0) {
-                output << '\t';
-            }
-            if (cell != nullptr) {
-                output << cell->GetText();
-            }
+void Sheet::Recalculate() {
+    const WriteLock lock(*this);
+    if (snapshot_) {
+        FinishSnapshotLoad();
+    }
+    RememberDirtyCells();
+    Cell::Recalculate(graph_.dirty_cells, pool_.get());
+}
+
+void Sheet::SetRecalculationThreads(size_t threads) {
+    const WriteLock lock(*this);
+    if (threads <= 1) {
+        pool_.reset();
+    }
+    else if (!pool_ || pool_->GetThreadCount() != threads) {
+        pool_ = std::make_unique<ThreadPool>(threads);
+    }
+}
+
+void Sheet::SaveSnapshot(std::ostream& output) const {
+    if (snapshot_) {
+        LoadSnapshotBlocks({ { 0, 0 }, { Position::MAX_ROWS - 1, Position::MAX_COLS - 1 } });
+    }
+    constexpr int BLOCK_ROWS = BlockStorage<Cell>::BLOCK_ROWS;
+    constexpr int BLOCK_COLS = BlockStorage<Cell>::BLOCK_COLS;
+    snapshot::Writer writer(output, BLOCK_ROWS, BLOCK_COLS);
+    auto add_cell = [&writer](Position pos, const auto& cell) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(cell)>, Cell>) {
+            const FormulaInterface* formula = cell.GetFormula();
+            writer.AddCell(pos, cell.GetText(), formula != nullptr ? GetFormulaAST(*formula) : nullptr,
+                cell.GetCachedValue());
         }
-        output << std::endl;
+        else {
+            //    
+            const auto& ast = cell.GetFormulaAST();
+            writer.AddCell(pos, cell.GetText(), ast,
+                ast ? std::optional(cell.GetNumericValue()) : std::nullopt);
+        }
+    };
+    if (base_) {
+        std::vector<std::pair<Position, const Cell*>> cells;
+        table_.ForEach([&cells](Position pos, const Cell& cell) {
+            cells.emplace_back(pos, &cell);
+        });
+        auto block_order = [](Position lhs, Position rhs) {
+            return std::tuple(lhs.row / BLOCK_ROWS, lhs.col / BLOCK_COLS, lhs.row % BLOCK_ROWS, lhs.col % BLOCK_COLS)
+                < std::tuple(rhs.row / BLOCK_ROWS, rhs.col / BLOCK_COLS, rhs.row % BLOCK_ROWS, rhs.col % BLOCK_COLS);
+        };
+        MergeWithBase(cells, block_order, [this](const auto& g) {
+            base_->ForEach(g);
+        }, add_cell);
+    }
+    else {
+        table_.ForEach([&add_cell](Position pos, const Cell& cell) {
+            if (!cell.IsEmpty()) {
+                add_cell(pos, cell);
+            }
+        });
     }
+    writer.Finish(printable_size_);
 }
 
-std::unique_ptr<SheetInterface> CreateSheet() {
-    return std::make_unique<Sheet>();
+void Sheet::OpenSnapshot(const std::string& path) {
+    snapshot_ = std::make_unique<snapshot::Reader>(path);
+    loaded_blocks_.assign(snapshot_->GetBlockCount(), false);
+    printable_size_ = snapshot_->GetPrintableSize();
 }
 
-namespace {
-    std::ostream& operator<<(std::ostream& output, const CellInterface::Value& value) {
-        if (std::holds_alternative<std::string>(value)) {
-            output << std::get<std::string>(value);
+void Sheet::LoadSnapshotBlocks(Range range) const {
+    auto& sheet = const_cast<Sheet&>(*this);
+    snapshot_->ForEachBlockInRange(range, [&sheet](size_t index) {
+        if (!sheet.loaded_blocks_[index]) {
+            sheet.LoadSnapshotBlock(index);
+            sheet.loaded_blocks_[index] = true;
         }
-        else if (std::holds_alternative<double>(value)) {
-            output << std::get<double>(value);
+    });
+}
+
+void Sheet::LoadSnapshotBlock(size_t index) {
+    //    ,       
+    //  .
+    struct Loaded {
+        Position pos;
+        std::string text;
+        std::unique_ptr<FormulaInterface> formula;
+        std::optional<CellInterface::NumericValue> cache;
+    };
+    std::vector<Loaded> cells;
+    snapshot_->ReadBlock(index, [this, &cells](const snapshot::CellRecord& record) {
+        Loaded cell{ record.pos, std::string(record.text), nullptr, record.cache };
+        if (record.program) {
+            cell.formula = MakeFormula(snapshot_->GetProgram(*record.program), record.pos, cell.text.substr(1));
         }
-        else if (std::holds_alternative<FormulaError>(value)) {
-            output << std::get<FormulaError>(value);
+        cells.push_back(std::move(cell));
+    });
+
+    for (Loaded& loaded : cells) {
+        Cell& cell = table_.GetOrCreate(loaded.pos, *this, graph_, loaded.pos);
+        if (loaded.formula) {
+            cell.LoadFormula(std::move(loaded.formula), loaded.cache);
         }
         else {
-            output << "Unknown Value";
+            cell.LoadText(std::move(loaded.text));
+        }
+    }
+}
+
+void Sheet::FinishSnapshotLoad() {
+    LoadSnapshotBlocks({ { 0, 0 }, { Position::MAX_ROWS - 1, Position::MAX_COLS - 1 } });
+    snapshot_.reset();
+    loaded_blocks_.clear();
+
+    std::vector<Position> loaded;
+    table_.ForEach([&loaded](Position pos, const Cell& /* cell */) {
+        loaded.push_back(pos);
+    });
+    printable_size_ = {};
+    for (Position pos : loaded) {
+        UpdatePrintableSize(pos, true, false);
+    }
+    // ,    ,   ,  
+    //   
+    for (Position pos : loaded) {
+        for (Position referenced : table_.Find(pos)->GetReferencedCells()) {
+            table_.GetOrCreate(referenced, *this, graph_, referenced);
+        }
+    }
+    for (Position pos : loaded) {
+        table_.Find(pos)->AttachLoaded();
+    }
+}
+
+std::shared_ptr<const SheetViewInterface> Sheet::Snapshot() {
+    if (!view_stale_.load(std::memory_order_acquire)) {
+        if (auto view = std::atomic_load(&view_)) {
+            return view;
+        }
+    }
+
+    const WriteLock lock(*this);
+    if (!view_ || view_stale_) {
+        PublishView();
+    }
+    return view_;
+}
+
+std::unique_ptr<SheetInterface> Sheet::Fork() {
+    auto fork = std::make_unique<Sheet>();
+    //    Snapshot():     view_
+    fork->base_ = std::static_pointer_cast<const SheetView>(Snapshot());
+    fork->printable_size_ = fork->base_->GetPrintableSize();
+    //     ,       .
+    fork->graph_.column_caches.Disable();
+    return fork;
+}
+
+std::unique_ptr<const FrozenSheet> Sheet::Freeze() {
+    const WriteLock lock(*this);
+    Recalculate();
+    return std::make_unique<const FrozenSheet>(*this, version_);
+}
+
+void Sheet::MarkViewStale(const std::vector<Position>& edited) {
+    if (version_ == 0 || write_depth_ > 1) {
+        return;
+    }
+    ++version_;
+    if (!view_) {
+        return;
+    }
+
+    stale_edits_.insert(stale_edits_.end(), edited.begin(), edited.end());
+    view_stale_.store(true, std::memory_order_release);
+    LimitStaleChanges();
+}
+
+void Sheet::RememberDirtyCells() {
+    if (!view_) {
+        return;
+    }
+    for (const Cell* cell : graph_.dirty_cells) {
+        stale_formulas_.push_back(cell->GetPosition());
+    }
+    LimitStaleChanges();
+}
+
+void Sheet::LimitStaleChanges() {
+    //     ,    ,  ,
+    //    ,     Snapshot() 
+    // .
+    if (stale_edits_.size() + stale_formulas_.size() > table_.Size()) {
+        std::atomic_store(&view_, std::shared_ptr<const SheetView>());
+        stale_edits_.clear();
+        stale_formulas_.clear();
+    }
+}
+
+void Sheet::PublishView() {
+    if (snapshot_) {
+        FinishSnapshotLoad();
+    }
+    if (version_ == 0) {
+        version_ = 1;
+    }
+    RememberDirtyCells();
+    Cell::Recalculate(graph_.dirty_cells, pool_.get());
+
+    SheetView::Changes changes;
+    if (!view_) {
+        //      
+        table_.ForEach([this, &changes](Position pos, const Cell& cell) {
+            if (!cell.IsEmpty()) {
+                changes.emplace_back(pos, std::make_shared<const SheetView::ViewCell>(cell, cell.GetFormula()));
+            }
+            else if (base_) {
+                changes.emplace_back(pos, nullptr);
+            }
+        });
+        const SheetView empty;
+        std::atomic_store(&view_, std::make_shared<const SheetView>(version_, base_ ? *base_ : empty,
+            printable_size_, std::move(changes)));
+        view_stale_.store(false, std::memory_order_release);
+        return;
+    }
+
+    //  ,   ,   
+    // ;        .
+    changes.reserve(stale_formulas_.size() + stale_edits_.size());
+    for (Position pos : stale_formulas_) {
+        const Cell* cell = table_.Find(pos);
+        const auto* previous = static_cast<const SheetView::ViewCell*>(view_->GetCell(pos));
+        if (cell != nullptr && previous != nullptr) {
+            changes.emplace_back(pos, std::make_shared<const SheetView::ViewCell>(*previous, cell->GetValue()));
         }
-        return output;
     }
+    for (Position pos : stale_edits_) {
+        const Cell* cell = table_.Find(pos);
+        changes.emplace_back(pos, cell != nullptr && !cell->IsEmpty()
+            ? std::make_shared<const SheetView::ViewCell>(*cell, cell->GetFormula()) : nullptr);
+    }
+    std::atomic_store(&view_, std::make_shared<const SheetView>(version_, *view_, printable_size_,
+        std::move(changes)));
+    stale_edits_.clear();
+    stale_formulas_.clear();
+    view_stale_.store(false, std::memory_order_release);
+}
+
+std::unique_ptr<SheetInterface> CreateSheet() {
+    return std::make_unique<Sheet>();
+}
+
+std::unique_ptr<SheetInterface> LoadSnapshot(const std::string& path) {
+    auto sheet = std::make_unique<Sheet>();
+    sheet->OpenSnapshot(path);
+    return sheet;
 }
 
 /*
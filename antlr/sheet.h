@@ -1,16 +1,29 @@
 #pragma once
 
+#include "block_storage.h"
 #include "cell.h"
 #include "common.h"
+#include "sheet_view.h"
+#include "snapshot.h"
+#include "thread_pool.h"
 
-#include <functional>
-#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 class Sheet : public SheetInterface {
 public:
     ~Sheet();
 
     void SetCell(Position pos, std::string text) override;
+    void SetCells(std::vector<std::pair<Position, std::string>> cells) override;
 
     const CellInterface* GetCell(Position pos) const override;
     CellInterface* GetCell(Position pos) override;
@@ -22,19 +35,138 @@ public:
     void PrintValues(std::ostream& output) const override;
     void PrintTexts(std::ostream& output) const override;
 
+    void ForEachCellInRange(Range range,
+        const std::function<void(Position, const CellInterface&)>& f) const override;
+    bool ForEachValueRun(Range range,
+        const std::function<void(Position, const double*, size_t)>& f) const override;
+
+    void Recalculate() override;
+    void SetRecalculationThreads(size_t threads) override;
+
+    void SaveSnapshot(std::ostream& output) const override;
+    // Открывает снимок в пустом листе, см. LoadSnapshot().
+    void OpenSnapshot(const std::string& path);
+
+    std::shared_ptr<const SheetViewInterface> Snapshot() override;
+    std::unique_ptr<SheetInterface> Fork() override;
+    std::unique_ptr<const FrozenSheet> Freeze() override;
+
 private:
-    class Hasher {
-    public:
-        size_t operator() (const Position& pos) const {
-            return hasher_(pos.col) + (hasher_(pos.row) * 37);
-        }
-    private:
-        std::hash<int> hasher_;
-    };
-
-    std::unordered_map<Position, std::unique_ptr<Cell>, Hasher> table_;
-};
+    // Ячейка листа либо nullptr. В копии листа недостающая ячейка основы
+    // копируется в лист, но с графом зависимостей не связывается.
+    Cell* FindOrCopyCell(Position pos);
+    // То же, но отсутствующая ячейка создаётся пустой.
+    Cell& GetOrCreateCell(Position pos);
+    // Готовит копию листа к изменению ячеек edited: копирует их и все
+    // формулы основы, которые от них зависят, и связывает с графом, чтобы
+    // изменение сбросило кеши зависимых формул и нашло циклы.
+    void LinkBaseDependents(const std::vector<Position>& edited);
+
+    void UpdatePrintableSize(Position pos, bool was_empty, bool is_empty);
+
+    // Захватывает лист для изменения, которое не локально, см. IsLocalEdit().
+    class WriteLock;
+
+    // Правка ячейки pos локальна, если она не меняет графа зависимостей: ни
+    // старое, ни новое содержимое не формула, на ячейку не ссылаются ни
+    // формулы, ни диапазоны, её столбец не в кеше, а лист не копия и не
+    // открытый снимок. Такая правка трогает только саму ячейку, её блок
+    // хранилища и общие счётчики, поэтому ждёт лишь правок своей полосы
+    // строк. cell - ячейка pos либо nullptr.
+    bool IsLocalEdit(Position pos, const Cell* cell) const;
+    // Применяют правку под блокировкой полосы, если она локальна, иначе
+    // возвращают false, ничего не меняя.
+    bool TrySetLocalCell(Cell::Edit& edit);
+    bool TryClearLocalCell(Position pos);
+    std::mutex& GetBandMutex(Position pos);
+
+    // Загружает из снимка ячейки блоков, которые пересекаются с диапазоном.
+    // Загрузка не меняет содержимого листа, поэтому вызывается и из
+    // константных методов.
+    void LoadSnapshotBlocks(Range range) const;
+    void LoadSnapshotBlock(size_t index);
+    // Загружает оставшиеся ячейки снимка и связывает все ячейки в граф
+    // зависимостей. После этого лист от файла не зависит.
+    void FinishSnapshotLoad();
 
-namespace {
-    std::ostream& operator<<(std::ostream& output, const CellInterface::Value& value);
-}
\ No newline at end of file
+    // Отмечает, что опубликованное состояние устарело после изменения ячеек
+    // edited, если Snapshot() уже вызывался. Само состояние строится только
+    // при следующем Snapshot(): запись, которую никто не читает, не платит
+    // за пересчёт и копирование блоков.
+    void MarkViewStale(const std::vector<Position>& edited);
+    // Запоминает грязные формулы до их пересчёта: их значения в
+    // опубликованном состоянии устаревают.
+    void RememberDirtyCells();
+    // Сбрасывает состояние, если изменений в нём накопилось больше, чем
+    // ячеек в листе: тогда его дешевле построить заново.
+    void LimitStaleChanges();
+    // Публикует состояние по всему листу либо, если прошлое состояние есть,
+    // заменяет в нём изменённые ячейки и пересчитанные формулы.
+    void PublishView();
+
+    // Обходит только занятые ячейки в порядке строк, пропуски заполняются
+    // табуляциями.
+    template <typename CellPrinter>
+    void PrintCells(std::ostream& output, CellPrinter print_cell) const;
+    // Копия листа: ячейки основы, кроме изменённых, обходятся вместе с
+    // ячейками листа.
+    template <typename CellPrinter>
+    void PrintMergedCells(std::ostream& output, CellPrinter print_cell) const;
+
+    // Объявлено до table_: ячейки удаляют себя из графа при разрушении.
+    DependencyGraph graph_;
+    BlockStorage<Cell> table_;
+
+    // Количество непустых ячеек в каждой строке и столбце.
+    std::vector<int> row_counts_;
+    std::vector<int> col_counts_;
+    Size printable_size_;
+
+    // nullptr, если пересчёт идёт в одном потоке
+    std::unique_ptr<ThreadPool> pool_;
+
+    // Снимок, ячейки которого ещё загружены не все, иначе nullptr. Пока он
+    // открыт, загруженные ячейки не связаны в граф зависимостей: их значения
+    // не меняются, а недостающие вычисляются по требованию.
+    std::unique_ptr<snapshot::Reader> snapshot_;
+    // загружен ли блок с таким номером в каталоге снимка
+    std::vector<bool> loaded_blocks_;
+
+    // Последнее опубликованное состояние либо nullptr, пока Snapshot() не
+    // вызывался или после изменений, которых больше, чем ячеек в листе:
+    // тогда следующее состояние строится заново. Читатели берут его через
+    // std::atomic_load(), если оно не устарело.
+    std::shared_ptr<const SheetView> view_;
+    std::atomic<bool> view_stale_ = false;
+    // номер текущего состояния листа, 0 до первого вызова Snapshot()
+    std::uint64_t version_ = 0;
+    // изменённые ячейки и пересчитанные формулы, которых нет в view_
+    std::vector<Position> stale_edits_;
+    std::vector<Position> stale_formulas_;
+    // Изменения листа не пересекаются друг с другом и с построением
+    // состояния в Snapshot(). Мьютекс рекурсивный: ячейка создаёт пустые
+    // ячейки, на которые ссылается формула, через SetCell().
+    std::recursive_mutex write_mutex_;
+    // глубина вложенных изменений; состояние публикует внешнее из них
+    int write_depth_ = 0;
+    // Локальные правки держат его на чтение, WriteLock - на запись: связи
+    // графа и кеши меняются, только когда локальных правок нет.
+    std::shared_mutex local_edits_mutex_;
+    // Локальные правки одной полосы из BLOCK_ROWS строк идут по очереди.
+    static constexpr size_t BAND_LOCKS = 64;
+    std::array<std::mutex, BAND_LOCKS> band_mutexes_;
+    // Размер листа и список изменений состояния, общие для полос.
+    std::mutex totals_mutex_;
+    // Поток, который держит WriteLock, и число его вложенных захватов.
+    // Вложенная правка этого потока не идёт локальным путём: он ждал бы
+    // сам себя.
+    std::atomic<std::thread::id> writer_;
+    int write_locks_ = 0;
+
+    // Состояние, от которого создана копия листа, либо nullptr. Ячейка,
+    // которой нет в table_, берётся из основы; пустая ячейка в table_
+    // закрывает ячейку основы. Кеши столбцов в копии не ведутся.
+    std::shared_ptr<const SheetView> base_;
+    // Ячейки, формулы основы, зависящие от которых, уже связаны с графом.
+    std::unordered_set<std::uint32_t> linked_;
+};
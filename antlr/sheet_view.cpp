@@ -0,0 +1,213 @@
+#include "sheet_view.h"
+
+#include "formula.h"
+#include "output_buffer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <utility>
+
+SheetView::ViewCell::ViewCell(const CellInterface& cell, const FormulaInterface* formula)
+    : text_(cell.GetText())
+    , value_(cell.GetValue())
+    , referenced_cells_(cell.GetReferencedCells()) {
+    if (formula != nullptr) {
+        referenced_ranges_ = formula->GetReferencedRanges();
+        ast_ = ::GetFormulaAST(*formula);
+    }
+}
+
+SheetView::ViewCell::ViewCell(const ViewCell& previous, Value value)
+    : text_(previous.text_)
+    , value_(std::move(value))
+    , referenced_cells_(previous.referenced_cells_)
+    , referenced_ranges_(previous.referenced_ranges_)
+    , ast_(previous.ast_) {
+}
+
+CellInterface::Value SheetView::ViewCell::GetValue() const {
+    return value_;
+}
+
+std::string SheetView::ViewCell::GetText() const {
+    return text_;
+}
+
+std::vector<Position> SheetView::ViewCell::GetReferencedCells() const {
+    return referenced_cells_;
+}
+
+const std::vector<Range>& SheetView::ViewCell::GetReferencedRanges() const {
+    return referenced_ranges_;
+}
+
+const std::shared_ptr<const FormulaAST>& SheetView::ViewCell::GetFormulaAST() const {
+    return ast_;
+}
+
+SheetView::SheetView(std::uint64_t version, const SheetView& previous, Size printable_size, Changes changes)
+    : version_(version)
+    , printable_size_(printable_size)
+    , root_(previous.root_) {
+    if (changes.empty()) {
+        return;
+    }
+    // порядок обхода дерева; замены одной ячейки остаются в исходном порядке
+    std::stable_sort(changes.begin(), changes.end(), [](const auto& lhs, const auto& rhs) {
+        const Position a = lhs.first;
+        const Position b = rhs.first;
+        return std::tuple(a.row / BLOCK_ROWS, a.col / BLOCK_COLS, a.row % BLOCK_ROWS, a.col % BLOCK_COLS)
+            < std::tuple(b.row / BLOCK_ROWS, b.col / BLOCK_COLS, b.row % BLOCK_ROWS, b.col % BLOCK_COLS);
+    });
+    root_ = Update<0>(root_, changes.cbegin(), changes.cend());
+}
+
+int SheetView::GetChildIndex(Position pos, int level) {
+    switch (level) {
+    case 0:
+        return pos.row / BLOCK_ROWS / FANOUT;
+    case 1:
+        return pos.row / BLOCK_ROWS % FANOUT;
+    case 2:
+        return pos.col / BLOCK_COLS / FANOUT;
+    case 3:
+        return pos.col / BLOCK_COLS % FANOUT;
+    default:
+        return pos.row % BLOCK_ROWS * BLOCK_COLS + pos.col % BLOCK_COLS;
+    }
+}
+
+template <int Level, typename NodeType>
+std::shared_ptr<const NodeType> SheetView::Update(const std::shared_ptr<const NodeType>& node,
+    Changes::const_iterator begin, Changes::const_iterator end) {
+    auto copy = node ? std::make_shared<NodeType>(*node) : std::make_shared<NodeType>();
+    while (begin != end) {
+        const int index = GetChildIndex(begin->first, Level);
+        const auto group_end = std::find_if(begin, end, [index](const auto& change) {
+            return GetChildIndex(change.first, Level) != index;
+        });
+        if constexpr (Level == LEVELS - 1) {
+            copy->children[index] = std::prev(group_end)->second;
+        }
+        else {
+            copy->children[index] = Update<Level + 1>(copy->children[index], begin, group_end);
+        }
+        begin = group_end;
+    }
+
+    for (const auto& child : copy->children) {
+        if (child) {
+            return copy;
+        }
+    }
+    return nullptr;
+}
+
+std::uint64_t SheetView::GetVersion() const {
+    return version_;
+}
+
+const SheetView::BlockRow* SheetView::FindBlockRow(int row) const {
+    const Position pos{ row, 0 };
+    if (!root_) {
+        return nullptr;
+    }
+    const BlockRowGroup* group = root_->children[GetChildIndex(pos, 0)].get();
+    return group != nullptr ? group->children[GetChildIndex(pos, 1)].get() : nullptr;
+}
+
+const CellInterface* SheetView::GetCell(Position pos) const {
+    if (!pos.IsValid()) {
+        throw InvalidPositionException("Get Cell: out of range");
+    }
+    const BlockRow* block_row = FindBlockRow(pos.row);
+    if (block_row == nullptr) {
+        return nullptr;
+    }
+    const BlockLine* line = block_row->children[GetChildIndex(pos, 2)].get();
+    if (line == nullptr) {
+        return nullptr;
+    }
+    const Block* block = line->children[GetChildIndex(pos, 3)].get();
+    return block != nullptr ? block->children[GetChildIndex(pos, 4)].get() : nullptr;
+}
+
+Size SheetView::GetPrintableSize() const {
+    return printable_size_;
+}
+
+const std::vector<int>& SheetView::GetRowCounts() const {
+    return GetIndex().row_counts;
+}
+
+const std::vector<int>& SheetView::GetColCounts() const {
+    return GetIndex().col_counts;
+}
+
+const SheetView::Index& SheetView::GetIndex() const {
+    std::call_once(index_once_, [this] {
+        auto index = std::make_unique<Index>();
+        index->row_counts.resize(printable_size_.rows);
+        index->col_counts.resize(printable_size_.cols);
+        ForEach([&index](Position pos, const ViewCell& cell) {
+            ++index->row_counts[pos.row];
+            ++index->col_counts[pos.col];
+            for (Position referenced : cell.referenced_cells_) {
+                index->cell_dependents[GetCellKey(referenced)].push_back(pos);
+            }
+            for (const Range& range : cell.referenced_ranges_) {
+                index->range_dependents.Insert(range, pos);
+            }
+        });
+        index_ = std::move(index);
+    });
+    return *index_;
+}
+
+void SheetView::PrintValues(std::ostream& output) const {
+    PrintCells(output, [](OutputBuffer& buffer, const ViewCell& cell) {
+        buffer.WriteValue(cell.GetValue());
+    });
+}
+
+void SheetView::PrintTexts(std::ostream& output) const {
+    PrintCells(output, [](OutputBuffer& buffer, const ViewCell& cell) {
+        buffer.Write(cell.GetText());
+    });
+}
+
+template <typename CellPrinter>
+void SheetView::PrintCells(std::ostream& output, CellPrinter print_cell) const {
+    const Size range = printable_size_;
+    OutputBuffer buffer(output);
+    for (int row = 0; row < range.rows; ++row) {
+        int tabs = 0;
+        if (const BlockRow* block_row = FindBlockRow(row)) {
+            const int shift = (row % BLOCK_ROWS) * BLOCK_COLS;
+            for (int line_index = 0; line_index < FANOUT; ++line_index) {
+                const BlockLine* line = block_row->children[line_index].get();
+                if (line == nullptr) {
+                    continue;
+                }
+                for (int block_index = 0; block_index < FANOUT; ++block_index) {
+                    const Block* block = line->children[block_index].get();
+                    if (block == nullptr) {
+                        continue;
+                    }
+                    const int first_col = (line_index * FANOUT + block_index) * BLOCK_COLS;
+                    for (int col = 0; col < BLOCK_COLS && first_col + col < range.cols; ++col) {
+                        if (const ViewCell* cell = block->children[shift + col].get()) {
+                            buffer.Put('\t', first_col + col - tabs);
+                            tabs = first_col + col;
+                            print_cell(buffer, *cell);
+                        }
+                    }
+                }
+            }
+        }
+        buffer.Put('\t', range.cols - 1 - tabs);
+        buffer.Put('\n');
+    }
+    buffer.Flush();
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "common.h"
+#include "range_index.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class FormulaAST;
+class FormulaInterface;
+
+// Состояние листа, которое Sheet публикует после изменения, см.
+// SheetInterface::Snapshot(). Ячейки лежат в дереве из узлов по 64 потомка:
+// две ступени по строкам блоков 8x8, две по столбцам блоков и сам блок.
+// Новое состояние копирует только узлы на пути к изменённым ячейкам, прочие
+// поддеревья и ячейки общие с предыдущим состоянием. Узел освобождается,
+// когда на него не ссылается ни одно живое состояние.
+class SheetView : public SheetViewInterface {
+public:
+    // Ячейка состояния: текст, значение, ссылки и выражение формулы на момент
+    // публикации. Выражение общее с ячейкой листа.
+    class ViewCell : public CellInterface {
+    public:
+        // formula - формула ячейки cell либо nullptr.
+        ViewCell(const CellInterface& cell, const FormulaInterface* formula);
+        // Та же ячейка с новым значением: текст и ссылки не меняются, когда
+        // формула лишь пересчитана.
+        ViewCell(const ViewCell& previous, Value value);
+
+        Value GetValue() const override;
+        std::string GetText() const override;
+        std::vector<Position> GetReferencedCells() const override;
+        const std::vector<Range>& GetReferencedRanges() const;
+        // Выражение формулы либо nullptr, если ячейка не формула.
+        const std::shared_ptr<const FormulaAST>& GetFormulaAST() const;
+
+    private:
+        friend class SheetView;
+
+        std::string text_;
+        Value value_;
+        std::vector<Position> referenced_cells_;
+        std::vector<Range> referenced_ranges_;
+        std::shared_ptr<const FormulaAST> ast_;
+    };
+
+    using Changes = std::vector<std::pair<Position, std::shared_ptr<const ViewCell>>>;
+
+    // Пустое состояние с номером 0.
+    SheetView() = default;
+    // Состояние с номером version: ячейки changes (nullptr - пустая ячейка)
+    // заменены, остальные общие с previous. Из замен одной ячейки действует
+    // последняя.
+    SheetView(std::uint64_t version, const SheetView& previous, Size printable_size, Changes changes);
+
+    std::uint64_t GetVersion() const override;
+    const CellInterface* GetCell(Position pos) const override;
+    Size GetPrintableSize() const override;
+    void PrintValues(std::ostream& output) const override;
+    void PrintTexts(std::ostream& output) const override;
+
+    // Вызывает f(Position, const ViewCell&) для ячеек диапазона по строкам.
+    template <typename F>
+    void ForEachInRange(Range range, F&& f) const;
+    // Вызывает f(Position, const ViewCell&) для всех ячеек по блокам: блоки
+    // по строкам блоков, в строке - по столбцам, ячейки блока по строкам.
+    template <typename F>
+    void ForEach(F&& f) const;
+
+    // Вызывает f(Position) для формул состояния, которые ссылаются на ячейку
+    // pos напрямую или через диапазон. Формула может встретиться несколько
+    // раз. Первый вызов строит обратные ссылки по всему состоянию.
+    template <typename F>
+    void ForEachDependent(Position pos, F&& f) const {
+        const Index& index = GetIndex();
+        if (auto it = index.cell_dependents.find(GetCellKey(pos)); it != index.cell_dependents.end()) {
+            for (Position dependent : it->second) {
+                f(dependent);
+            }
+        }
+        index.range_dependents.ForEachContaining(pos, f);
+    }
+
+    // Номер ячейки листа по строкам.
+    static std::uint32_t GetCellKey(Position pos) {
+        return static_cast<std::uint32_t>(pos.row) * Position::MAX_COLS + pos.col;
+    }
+
+    // Количество непустых ячеек в каждой строке и столбце печатной области.
+    const std::vector<int>& GetRowCounts() const;
+    const std::vector<int>& GetColCounts() const;
+
+private:
+    static constexpr int FANOUT = 64;
+    static constexpr int BLOCK_ROWS = 8;
+    static constexpr int BLOCK_COLS = 8;
+    // число ступеней дерева, включая блок
+    static constexpr int LEVELS = 5;
+
+    template <typename Child>
+    struct Node {
+        using ChildType = Child;
+        std::array<std::shared_ptr<const Child>, FANOUT> children;
+    };
+
+    using Block = Node<ViewCell>;
+    using BlockLine = Node<Block>;
+    using BlockRow = Node<BlockLine>;
+    using BlockRowGroup = Node<BlockRow>;
+    using Root = Node<BlockRowGroup>;
+
+    static_assert(Position::MAX_ROWS <= BLOCK_ROWS * FANOUT * FANOUT, "block rows must fit into two levels");
+    static_assert(Position::MAX_COLS <= BLOCK_COLS * FANOUT * FANOUT, "block columns must fit into two levels");
+    static_assert(BLOCK_ROWS * BLOCK_COLS == FANOUT, "a block must be a single node");
+
+    // номер потомка на ступени level (0 - корень) на пути к ячейке pos
+    static int GetChildIndex(Position pos, int level);
+
+    // Копия узла node с заменами [begin, end), отсортированными по пути в
+    // дереве. Пустой узел не хранится.
+    template <int Level, typename NodeType>
+    static std::shared_ptr<const NodeType> Update(const std::shared_ptr<const NodeType>& node,
+        Changes::const_iterator begin, Changes::const_iterator end);
+
+    const BlockRow* FindBlockRow(int row) const;
+
+    template <typename CellPrinter>
+    void PrintCells(std::ostream& output, CellPrinter print_cell) const;
+
+    // Обратные ссылки и счётчики ячеек, которые нужны листам, разветвлённым
+    // от состояния. Строятся один раз при первом обращении.
+    struct Index {
+        std::unordered_map<std::uint32_t, std::vector<Position>> cell_dependents;
+        RangeIndex<Position> range_dependents;
+        std::vector<int> row_counts;
+        std::vector<int> col_counts;
+    };
+
+    const Index& GetIndex() const;
+
+    std::uint64_t version_ = 0;
+    Size printable_size_;
+    std::shared_ptr<const Root> root_;
+
+    mutable std::once_flag index_once_;
+    mutable std::unique_ptr<const Index> index_;
+};
+
+template <typename F>
+void SheetView::ForEachInRange(Range range, F&& f) const {
+    if (!root_) {
+        return;
+    }
+    const int last_row = std::min(range.to.row, printable_size_.rows - 1);
+    const int last_col = std::min(range.to.col, printable_size_.cols - 1);
+    for (int row = range.from.row; row <= last_row; ++row) {
+        const BlockRow* block_row = FindBlockRow(row);
+        if (block_row == nullptr) {
+            // пуста вся строка блоков
+            row = (row / BLOCK_ROWS + 1) * BLOCK_ROWS - 1;
+            continue;
+        }
+        const int shift = (row % BLOCK_ROWS) * BLOCK_COLS;
+        for (int block_col = range.from.col / BLOCK_COLS; block_col <= last_col / BLOCK_COLS; ++block_col) {
+            const BlockLine* line = block_row->children[block_col / FANOUT].get();
+            if (line == nullptr) {
+                block_col = (block_col / FANOUT + 1) * FANOUT - 1;
+                continue;
+            }
+            const Block* block = line->children[block_col % FANOUT].get();
+            if (block == nullptr) {
+                continue;
+            }
+            const int first = std::max(range.from.col, block_col * BLOCK_COLS);
+            const int last = std::min(last_col, block_col * BLOCK_COLS + BLOCK_COLS - 1);
+            for (int col = first; col <= last; ++col) {
+                if (const ViewCell* cell = block->children[shift + col % BLOCK_COLS].get()) {
+                    f(Position{ row, col }, *cell);
+                }
+            }
+        }
+    }
+}
+
+template <typename F>
+void SheetView::ForEach(F&& f) const {
+    if (!root_) {
+        return;
+    }
+    for (int group_index = 0; group_index < FANOUT; ++group_index) {
+        const BlockRowGroup* group = root_->children[group_index].get();
+        for (int row_index = 0; group != nullptr && row_index < FANOUT; ++row_index) {
+            const BlockRow* block_row = group->children[row_index].get();
+            for (int line_index = 0; block_row != nullptr && line_index < FANOUT; ++line_index) {
+                const BlockLine* line = block_row->children[line_index].get();
+                for (int block_index = 0; line != nullptr && block_index < FANOUT; ++block_index) {
+                    const Block* block = line->children[block_index].get();
+                    if (block == nullptr) {
+                        continue;
+                    }
+                    const Position origin{ (group_index * FANOUT + row_index) * BLOCK_ROWS,
+                        (line_index * FANOUT + block_index) * BLOCK_COLS };
+                    for (int i = 0; i < FANOUT; ++i) {
+                        if (const ViewCell* cell = block->children[i].get()) {
+                            f(Position{ origin.row + i / BLOCK_COLS, origin.col + i % BLOCK_COLS }, *cell);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
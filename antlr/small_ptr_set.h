@@ -0,0 +1,279 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+// Множество указателей для рёбер графа зависимостей.
+// Представление зависит от числа элементов:
+// * до INLINE_CAPACITY элементов хранятся внутри объекта, без выделения памяти;
+// * до LINEAR_CAPACITY — в массиве в куче, поиск линейный;
+// * дальше — в хеш-таблице с открытой адресацией, для ячеек, на которые
+//   ссылаются сотни тысяч формул.
+// Порядок обхода не определён, begin() и end() нужны для range-for. Вставка
+// и удаление делают итераторы недействительными.
+template <typename T>
+class SmallPtrSet {
+public:
+    static constexpr uint32_t INLINE_CAPACITY = 2;
+    static constexpr uint32_t LINEAR_CAPACITY = 32;
+
+    class Iterator {
+    public:
+        Iterator(T* const* current, T* const* end)
+            : current_(current)
+            , end_(end) {
+            SkipFree();
+        }
+
+        T* operator*() const {
+            return *current_;
+        }
+
+        Iterator& operator++() {
+            ++current_;
+            SkipFree();
+            return *this;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return current_ != other.current_;
+        }
+
+    private:
+        void SkipFree() {
+            while (current_ != end_ && IsFree(*current_)) {
+                ++current_;
+            }
+        }
+
+        T* const* current_;
+        T* const* end_;
+    };
+
+    SmallPtrSet() = default;
+    SmallPtrSet(const SmallPtrSet&) = delete;
+    SmallPtrSet& operator=(const SmallPtrSet&) = delete;
+
+    ~SmallPtrSet() {
+        Free();
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    Iterator begin() const {
+        return Iterator(Slots(), Slots() + UsedSlots());
+    }
+
+    Iterator end() const {
+        return Iterator(Slots() + UsedSlots(), Slots() + UsedSlots());
+    }
+
+    bool Contains(T* item) const {
+        if (IsHashed()) {
+            return Slots()[FindSlot(item)] == item;
+        }
+        return FindLinear(item) != size_;
+    }
+
+    // Возвращает false, если элемент уже был в множестве.
+    bool Insert(T* item) {
+        assert(!IsFree(item));
+        if (IsHashed()) {
+            return InsertHashed(item);
+        }
+        if (FindLinear(item) != size_) {
+            return false;
+        }
+
+        if (size_ == capacity_) {
+            Grow();
+            if (IsHashed()) {
+                return InsertHashed(item);
+            }
+        }
+        Slots()[size_++] = item;
+        return true;
+    }
+
+    // Возвращает false, если элемента не было.
+    bool Erase(T* item) {
+        T** slots = Slots();
+        if (IsHashed()) {
+            size_t slot = FindSlot(item);
+            if (slots[slot] != item) {
+                return false;
+            }
+            slots[slot] = Tombstone();
+            --size_;
+            return true;
+        }
+
+        size_t index = FindLinear(item);
+        if (index == size_) {
+            return false;
+        }
+        slots[index] = slots[--size_];
+        return true;
+    }
+
+    void Clear() {
+        Free();
+        size_ = 0;
+        capacity_ = INLINE_CAPACITY;
+        used_ = 0;
+    }
+
+    // Объём памяти в куче, занятый множеством.
+    size_t HeapBytes() const {
+        return capacity_ > INLINE_CAPACITY ? capacity_ * sizeof(T*) : 0;
+    }
+
+private:
+    static T* Tombstone() {
+        return reinterpret_cast<T*>(std::uintptr_t{ 1 });
+    }
+
+    static bool IsFree(T* item) {
+        return item == nullptr || item == Tombstone();
+    }
+
+    bool IsHashed() const {
+        return capacity_ > LINEAR_CAPACITY;
+    }
+
+    T** Slots() {
+        return capacity_ > INLINE_CAPACITY ? heap_ : inline_;
+    }
+
+    T* const* Slots() const {
+        return capacity_ > INLINE_CAPACITY ? heap_ : inline_;
+    }
+
+    // в хеш-таблице обходятся все ячейки, в массиве - только занятые
+    size_t UsedSlots() const {
+        return IsHashed() ? capacity_ : size_;
+    }
+
+    size_t FindLinear(T* item) const {
+        T* const* slots = Slots();
+        for (size_t index = 0; index < size_; ++index) {
+            if (slots[index] == item) {
+                return index;
+            }
+        }
+        return size_;
+    }
+
+    static size_t Hash(T* item, uint32_t capacity) {
+        // мультипликативное хеширование, capacity - степень двойки
+        auto bits = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(item));
+        return static_cast<size_t>((bits * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+    }
+
+    // Ячейка с item либо первая ячейка, куда его можно вставить.
+    size_t FindSlot(T* item) const {
+        T* const* slots = Slots();
+        size_t slot = Hash(item, capacity_);
+        size_t first_tombstone = capacity_;
+        while (slots[slot] != nullptr) {
+            if (slots[slot] == item) {
+                return slot;
+            }
+            if (slots[slot] == Tombstone() && first_tombstone == capacity_) {
+                first_tombstone = slot;
+            }
+            slot = (slot + 1) & (capacity_ - 1);
+        }
+        return first_tombstone != capacity_ ? first_tombstone : slot;
+    }
+
+    bool InsertHashed(T* item) {
+        size_t slot = FindSlot(item);
+        T** slots = Slots();
+        if (slots[slot] == item) {
+            return false;
+        }
+        if (slots[slot] == nullptr) {
+            // занятые и удалённые ячейки - не больше 3/4 таблицы
+            if ((used_ + 1) * 4 > capacity_ * 3) {
+                Rehash(HashCapacity(size_ + 1));
+                return InsertHashed(item);
+            }
+            ++used_;
+        }
+        slots[slot] = item;
+        ++size_;
+        return true;
+    }
+
+    void Grow() {
+        if (capacity_ < LINEAR_CAPACITY) {
+            T** heap = new T*[capacity_ * 2];
+            std::memcpy(heap, Slots(), size_ * sizeof(T*));
+            Free();
+            heap_ = heap;
+            capacity_ *= 2;
+        }
+        else {
+            Rehash(HashCapacity(size_ + 1));
+        }
+    }
+
+    // после перестройки таблица заполнена не больше чем наполовину
+    static uint32_t HashCapacity(size_t items) {
+        uint32_t capacity = LINEAR_CAPACITY * 4;
+        while (capacity < items * 2) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void Rehash(uint32_t capacity) {
+        T** old_slots = Slots();
+        const size_t old_used = UsedSlots();
+        const bool old_heap = capacity_ > INLINE_CAPACITY;
+
+        T** slots = new T*[capacity]();
+        for (size_t index = 0; index < old_used; ++index) {
+            T* item = old_slots[index];
+            if (!IsFree(item)) {
+                size_t slot = Hash(item, capacity);
+                while (slots[slot] != nullptr) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                slots[slot] = item;
+            }
+        }
+
+        if (old_heap) {
+            delete[] old_slots;
+        }
+        heap_ = slots;
+        capacity_ = capacity;
+        used_ = size_;
+    }
+
+    void Free() {
+        if (capacity_ > INLINE_CAPACITY) {
+            delete[] heap_;
+        }
+    }
+
+    union {
+        T* inline_[INLINE_CAPACITY] = {};
+        T** heap_;
+    };
+    uint32_t size_ = 0;
+    uint32_t capacity_ = INLINE_CAPACITY;
+    // занятые и удалённые ячейки хеш-таблицы
+    uint32_t used_ = 0;
+};
@@ -0,0 +1,428 @@
+#include "snapshot.h"
+
+#include "FormulaAST.h"
+#include "formula.h"
+
+#include <cstring>
+#include <forward_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace snapshot {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'M', 'Y', 'T', 'A', 'B', 'L', 'E', 'S' };
+// записывается как число: при другом порядке байт читается иначе
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// заголовок: MAGIC, VERSION, BYTE_ORDER_MARK
+constexpr std::uint64_t HEADER_SIZE = sizeof(MAGIC) + 2 * sizeof(std::uint32_t);
+// концевик: размер листа, размер блока, конец ячеек, каталог выражений
+// (число и смещение), каталог блоков (число и смещение), MAGIC
+constexpr std::uint64_t FOOTER_SIZE = 4 * sizeof(std::int32_t) + 5 * sizeof(std::uint64_t) + sizeof(MAGIC);
+// запись каталога блоков: строка и столбец блока, смещение его ячеек
+constexpr std::uint64_t BLOCK_ENTRY_SIZE = 2 * sizeof(std::int32_t) + sizeof(std::uint64_t);
+
+// записи накапливаются и передаются потоку порциями
+constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+// флаги записи ячейки
+constexpr std::uint8_t CELL_FORMULA = 1;
+constexpr std::uint8_t CELL_NUMBER = 2;
+constexpr std::uint8_t CELL_ERROR = 4;
+
+[[noreturn]] void ThrowInvalid(const std::string& what) {
+    throw std::runtime_error("Invalid snapshot: " + what);
+}
+
+// Читает значение из data по смещению offset, не выходя за end, и сдвигает
+// offset за него.
+template <typename T>
+T Get(std::string_view data, std::uint64_t& offset, std::uint64_t end) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (end > data.size() || offset > end || end - offset < sizeof(T)) {
+        ThrowInvalid("unexpected end of data");
+    }
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+Position GetPosition(std::string_view data, std::uint64_t& offset, std::uint64_t end) {
+    Position pos;
+    pos.row = Get<std::int32_t>(data, offset, end);
+    pos.col = Get<std::int32_t>(data, offset, end);
+    return pos;
+}
+
+Range GetRange(std::string_view data, std::uint64_t& offset, std::uint64_t end) {
+    Range range;
+    range.from = GetPosition(data, offset, end);
+    range.to = GetPosition(data, offset, end);
+    return range;
+}
+
+}  // namespace
+
+Writer::Writer(std::ostream& output, int block_rows, int block_cols)
+    : output_(output)
+    , block_rows_(block_rows)
+    , block_cols_(block_cols) {
+    Put(MAGIC);
+    Put(VERSION);
+    Put(BYTE_ORDER_MARK);
+}
+
+template <typename T>
+void Writer::Put(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    PutBytes(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void Writer::PutBytes(const char* data, size_t size) {
+    buffer_.append(data, size);
+    offset_ += size;
+    if (buffer_.size() >= BUFFER_SIZE) {
+        output_.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+}
+
+void Writer::PutPosition(Position pos) {
+    Put(static_cast<std::int32_t>(pos.row));
+    Put(static_cast<std::int32_t>(pos.col));
+}
+
+void Writer::PutRange(const Range& range) {
+    PutPosition(range.from);
+    PutPosition(range.to);
+}
+
+void Writer::AddCell(Position pos, const std::string& text, std::shared_ptr<const FormulaAST> program,
+    std::optional<CellInterface::NumericValue> cache) {
+    std::uint8_t flags = 0;
+    std::uint8_t category = 0;
+    if (program) {
+        flags |= CELL_FORMULA;
+    }
+    if (cache) {
+        if (const FormulaError* error = std::get_if<FormulaError>(&*cache)) {
+            flags |= CELL_ERROR;
+            category = static_cast<std::uint8_t>(error->GetCategory());
+        }
+        else {
+            flags |= CELL_NUMBER;
+        }
+    }
+
+    const int block_row = pos.row / block_rows_;
+    const int block_col = pos.col / block_cols_;
+    if (blocks_.empty() || blocks_.back().block_row != block_row || blocks_.back().block_col != block_col) {
+        blocks_.push_back({ block_row, block_col, offset_ });
+    }
+    const BlockEntry& block = blocks_.back();
+    Put(static_cast<std::uint8_t>(pos.row - block.block_row * block_rows_));
+    Put(static_cast<std::uint8_t>(pos.col - block.block_col * block_cols_));
+    Put(flags);
+    Put(category);
+    Put(static_cast<std::uint32_t>(text.size()));
+    if (program) {
+        Put(GetProgramIndex(std::move(program)));
+    }
+    if (flags & CELL_NUMBER) {
+        Put(std::get<double>(*cache));
+    }
+    PutBytes(text.data(), text.size());
+}
+
+std::uint32_t Writer::GetProgramIndex(std::shared_ptr<const FormulaAST> program) {
+    auto [it, inserted] = program_indices_.emplace(program.get(), static_cast<std::uint32_t>(programs_.size()));
+    if (inserted) {
+        programs_.push_back(std::move(program));
+    }
+    return it->second;
+}
+
+void Writer::Finish(Size printable_size) {
+    const std::uint64_t cells_end = offset_;
+
+    std::vector<std::uint64_t> program_offsets;
+    program_offsets.reserve(programs_.size());
+    for (const auto& ast : programs_) {
+        program_offsets.push_back(offset_);
+        const ASTImpl::Program& program = ast->GetProgram();
+        const auto& cells = ast->GetCells();
+        const auto& ranges = ast->GetRanges();
+        Put(static_cast<std::uint32_t>(program.code.size()));
+        Put(static_cast<std::uint32_t>(program.numbers.size()));
+        Put(static_cast<std::uint32_t>(program.cells.size()));
+        Put(static_cast<std::uint32_t>(program.ranges.size()));
+        Put(static_cast<std::uint32_t>(std::distance(cells.begin(), cells.end())));
+        Put(static_cast<std::uint32_t>(std::distance(ranges.begin(), ranges.end())));
+        for (const ASTImpl::Instruction& instruction : program.code) {
+            Put(static_cast<std::uint8_t>(instruction.op));
+            Put(static_cast<std::uint8_t>(instruction.function));
+            Put(instruction.arg);
+        }
+        for (double number : program.numbers) {
+            Put(number);
+        }
+        for (Position pos : program.cells) {
+            PutPosition(pos);
+        }
+        for (const Range& range : program.ranges) {
+            PutRange(range);
+        }
+        for (Position pos : cells) {
+            PutPosition(pos);
+        }
+        for (const Range& range : ranges) {
+            PutRange(range);
+        }
+    }
+
+    const std::uint64_t programs_offset = offset_;
+    for (std::uint64_t offset : program_offsets) {
+        Put(offset);
+    }
+    const std::uint64_t blocks_offset = offset_;
+    for (const BlockEntry& block : blocks_) {
+        Put(static_cast<std::int32_t>(block.block_row));
+        Put(static_cast<std::int32_t>(block.block_col));
+        Put(block.begin);
+    }
+
+    Put(static_cast<std::int32_t>(printable_size.rows));
+    Put(static_cast<std::int32_t>(printable_size.cols));
+    Put(static_cast<std::int32_t>(block_rows_));
+    Put(static_cast<std::int32_t>(block_cols_));
+    Put(cells_end);
+    Put(static_cast<std::uint64_t>(programs_.size()));
+    Put(programs_offset);
+    Put(static_cast<std::uint64_t>(blocks_.size()));
+    Put(blocks_offset);
+    Put(MAGIC);
+    output_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+    output_.flush();
+    if (!output_) {
+        throw std::runtime_error("Cannot write snapshot");
+    }
+}
+
+Reader::Reader(const std::string& path)
+    : file_(path)
+    , data_(file_.GetText()) {
+    const std::uint64_t size = data_.size();
+    if (size < HEADER_SIZE + FOOTER_SIZE || std::memcmp(data_.data(), MAGIC, sizeof(MAGIC)) != 0
+        || std::memcmp(data_.data() + size - sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0) {
+        ThrowInvalid("not a sheet snapshot");
+    }
+    std::uint64_t offset = sizeof(MAGIC);
+    if (Get<std::uint32_t>(data_, offset, HEADER_SIZE) != VERSION) {
+        ThrowInvalid("unsupported version");
+    }
+    if (Get<std::uint32_t>(data_, offset, HEADER_SIZE) != BYTE_ORDER_MARK) {
+        ThrowInvalid("different byte order");
+    }
+
+    offset = size - FOOTER_SIZE;
+    printable_size_.rows = Get<std::int32_t>(data_, offset, size);
+    printable_size_.cols = Get<std::int32_t>(data_, offset, size);
+    block_rows_ = Get<std::int32_t>(data_, offset, size);
+    block_cols_ = Get<std::int32_t>(data_, offset, size);
+    cells_end_ = Get<std::uint64_t>(data_, offset, size);
+    const std::uint64_t program_count = Get<std::uint64_t>(data_, offset, size);
+    programs_offset_ = Get<std::uint64_t>(data_, offset, size);
+    const std::uint64_t block_count = Get<std::uint64_t>(data_, offset, size);
+    blocks_offset_ = Get<std::uint64_t>(data_, offset, size);
+
+    // разделы идут друг за другом: ячейки, выражения, каталоги, концевик
+    const std::uint64_t footer = size - FOOTER_SIZE;
+    const bool valid = printable_size_.rows >= 0 && printable_size_.rows <= Position::MAX_ROWS
+        && printable_size_.cols >= 0 && printable_size_.cols <= Position::MAX_COLS
+        && block_rows_ > 0 && block_rows_ <= UINT8_MAX + 1 && block_cols_ > 0 && block_cols_ <= UINT8_MAX + 1
+        && cells_end_ >= HEADER_SIZE && programs_offset_ >= cells_end_ && blocks_offset_ >= programs_offset_
+        && footer >= blocks_offset_ && (blocks_offset_ - programs_offset_) / sizeof(std::uint64_t) == program_count
+        && (blocks_offset_ - programs_offset_) % sizeof(std::uint64_t) == 0
+        && (footer - blocks_offset_) / BLOCK_ENTRY_SIZE == block_count
+        && (footer - blocks_offset_) % BLOCK_ENTRY_SIZE == 0;
+    if (!valid) {
+        ThrowInvalid("malformed footer");
+    }
+    block_count_ = static_cast<size_t>(block_count);
+    programs_.resize(static_cast<size_t>(program_count));
+
+    // блоки упорядочены, их ячейки лежат внутри раздела ячеек
+    const int max_block_row = (Position::MAX_ROWS - 1) / block_rows_;
+    const int max_block_col = (Position::MAX_COLS - 1) / block_cols_;
+    for (size_t index = 0; index < block_count_; ++index) {
+        const BlockKey key = GetBlockKey(index);
+        if (key.block_row < 0 || key.block_row > max_block_row || key.block_col < 0 || key.block_col > max_block_col
+            || GetBlockBegin(index) < HEADER_SIZE || GetBlockBegin(index) > GetBlockEnd(index)) {
+            ThrowInvalid("malformed block directory");
+        }
+        if (index > 0) {
+            const BlockKey prev = GetBlockKey(index - 1);
+            if (std::make_pair(prev.block_row, prev.block_col) >= std::make_pair(key.block_row, key.block_col)) {
+                ThrowInvalid("malformed block directory");
+            }
+        }
+    }
+}
+
+Reader::BlockKey Reader::GetBlockKey(size_t index) const {
+    std::uint64_t offset = blocks_offset_ + index * BLOCK_ENTRY_SIZE;
+    BlockKey key;
+    key.block_row = Get<std::int32_t>(data_, offset, data_.size());
+    key.block_col = Get<std::int32_t>(data_, offset, data_.size());
+    return key;
+}
+
+std::uint64_t Reader::GetBlockBegin(size_t index) const {
+    std::uint64_t offset = blocks_offset_ + index * BLOCK_ENTRY_SIZE + 2 * sizeof(std::int32_t);
+    return Get<std::uint64_t>(data_, offset, data_.size());
+}
+
+std::uint64_t Reader::GetBlockEnd(size_t index) const {
+    return index + 1 < block_count_ ? GetBlockBegin(index + 1) : cells_end_;
+}
+
+size_t Reader::LowerBound(int block_row, int block_col) const {
+    size_t first = 0;
+    size_t count = block_count_;
+    while (count > 0) {
+        const size_t step = count / 2;
+        const BlockKey key = GetBlockKey(first + step);
+        if (std::make_pair(key.block_row, key.block_col) < std::make_pair(block_row, block_col)) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+size_t Reader::FindBlock(Position pos) const {
+    const int block_row = pos.row / block_rows_;
+    const int block_col = pos.col / block_cols_;
+    const size_t index = LowerBound(block_row, block_col);
+    if (index < block_count_) {
+        const BlockKey key = GetBlockKey(index);
+        if (key.block_row == block_row && key.block_col == block_col) {
+            return index;
+        }
+    }
+    return block_count_;
+}
+
+CellRecord Reader::ReadCell(std::uint64_t& offset, std::uint64_t end, Position origin) const {
+    CellRecord cell;
+    const int row = Get<std::uint8_t>(data_, offset, end);
+    const int col = Get<std::uint8_t>(data_, offset, end);
+    const std::uint8_t flags = Get<std::uint8_t>(data_, offset, end);
+    const std::uint8_t category = Get<std::uint8_t>(data_, offset, end);
+    const std::uint32_t text_size = Get<std::uint32_t>(data_, offset, end);
+    cell.pos = { origin.row + row, origin.col + col };
+    if (row >= block_rows_ || col >= block_cols_ || !cell.pos.IsValid() || ((flags & CELL_NUMBER) && (flags & CELL_ERROR))
+        || category > static_cast<std::uint8_t>(FormulaError::Category::Div0)) {
+        ThrowInvalid("malformed cell");
+    }
+
+    if (flags & CELL_FORMULA) {
+        cell.program = Get<std::uint32_t>(data_, offset, end);
+        if (*cell.program >= programs_.size()) {
+            ThrowInvalid("malformed cell");
+        }
+    }
+    if (flags & CELL_NUMBER) {
+        cell.cache = Get<double>(data_, offset, end);
+    }
+    else if (flags & CELL_ERROR) {
+        cell.cache = FormulaError(static_cast<FormulaError::Category>(category));
+    }
+    if (end - offset < text_size) {
+        ThrowInvalid("unexpected end of data");
+    }
+    cell.text = data_.substr(offset, text_size);
+    offset += text_size;
+    if (cell.text.empty() || (cell.program.has_value() != (cell.text.size() > 1 && cell.text[0] == FORMULA_SIGN))) {
+        ThrowInvalid("malformed cell");
+    }
+    return cell;
+}
+
+std::shared_ptr<const FormulaAST> Reader::GetProgram(std::uint32_t index) {
+    if (programs_[index]) {
+        return programs_[index];
+    }
+
+    std::uint64_t entry = programs_offset_ + index * sizeof(std::uint64_t);
+    std::uint64_t offset = Get<std::uint64_t>(data_, entry, blocks_offset_);
+    const std::uint64_t end = index + 1 < programs_.size() ? Get<std::uint64_t>(data_, entry, blocks_offset_)
+                                                           : programs_offset_;
+    if (offset < cells_end_ || offset > end || end > programs_offset_) {
+        ThrowInvalid("malformed program directory");
+    }
+
+    const std::uint32_t code_size = Get<std::uint32_t>(data_, offset, end);
+    const std::uint32_t numbers_size = Get<std::uint32_t>(data_, offset, end);
+    const std::uint32_t cells_size = Get<std::uint32_t>(data_, offset, end);
+    const std::uint32_t ranges_size = Get<std::uint32_t>(data_, offset, end);
+    const std::uint32_t referenced_cells = Get<std::uint32_t>(data_, offset, end);
+    const std::uint32_t referenced_ranges = Get<std::uint32_t>(data_, offset, end);
+    // размеры проверяются до выделения памяти
+    const std::uint64_t record_size = code_size * (2 + sizeof(std::uint32_t))
+        + std::uint64_t{ numbers_size } * sizeof(double)
+        + (std::uint64_t{ cells_size } + referenced_cells) * 2 * sizeof(std::int32_t)
+        + (std::uint64_t{ ranges_size } + referenced_ranges) * 4 * sizeof(std::int32_t);
+    if (end - offset != record_size) {
+        ThrowInvalid("malformed program");
+    }
+
+    ASTImpl::Program program;
+    program.code.reserve(code_size);
+    for (std::uint32_t i = 0; i < code_size; ++i) {
+        ASTImpl::Instruction instruction{ ASTImpl::OpCode::PushNumber };
+        instruction.op = static_cast<ASTImpl::OpCode>(Get<std::uint8_t>(data_, offset, end));
+        instruction.function = static_cast<ASTImpl::Function>(Get<std::uint8_t>(data_, offset, end));
+        instruction.arg = Get<std::uint32_t>(data_, offset, end);
+        program.code.push_back(instruction);
+    }
+    program.numbers.reserve(numbers_size);
+    for (std::uint32_t i = 0; i < numbers_size; ++i) {
+        program.numbers.push_back(Get<double>(data_, offset, end));
+    }
+    program.cells.reserve(cells_size);
+    for (std::uint32_t i = 0; i < cells_size; ++i) {
+        program.cells.push_back(GetPosition(data_, offset, end));
+    }
+    program.ranges.reserve(ranges_size);
+    for (std::uint32_t i = 0; i < ranges_size; ++i) {
+        program.ranges.push_back(GetRange(data_, offset, end));
+    }
+    std::forward_list<Position> cells;
+    for (std::uint32_t i = 0; i < referenced_cells; ++i) {
+        cells.push_front(GetPosition(data_, offset, end));
+    }
+    std::forward_list<Range> ranges;
+    for (std::uint32_t i = 0; i < referenced_ranges; ++i) {
+        ranges.push_front(GetRange(data_, offset, end));
+    }
+
+    try {
+        programs_[index] = std::make_shared<const FormulaAST>(std::move(program), std::move(cells), std::move(ranges));
+    }
+    catch (const std::invalid_argument&) {
+        ThrowInvalid("malformed program");
+    }
+    return programs_[index];
+}
+
+}  // namespace snapshot
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "common.h"
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class FormulaAST;
+
+// Двоичный снимок листа: тексты непустых ячеек, скомпилированные выражения
+// формул, ссылки формул на ячейки и диапазоны и вычисленные значения.
+// Ячейки сгруппированы по блокам листа и читаются поблочно прямо из
+// отображённого в память файла, поэтому открытие снимка не зависит от
+// размера листа. Выражения хранятся по одному на шаблон формулы, как их
+// разделяют ячейки листа, и восстанавливаются без разбора текста.
+//
+// Файл: заголовок, записи ячеек по блокам, выражения, каталог выражений,
+// каталог блоков и концевик со ссылками на каталоги. Числа записываются в
+// порядке байт записавшей машины, снимок с другим порядком не читается.
+namespace snapshot {
+
+inline constexpr std::uint32_t VERSION = 1;
+
+// Пишет снимок в поток за один проход. Ячейки передаются поблочно: блоки
+// по строкам блоков, в строке - по столбцам, ячейки блока подряд.
+class Writer {
+public:
+    Writer(std::ostream& output, int block_rows, int block_cols);
+
+    // Непустая ячейка. program - выражение её формулы либо nullptr.
+    void AddCell(Position pos, const std::string& text, std::shared_ptr<const FormulaAST> program,
+        std::optional<CellInterface::NumericValue> cache);
+    void Finish(Size printable_size);
+
+private:
+    template <typename T>
+    void Put(const T& value);
+    void PutBytes(const char* data, size_t size);
+    void PutPosition(Position pos);
+    void PutRange(const Range& range);
+    std::uint32_t GetProgramIndex(std::shared_ptr<const FormulaAST> program);
+
+    std::ostream& output_;
+    const int block_rows_;
+    const int block_cols_;
+    std::uint64_t offset_ = 0;
+    std::string buffer_;
+
+    struct BlockEntry {
+        int block_row;
+        int block_col;
+        std::uint64_t begin;
+    };
+    std::vector<BlockEntry> blocks_;
+    // выражения в порядке первого появления и их номера
+    std::vector<std::shared_ptr<const FormulaAST>> programs_;
+    std::unordered_map<const FormulaAST*, std::uint32_t> program_indices_;
+};
+
+// Ячейка снимка. Текст указывает в отображённый файл.
+struct CellRecord {
+    Position pos;
+    std::string_view text;
+    // номер выражения формулы, см. Reader::GetProgram()
+    std::optional<std::uint32_t> program;
+    std::optional<CellInterface::NumericValue> cache;
+};
+
+// Читает снимок из файла. Конструктор проверяет заголовок и каталоги,
+// остальные данные проверяются при чтении. Некорректный снимок приводит к
+// std::runtime_error.
+class Reader {
+public:
+    explicit Reader(const std::string& path);
+
+    Size GetPrintableSize() const {
+        return printable_size_;
+    }
+
+    size_t GetBlockCount() const {
+        return block_count_;
+    }
+
+    // Номер блока с ячейкой pos в каталоге либо GetBlockCount(), если в
+    // блоке нет ячеек.
+    size_t FindBlock(Position pos) const;
+
+    // Вызывает f(index) для блоков каталога, пересекающихся с диапазоном.
+    template <typename F>
+    void ForEachBlockInRange(Range range, F&& f) const {
+        for (int block_row = range.from.row / block_rows_; block_row <= range.to.row / block_rows_; ++block_row) {
+            const int last_col = range.to.col / block_cols_;
+            for (size_t index = LowerBound(block_row, range.from.col / block_cols_); index < block_count_;
+                ++index) {
+                const BlockKey key = GetBlockKey(index);
+                if (key.block_row != block_row || key.block_col > last_col) {
+                    break;
+                }
+                f(index);
+            }
+        }
+    }
+
+    // Читает ячейки блока: f(const CellRecord&).
+    template <typename F>
+    void ReadBlock(size_t index, F&& f) const {
+        const BlockKey key = GetBlockKey(index);
+        const Position origin{ key.block_row * block_rows_, key.block_col * block_cols_ };
+        std::uint64_t offset = GetBlockBegin(index);
+        const std::uint64_t end = GetBlockEnd(index);
+        while (offset < end) {
+            f(ReadCell(offset, end, origin));
+        }
+    }
+
+    // Выражение формулы. Восстанавливается при первом обращении.
+    std::shared_ptr<const FormulaAST> GetProgram(std::uint32_t index);
+
+private:
+    struct BlockKey {
+        int block_row;
+        int block_col;
+    };
+
+    BlockKey GetBlockKey(size_t index) const;
+    std::uint64_t GetBlockBegin(size_t index) const;
+    std::uint64_t GetBlockEnd(size_t index) const;
+    // первый блок каталога, не меньший (block_row, block_col)
+    size_t LowerBound(int block_row, int block_col) const;
+    // читает ячейку блока с левым верхним углом origin по смещению offset
+    // и сдвигает offset за неё
+    CellRecord ReadCell(std::uint64_t& offset, std::uint64_t end, Position origin) const;
+
+    MappedFile file_;
+    std::string_view data_;
+    Size printable_size_;
+    int block_rows_ = 1;
+    int block_cols_ = 1;
+    size_t block_count_ = 0;
+    // начала каталогов и конец записей ячеек
+    std::uint64_t blocks_offset_ = 0;
+    std::uint64_t programs_offset_ = 0;
+    std::uint64_t cells_end_ = 0;
+    std::vector<std::shared_ptr<const FormulaAST>> programs_;
+};
+
+}  // namespace snapshot
@@ -1,6 +1,7 @@
 #include "common.h"
 
 #include <cctype>
+#include <charconv>
 #include <sstream>
 #include <algorithm>
 
@@ -59,8 +60,8 @@ Position Position::FromString(std::string_view str) {
     }
 
     int row;
-    std::istringstream row_in{std::string{digits}};
-    if (!(row_in >> row) || !row_in.eof()) {
+    auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), row);
+    if (error != std::errc() || end != digits.data() + digits.size()) {
         return Position::NONE;
     }
 
@@ -75,4 +76,100 @@ Position Position::FromString(std::string_view str) {
 
 bool Size::operator==(Size rhs) const {
     return cols == rhs.cols && rows == rhs.rows;
-}
\ No newline at end of file
+}
+
+bool Range::operator==(const Range rhs) const {
+    return from == rhs.from && to == rhs.to;
+}
+
+bool Range::operator<(const Range rhs) const {
+    return std::tie(from, to) < std::tie(rhs.from, rhs.to);
+}
+
+bool Range::IsValid() const {
+    return from.IsValid() && to.IsValid() && from.row <= to.row && from.col <= to.col;
+}
+
+bool Range::Contains(const Position pos) const {
+    return pos.row >= from.row && pos.row <= to.row && pos.col >= from.col && pos.col <= to.col;
+}
+
+std::string Range::ToString() const {
+    if (!IsValid()) {
+        return "";
+    }
+    return from.ToString() + ':' + to.ToString();
+}
+
+namespace {
+    size_t SkipDigits(std::string_view text, size_t pos) {
+        while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+        return pos;
+    }
+}
+
+std::optional<double> ParseNumber(std::string_view text) {
+    size_t pos = 0;
+    if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+        ++pos;
+    }
+
+    size_t int_end = SkipDigits(text, pos);
+    size_t frac_end = int_end;
+    if (frac_end < text.size() && text[frac_end] == '.') {
+        frac_end = SkipDigits(text, frac_end + 1);
+    }
+    if (int_end == pos && frac_end <= int_end + 1) {
+        return std::nullopt;
+    }
+
+    pos = frac_end;
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+        ++pos;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            ++pos;
+        }
+        size_t exp_end = SkipDigits(text, pos);
+        if (exp_end == pos) {
+            return std::nullopt;
+        }
+        pos = exp_end;
+    }
+    if (pos != text.size()) {
+        return std::nullopt;
+    }
+
+    // std::from_chars не принимает знак "+"
+    const char* first = text.data() + (text[0] == '+' ? 1 : 0);
+    const char* last = text.data() + text.size();
+    double value = 0.0;
+    auto [end, error] = std::from_chars(first, last, value);
+    if (error != std::errc() || end != last) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+bool SheetInterface::ForEachValueRun(Range /* range */,
+    const std::function<void(Position, const double*, size_t)>& /* f */) const {
+    return false;
+}
+
+CellInterface::NumericValue CellInterface::GetNumericValue() const {
+    Value value = GetValue();
+    if (const auto* text = std::get_if<std::string>(&value)) {
+        if (text->empty()) {
+            return 0.0;
+        }
+        if (auto number = ParseNumber(*text)) {
+            return *number;
+        }
+        return FormulaError(FormulaError::Category::Value);
+    }
+    if (const auto* number = std::get_if<double>(&value)) {
+        return *number;
+    }
+    return std::get<FormulaError>(value);
+}
@@ -0,0 +1,220 @@
+#include "text_import.h"
+
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+// меньшие порции не окупают передачу другому потоку
+constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+// порций больше, чем потоков, чтобы потоки не простаивали из-за неравных порций
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+struct Format {
+    char separator;
+    bool quoted;
+};
+
+Format GetFormat(TextFormat format) {
+    return format == TextFormat::Csv ? Format{ ',', true } : Format{ '\t', false };
+}
+
+// Конец поля, которое начинается с pos: индекс разделителя, перевода строки
+// или text.size(). Кавычка имеет особый смысл только в начале поля, после
+// закрывающей кавычки поле продолжается до разделителя.
+size_t FindFieldEnd(std::string_view text, size_t pos, Format format) {
+    if (format.quoted && pos < text.size() && text[pos] == '"') {
+        for (++pos; pos < text.size(); ++pos) {
+            if (text[pos] == '"') {
+                if (pos + 1 < text.size() && text[pos + 1] == '"') {
+                    ++pos;
+                }
+                else {
+                    ++pos;
+                    break;
+                }
+            }
+        }
+    }
+    while (pos < text.size() && text[pos] != format.separator && text[pos] != '\n') {
+        ++pos;
+    }
+    return pos;
+}
+
+// Текст поля [begin, end) без кавычек и без '\r' перед переводом строки.
+std::string GetField(std::string_view text, size_t begin, size_t end, Format format) {
+    std::string_view field = text.substr(begin, end - begin);
+    if ((end == text.size() || text[end] == '\n') && !field.empty() && field.back() == '\r') {
+        field.remove_suffix(1);
+    }
+    if (!format.quoted || field.empty() || field[0] != '"') {
+        return std::string(field);
+    }
+
+    std::string value;
+    size_t pos = 1;
+    while (pos < field.size()) {
+        const size_t quote = field.find('"', pos);
+        if (quote == std::string_view::npos) {
+            value.append(field.substr(pos));
+            return value;
+        }
+        value.append(field.substr(pos, quote - pos));
+        if (quote + 1 < field.size() && field[quote + 1] == '"') {
+            value.push_back('"');
+            pos = quote + 2;
+        }
+        else {
+            value.append(field.substr(quote + 1));
+            return value;
+        }
+    }
+    return value;
+}
+
+// Порция текста из целых строк. Строки и столбцы ячеек считаются от начала
+// порции.
+struct Chunk {
+    std::string_view text;
+    std::vector<std::pair<Position, std::string>> cells;
+    // число строк порции, включая пустые
+    size_t rows = 0;
+    int max_col = -1;
+};
+
+void ParseChunk(Chunk& chunk, Format format) {
+    const std::string_view text = chunk.text;
+    int row = 0;
+    int col = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t end = FindFieldEnd(text, pos, format);
+        if (end > pos) {
+            std::string value = GetField(text, pos, end, format);
+            if (!value.empty()) {
+                chunk.cells.push_back({ { row, col }, std::move(value) });
+                chunk.max_col = std::max(chunk.max_col, col);
+            }
+        }
+        if (end < text.size() && text[end] == format.separator) {
+            ++col;
+        }
+        else {
+            ++row;
+            col = 0;
+        }
+        pos = end + 1;
+    }
+    chunk.rows = row;
+}
+
+// Делит текст на порции примерно по size байт. Граница порции - конец
+// строки, а не перевод строки внутри кавычек, поэтому для CSV поля
+// просматриваются по порядку.
+std::vector<Chunk> SplitChunks(std::string_view text, size_t size, Format format) {
+    std::vector<Chunk> chunks;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.size();
+        if (text.size() - begin > size) {
+            const size_t target = begin + size;
+            if (format.quoted) {
+                size_t pos = begin;
+                for (;;) {
+                    pos = FindFieldEnd(text, pos, format);
+                    if (pos == text.size() || (text[pos] == '\n' && pos >= target)) {
+                        break;
+                    }
+                    ++pos;
+                }
+                end = pos == text.size() ? pos : pos + 1;
+            }
+            else {
+                const size_t newline = text.find('\n', target);
+                end = newline == std::string_view::npos ? text.size() : newline + 1;
+            }
+        }
+        Chunk chunk;
+        chunk.text = text.substr(begin, end - begin);
+        chunks.push_back(std::move(chunk));
+        begin = end;
+    }
+    return chunks;
+}
+
+}  // namespace
+
+std::vector<std::pair<Position, std::string>> ParseTexts(std::string_view text, TextFormat text_format,
+    size_t threads) {
+    const Format format = GetFormat(text_format);
+    if (threads == 0) {
+        threads = 1;
+    }
+    const size_t chunk_size = std::max(MIN_CHUNK_SIZE, text.size() / (threads * CHUNKS_PER_THREAD) + 1);
+    std::vector<Chunk> chunks = SplitChunks(text, chunk_size, format);
+
+    std::unique_ptr<ThreadPool> pool;
+    if (threads > 1 && chunks.size() > 1) {
+        pool = std::make_unique<ThreadPool>(std::min(threads, chunks.size()));
+        ParallelFor(*pool, chunks.size(), [&chunks, format](size_t i) {
+            ParseChunk(chunks[i], format);
+        });
+    }
+    else {
+        for (Chunk& chunk : chunks) {
+            ParseChunk(chunk, format);
+        }
+    }
+
+    // строки порций нумеруются от начала текста
+    std::vector<size_t> first_rows(chunks.size());
+    std::vector<size_t> first_cells(chunks.size());
+    size_t rows = 0;
+    size_t cells = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const Chunk& chunk = chunks[i];
+        if (!chunk.cells.empty()) {
+            if (chunk.max_col >= Position::MAX_COLS
+                || rows + chunk.cells.back().first.row >= static_cast<size_t>(Position::MAX_ROWS)) {
+                throw InvalidPositionException("Parse Texts: out of range");
+            }
+        }
+        first_rows[i] = rows;
+        first_cells[i] = cells;
+        rows += chunk.rows;
+        cells += chunk.cells.size();
+    }
+
+    std::vector<std::pair<Position, std::string>> result(cells);
+    auto move_chunk = [&](size_t i) {
+        const int first_row = static_cast<int>(first_rows[i]);
+        auto out = result.begin() + first_cells[i];
+        for (auto& [pos, value] : chunks[i].cells) {
+            out->first = { pos.row + first_row, pos.col };
+            out->second = std::move(value);
+            ++out;
+        }
+    };
+    if (pool) {
+        ParallelFor(*pool, chunks.size(), move_chunk);
+    }
+    else {
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            move_chunk(i);
+        }
+    }
+    return result;
+}
+
+void ImportTexts(SheetInterface& sheet, const std::string& path, TextFormat format, size_t threads) {
+    std::vector<std::pair<Position, std::string>> cells;
+    {
+        const MappedFile file(path);
+        cells = ParseTexts(file.GetText(), format, threads);
+    }
+    sheet.SetCells(std::move(cells));
+}
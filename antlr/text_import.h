@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Формат текста таблицы.
+// Tsv - как у PrintTexts(): ячейки строки разделяются табуляцией, тексты
+// записаны как есть.
+// Csv - ячейки разделяются запятой; текст в двойных кавычках может содержать
+// запятые и переводы строк, кавычка внутри него удваивается.
+// Строки разделяются переводом строки, "\r\n" тоже допускается.
+enum class TextFormat {
+    Tsv,
+    Csv,
+};
+
+// Разбирает текст таблицы в тексты непустых ячеек, по строкам и в строке
+// слева направо. Текст делится на порции по целым строкам, порции
+// разбираются на threads потоках. Бросает InvalidPositionException, если
+// непустая ячейка не помещается в таблицу.
+std::vector<std::pair<Position, std::string>> ParseTexts(std::string_view text, TextFormat format,
+    size_t threads = 1);
+
+// Загружает тексты ячеек из файла одним вызовом SetCells(): таблица
+// изменяется, только если корректны все ячейки. Файл отображается в память и
+// разбирается на threads потоках, формулы разбирает SetCells() на потоках
+// таблицы, см. SetRecalculationThreads(). Бросает std::runtime_error, если
+// файл не удалось прочитать, и исключения ParseTexts() и SetCells().
+void ImportTexts(SheetInterface& sheet, const std::string& path, TextFormat format, size_t threads = 1);
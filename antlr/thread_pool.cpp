@@ -0,0 +1,79 @@
+#include "thread_pool.h"
+
+#include <atomic>
+#include <cassert>
+
+ThreadPool::ThreadPool(size_t threads) {
+    assert(threads > 0);
+    workers_.reserve(threads - 1);
+    for (size_t worker = 1; worker < threads; ++worker) {
+        workers_.emplace_back([this, worker] {
+            Work(worker);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return workers_.size() + 1;
+}
+
+void ThreadPool::Run(const std::function<void(size_t)>& job) {
+    {
+        std::lock_guard guard(mutex_);
+        job_ = &job;
+        running_ = workers_.size();
+        ++generation_;
+    }
+    start_.notify_all();
+
+    job(0);
+
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] {
+        return running_ == 0;
+    });
+    job_ = nullptr;
+}
+
+void ThreadPool::Work(size_t worker) {
+    size_t seen = 0;
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        start_.wait(lock, [this, seen] {
+            return stop_ || generation_ != seen;
+        });
+        if (stop_) {
+            return;
+        }
+
+        seen = generation_;
+        const auto& job = *job_;
+        lock.unlock();
+        job(worker);
+        lock.lock();
+
+        if (--running_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+void ParallelFor(ThreadPool& pool, size_t count, const std::function<void(size_t)>& f) {
+    std::atomic<size_t> next{ 0 };
+    pool.Run([&](size_t) {
+        for (size_t index = next++; index < count; index = next++) {
+            f(index);
+        }
+    });
+}
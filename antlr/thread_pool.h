@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Постоянный набор потоков, на которых запускается одна и та же работа.
+// Поток, вызвавший Run(), участвует в ней как поток с номером 0.
+class ThreadPool {
+public:
+    // threads — общее число потоков вместе с вызывающим, не меньше 1.
+    explicit ThreadPool(size_t threads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    size_t GetThreadCount() const;
+
+    // Выполняет job(worker) на каждом потоке, worker от 0 до
+    // GetThreadCount() - 1, и ждёт завершения всех. job не должна бросать
+    // исключений.
+    void Run(const std::function<void(size_t)>& job);
+
+private:
+    void Work(size_t worker);
+
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(size_t)>* job_ = nullptr;
+    size_t generation_ = 0;
+    size_t running_ = 0;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
+
+// Выполняет f(index) для index от 0 до count - 1 на потоках pool и ждёт
+// завершения. Потоки берут индексы по очереди, поэтому нагрузка распределяется
+// и при разной стоимости вызовов. f не должна бросать исключений.
+void ParallelFor(ThreadPool& pool, size_t count, const std::function<void(size_t)>& f);
+
+// Очереди задач для ThreadPool, по одной на поток. Поток берёт последнюю
+// добавленную им задачу, а когда его очередь пуста — крадёт самую старую
+// задачу из очереди другого потока.
+template <typename T>
+class WorkStealingQueues {
+public:
+    explicit WorkStealingQueues(size_t workers)
+        : queues_(workers) {
+    }
+
+    void Push(size_t worker, T item) {
+        Queue& queue = queues_[worker];
+        std::lock_guard guard(queue.mutex);
+        queue.items.push_back(std::move(item));
+    }
+
+    std::optional<T> Pop(size_t worker) {
+        {
+            Queue& own = queues_[worker];
+            std::lock_guard guard(own.mutex);
+            if (!own.items.empty()) {
+                T item = std::move(own.items.back());
+                own.items.pop_back();
+                return item;
+            }
+        }
+
+        for (size_t i = 1; i < queues_.size(); ++i) {
+            Queue& victim = queues_[(worker + i) % queues_.size()];
+            std::lock_guard guard(victim.mutex);
+            if (!victim.items.empty()) {
+                T item = std::move(victim.items.front());
+                victim.items.pop_front();
+                return item;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    // на отдельной кеш-линии, чтобы потоки не мешали друг другу
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<T> items;
+    };
+
+    std::vector<Queue> queues_;
+};